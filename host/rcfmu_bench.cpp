@@ -0,0 +1,145 @@
+// Decoder throughput benchmark.
+//
+//   rcfmu_bench <capture.bin>
+//   rcfmu_bench --synth <megabytes> <capture.bin>   (write then decode)
+//
+// Reports frames/sec and MB/sec for a scan only pass (framing and
+// checksums) and for a full columnar decode pass.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+using std::vector;
+
+#include "rcfmu_messages.h"
+#include "rcfmu_capture.h"
+#include "rcfmu_columns.h"
+
+using namespace rcfmu_message;
+
+static const uint64_t max_rows = 1 << 20;  // bound memory on huge captures
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <class M>
+static void write_msg( FILE *fp, M &msg, vector<uint8_t> &buf ) {
+    msg.pack();
+    buf.resize(max_frame_size(msg.len));
+    size_t n = encode_frame(buf.data(), msg.id, msg.payload, msg.len);
+    fwrite(buf.data(), 1, n, fp);
+}
+
+// a flight-like mix: imu + ekf + pilot every frame, gps/airdata/power
+// at lower rates, and an occasional burst of line noise
+static bool synth_capture( const char *path, uint64_t megabytes ) {
+    FILE *fp = fopen(path, "wb");
+    if ( fp == nullptr ) {
+        perror(path);
+        return false;
+    }
+    vector<uint8_t> buf;
+    imu_t imu; memset(&imu, 0, sizeof(imu));
+    ekf_t ekf; memset(&ekf, 0, sizeof(ekf));
+    pilot_t pilot; memset(&pilot, 0, sizeof(pilot));
+    gps_t gps; memset(&gps, 0, sizeof(gps));
+    airdata_t air; memset(&air, 0, sizeof(air));
+    power_t power; memset(&power, 0, sizeof(power));
+    uint64_t target = megabytes << 20;
+    for ( uint32_t frame = 0; (uint64_t)ftell(fp) < target; frame++ ) {
+        imu.frame_usec = ekf.frame_usec = pilot.frame_usec = frame * 10000;
+        imu.millis = frame * 10;
+        imu.ax_mps2 = 0.01 * (frame % 100);
+        imu.az_mps2 = -9.81;
+        imu.p_rps = 0.001 * (frame % 50);
+        imu.sequence = ekf.sequence = pilot.sequence = frame;
+        write_msg(fp, imu, buf);
+        ekf.lat_rad = 0.78;
+        ekf.altitude_m = 300.0 + 0.001 * frame;
+        write_msg(fp, ekf, buf);
+        write_msg(fp, pilot, buf);
+        if ( frame % 10 == 0 ) {
+            gps.sequence = frame / 10;
+            write_msg(fp, gps, buf);
+            write_msg(fp, air, buf);
+        }
+        if ( frame % 50 == 0 ) {
+            write_msg(fp, power, buf);
+        }
+        if ( frame % 1000 == 999 ) {
+            uint8_t noise[37];
+            for ( unsigned i = 0; i < sizeof(noise); i++ ) {
+                noise[i] = rand();
+            }
+            fwrite(noise, 1, sizeof(noise), fp);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+static void report( const char *label, uint64_t frames, size_t bytes, double dt ) {
+    printf("%-8s %12llu frames %8.3f sec %12.0f frames/sec %8.1f MB/sec\n",
+           label, (unsigned long long)frames, dt, frames / dt,
+           bytes / dt / (1024.0 * 1024.0));
+}
+
+int main( int argc, char **argv ) {
+    const char *path = nullptr;
+    if ( argc == 4 && strcmp(argv[1], "--synth") == 0 ) {
+        path = argv[3];
+        printf("writing synthetic capture: %s (%s MB)\n", path, argv[2]);
+        if ( !synth_capture(path, strtoull(argv[2], nullptr, 10)) ) {
+            return 1;
+        }
+    } else if ( argc == 2 ) {
+        path = argv[1];
+    } else {
+        printf("usage: %s <capture> | --synth <megabytes> <capture>\n", argv[0]);
+        return 1;
+    }
+
+    capture_file_t capture;
+    if ( !capture.open(path) ) {
+        return 1;
+    }
+    printf("capture: %s %.1f MB\n", path, capture.size / (1024.0 * 1024.0));
+
+    // scan only
+    double start = now();
+    frame_scanner_t scan(capture.data, capture.size);
+    frame_t frame;
+    uint64_t id_sum = 0;
+    while ( scan.next(frame) ) {
+        id_sum += frame.id;     // keep the loop honest
+    }
+    report("scan", scan.frames, capture.size, now() - start);
+
+    // scan + columnar decode
+    start = now();
+    frame_scanner_t scan2(capture.data, capture.size);
+    columnar_decoder_t decoder;
+    uint64_t rows = 0;
+    while ( scan2.next(frame) ) {
+        decoder.decode(frame);
+        if ( ++rows >= max_rows ) {
+            decoder.clear();
+            rows = 0;
+        }
+    }
+    report("decode", decoder.decoded, capture.size, now() - start);
+
+    printf("checksum errors: %llu  length errors: %llu  skipped bytes: %llu\n",
+           (unsigned long long)scan2.checksum_errors,
+           (unsigned long long)scan2.length_errors,
+           (unsigned long long)scan2.skipped_bytes);
+    printf("size errors: %llu  unhandled: %llu  partial tail: %zu bytes (%llu)\n",
+           (unsigned long long)decoder.size_errors,
+           (unsigned long long)decoder.unhandled,
+           scan2.remaining(), (unsigned long long)(id_sum & 1));
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <fcntl.h>              // open()
+#include <string.h>             // memcpy()
+#include <sys/mman.h>           // mmap()
+#include <sys/stat.h>           // fstat()
+#include <unistd.h>             // close()
+
+#include <stdio.h>
+
+#include "serial_framing.h"
+#include "rcfmu_capture.h"
+
+using namespace serial_framing;
+
+capture_file_t::~capture_file_t() {
+    close();
+}
+
+bool capture_file_t::open( const char *path ) {
+    close();
+    fd = ::open(path, O_RDONLY);
+    if ( fd < 0 ) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if ( fstat(fd, &st) < 0 ) {
+        perror(path);
+        close();
+        return false;
+    }
+    size = st.st_size;
+    if ( size == 0 ) {
+        return true;
+    }
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( p == MAP_FAILED ) {
+        perror("mmap");
+        size = 0;
+        close();
+        return false;
+    }
+    // captures are read front to back exactly once
+    madvise(p, size, MADV_SEQUENTIAL);
+    data = (const uint8_t *)p;
+    return true;
+}
+
+void capture_file_t::close() {
+    if ( data != nullptr ) {
+        munmap((void *)data, size);
+        data = nullptr;
+    }
+    if ( fd >= 0 ) {
+        ::close(fd);
+        fd = -1;
+    }
+    size = 0;
+}
+
+frame_scanner_t::frame_scanner_t( const uint8_t *buf, size_t size,
+                                  format_t format ):
+    buf(buf),
+    size(size),
+    format(format)
+{
+}
+
+bool frame_scanner_t::next( frame_t &frame ) {
+    while ( pos < size ) {
+        size_t used;
+        scan_result_t result;
+        if ( format.framing == FRAMING_COBS ) {
+            result = scan_cobs(buf + pos, size - pos, scratch, &frame, &used,
+                               format.checksum);
+        } else {
+            result = scan(buf + pos, size - pos, &frame, &used, format.checksum);
+        }
+        if ( result == scan_frame ) {
+            skipped_bytes += frame.offset;
+            frame.offset += pos;
+            pos += used;
+            frames++;
+            return true;
+        }
+        skipped_bytes += used;
+        pos += used;
+        if ( result == scan_need_more ) {
+            return false;
+        } else if ( result == scan_bad_length ) {
+            length_errors++;
+        } else {
+            checksum_errors++;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Host side (HAL free) access to captured SerialLink byte streams.
+//
+// A capture is memory mapped and scanned in place: frames are returned
+// as views into the mapping, nothing is copied until a message is
+// decoded.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "serial_framing.h"
+
+// read only memory mapping of a capture file
+class capture_file_t {
+public:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    capture_file_t() {}
+    ~capture_file_t();
+
+    bool open( const char *path );
+    void close();
+
+private:
+    int fd = -1;
+};
+
+// one validated frame (payload points into the scanned buffer, or
+// for cobs framing into the scanner's decode buffer)
+typedef serial_framing::frame_view_t frame_t;
+using serial_framing::format_t;
+using serial_framing::framing_t;
+using serial_framing::FRAMING_SOM;
+using serial_framing::FRAMING_COBS;
+
+// Scan a buffer for frames, validate length and checksum, and return
+// successive frames (see serial_framing::scan() and scan_cobs())
+class frame_scanner_t {
+public:
+    uint64_t frames = 0;
+    uint64_t checksum_errors = 0;
+    uint64_t length_errors = 0;
+    uint64_t skipped_bytes = 0;  // bytes outside of valid frames
+
+    frame_scanner_t( const uint8_t *buf, size_t size,
+                     format_t format = format_t() );
+
+    bool next( frame_t &frame );
+    size_t position() { return pos; }
+    size_t remaining() { return size - pos; }  // (e.g. a partial tail frame)
+
+private:
+    const uint8_t *buf;
+    size_t size;
+    size_t pos = 0;
+    format_t format;
+    uint8_t scratch[serial_framing::cobs_max_size(serial_framing::MAX_PAYLOAD)];
+};
+
+// encode one frame into dst, returns the encoded size (dst must hold
+// max_frame_size(len) bytes)
+using serial_framing::encode_frame;
+inline size_t max_frame_size( uint16_t len ) {
+    return serial_framing::cobs_max_size(len);
+}
@@ -0,0 +1,216 @@
+// Checksum self check and benchmark.
+//
+//   rcfmu_checksum_bench [trials]
+//
+// 1. Known answer checks for each implementation (exits non-zero on
+//    any failure.)
+// 2. CPU cost per byte on typical 40-200 byte payloads and the
+//    resulting load at 500 kbaud.
+// 3. Undetected error rates for random burst errors (up to 32 bits)
+//    and random multi-bit errors in 100 byte frames.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+using std::vector;
+
+#include "serial_checksum.h"
+
+using namespace serial_checksum;
+
+static const char *names[] = { "fletcher16", "fletcher32", "crc32c" };
+static const checksum_t types[] = { CHECKSUM_FLETCHER16, CHECKSUM_FLETCHER32, CHECKSUM_CRC32C };
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int failures = 0;
+
+static void expect( const char *what, uint32_t got, uint32_t want ) {
+    if ( got != want ) {
+        printf("FAIL %s: got 0x%08X expected 0x%08X\n", what, got, want);
+        failures++;
+    }
+}
+
+static uint32_t fletcher32_of( const char *s, size_t split ) {
+    fletcher32_t f;
+    size_t n = strlen(s);
+    f.update((const uint8_t *)s, split);
+    f.update((const uint8_t *)s + split, n - split);
+    return f.final();
+}
+
+// straightforward reference versions to check the fast paths against
+static uint32_t fletcher32_reference( const uint8_t *buf, size_t n ) {
+    uint32_t c0 = 0, c1 = 0;
+    for ( size_t i = 0; i < n; i += 2 ) {
+        uint16_t w = buf[i] | (i + 1 < n ? buf[i + 1] << 8 : 0);
+        c0 = (c0 + w) % 65535;
+        c1 = (c1 + c0) % 65535;
+    }
+    return (c1 << 16) | c0;
+}
+
+static uint32_t crc32c_reference( const uint8_t *buf, size_t n ) {
+    uint32_t crc = 0xFFFFFFFF;
+    for ( size_t i = 0; i < n; i++ ) {
+        crc ^= buf[i];
+        for ( int k = 0; k < 8; k++ ) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void self_check() {
+    // published check values
+    expect("crc32c(123456789)", crc32c((const uint8_t *)"123456789", 9), 0xE3069283);
+    expect("crc32c(32 x 0x00)", crc32c((const uint8_t *)"\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 32), 0x8A9136AA);
+    const char *fletcher_vectors[][2] = {
+        { "abcde", (const char *)0xF04FC729 },
+        { "abcdef", (const char *)0x56502D2A },
+        { "abcdefgh", (const char *)0xEBE19591 }
+    };
+    for ( auto &v: fletcher_vectors ) {
+        // every split point exercises the odd byte carry
+        for ( size_t split = 0; split <= strlen(v[0]); split++ ) {
+            expect(v[0], fletcher32_of(v[0], split), (uint32_t)(uintptr_t)v[1]);
+        }
+    }
+
+    // fast paths vs reference on random data (all lengths and
+    // alignments, long enough to cross the fletcher32 reduce blocks)
+    std::mt19937 rng(42);
+    vector<uint8_t> buf(4200);
+    for ( auto &b: buf ) {
+        b = rng();
+    }
+    for ( size_t n: { 0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 63, 64, 65, 717, 718, 719, 720, 1437, 4099 } ) {
+        for ( size_t offset = 0; offset < 4; offset++ ) {
+            const uint8_t *p = buf.data() + offset;
+            expect("crc32c random", crc32c(p, n), crc32c_reference(p, n));
+            fletcher32_t f;
+            f.update(p, n);
+            expect("fletcher32 random", f.final(), fletcher32_reference(p, n));
+        }
+    }
+    // 0xFF payloads are the worst case for the deferred modulo
+    vector<uint8_t> ones(4099, 0xFF);
+    fletcher32_t f;
+    f.update(ones.data(), ones.size());
+    expect("fletcher32 0xff", f.final(), fletcher32_reference(ones.data(), ones.size()));
+
+    // frame level compute()/verify() round trip
+    for ( checksum_t type: types ) {
+        uint8_t cksum[MAX_SIZE];
+        compute(type, 17, 100, 0, buf.data(), 100, cksum);
+        if ( !verify(type, 17, 100, 0, buf.data(), 100, cksum) ) {
+            printf("FAIL verify %s\n", names[type]);
+            failures++;
+        }
+        buf[50] ^= 0x10;
+        if ( verify(type, 17, 100, 0, buf.data(), 100, cksum) ) {
+            printf("FAIL verify %s accepted a bit flip\n", names[type]);
+            failures++;
+        }
+        buf[50] ^= 0x10;
+    }
+}
+
+static void speed() {
+    const size_t sizes[] = { 40, 100, 200 };
+    std::mt19937 rng(7);
+    vector<uint8_t> buf(256);
+    for ( auto &b: buf ) {
+        b = rng();
+    }
+    printf("\n%-11s", "ns/byte");
+    for ( size_t n: sizes ) {
+        printf(" %6u B", (unsigned)n);
+    }
+    printf("  cpu @ 500 kbaud\n");
+    for ( checksum_t type: types ) {
+        printf("%-11s", names[type]);
+        double ns_per_byte = 0.0;
+        for ( size_t n: sizes ) {
+            const int iterations = 4000000 / n;
+            uint8_t cksum[MAX_SIZE];
+            uint32_t sink = 0;
+            double start = now();
+            for ( int i = 0; i < iterations; i++ ) {
+                buf[0] = i;
+                compute(type, 17, n, 0, buf.data(), n, cksum);
+                sink += cksum[0];
+            }
+            double dt = now() - start;
+            ns_per_byte = dt * 1e9 / ((double)iterations * n);
+            printf(" %8.3f", ns_per_byte + (sink == 0xFFFFFFFF));
+        }
+        // 500 kbaud ~ 50000 bytes/sec (8N1)
+        printf("  %.4f%% of this cpu\n", 50000 * ns_per_byte * 1e-9 * 100.0);
+    }
+}
+
+static void detection( int trials ) {
+    std::mt19937_64 rng(99);
+    const size_t n = 100;
+    vector<uint8_t> buf(n), bad(n);
+    printf("\nundetected errors in %d trials (100 byte frames)\n", trials);
+    printf("%-11s %14s %14s %14s\n", "", "burst<=16", "burst<=32", "random 2-8 bit");
+    for ( checksum_t type: types ) {
+        uint64_t missed[3] = { 0, 0, 0 };
+        for ( int mode = 0; mode < 3; mode++ ) {
+            for ( int t = 0; t < trials; t++ ) {
+                for ( auto &b: buf ) {
+                    b = rng();
+                }
+                uint8_t good[MAX_SIZE];
+                compute(type, 17, n, 0, buf.data(), n, good);
+                bad = buf;
+                if ( mode < 2 ) {
+                    // burst: first and last bit flipped, random between
+                    int max_len = mode == 0 ? 16 : 32;
+                    int len = 2 + rng() % (max_len - 1);
+                    size_t start = rng() % (n * 8 - len);
+                    for ( int k = 0; k < len; k++ ) {
+                        if ( k == 0 || k == len - 1 || (rng() & 1) ) {
+                            size_t bit = start + k;
+                            bad[bit / 8] ^= 1 << (bit % 8);
+                        }
+                    }
+                } else {
+                    int flips = 2 + rng() % 7;
+                    for ( int k = 0; k < flips; k++ ) {
+                        size_t bit = rng() % (n * 8);
+                        bad[bit / 8] ^= 1 << (bit % 8);
+                    }
+                }
+                if ( bad != buf && verify(type, 17, n, 0, bad.data(), n, good) ) {
+                    missed[mode]++;
+                }
+            }
+        }
+        printf("%-11s %14llu %14llu %14llu\n", names[type],
+               (unsigned long long)missed[0], (unsigned long long)missed[1],
+               (unsigned long long)missed[2]);
+    }
+}
+
+int main( int argc, char **argv ) {
+    int trials = argc > 1 ? atoi(argv[1]) : 200000;
+    self_check();
+    if ( failures ) {
+        printf("%d self check failures\n", failures);
+        return 1;
+    }
+    printf("self check: ok\n");
+    speed();
+    detection(trials);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <string.h>             // memcpy()
+
+#include "rcfmu_columns.h"
+
+using namespace rcfmu_message;
+
+message_columns_t::message_columns_t( uint8_t id, const field_t *fields,
+                                      uint8_t field_count, uint16_t len,
+                                      bool variable ):
+    id(id),
+    len(len),
+    variable(variable),
+    fields(fields),
+    field_count(field_count)
+{
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        if ( fields[i].count > 1 ) {
+            for ( uint8_t j = 0; j < fields[i].count; j++ ) {
+                names.push_back(string(fields[i].name) + "[" + std::to_string(j) + "]");
+            }
+        } else {
+            names.push_back(fields[i].name);
+        }
+    }
+    columns.resize(names.size());
+}
+
+void message_columns_t::append( const uint8_t *payload ) {
+    vector<double> *col = columns.data();
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const uint8_t *src = payload + f.wire_offset;
+        uint8_t size = type_size(f.wire_type);
+        for ( uint8_t j = 0; j < f.count; j++ ) {
+            if ( f.scale != 0.0f ) {
+                (col++)->push_back(load_scaled(src, f.wire_type) * f.inv_scale);
+            } else {
+                // aligned copy of the (unaligned) packed value
+                uint64_t tmp;
+                memcpy(&tmp, src, size);
+                (col++)->push_back(member_as_double((const uint8_t *)&tmp, f.wire_type));
+            }
+            src += size;
+        }
+    }
+    rows++;
+}
+
+void message_columns_t::reserve( size_t n ) {
+    for ( auto &c: columns ) {
+        c.reserve(n);
+    }
+}
+
+void message_columns_t::clear() {
+    for ( auto &c: columns ) {
+        c.clear();
+    }
+    rows = 0;
+}
+
+columnar_decoder_t::columnar_decoder_t() {
+    for ( int i = 0; i < 256; i++ ) {
+        table[i] = nullptr;
+    }
+    add<command_ack_t>();
+    add<command_inceptors_t>();
+    add<pilot_t>();
+    add<imu_t>();
+    add<gps_t>();
+    add<airdata_t>();
+    add<power_t>();
+    add<status_t>();
+    add<ekf_t>();
+    add<command_echo_t>();
+    add<echo_reply_t>();
+    add<reliable_data_t>(true); // header + wrapped command
+    add<reliable_ack_t>();
+    add<task_profile_t>();
+    add<frame_timing_t>();
+}
+
+columnar_decoder_t::~columnar_decoder_t() {
+    for ( int i = 0; i < 256; i++ ) {
+        delete table[i];
+    }
+}
+
+bool columnar_decoder_t::decode( const frame_t &frame ) {
+    message_columns_t *m = table[frame.id];
+    if ( m == nullptr ) {
+        unhandled++;
+        return false;
+    }
+    if ( frame.len != m->len && !(m->variable && frame.len > m->len) ) {
+        size_errors++;
+        return false;
+    }
+    m->append(frame.payload);
+    decoded++;
+    return true;
+}
+
+void columnar_decoder_t::clear() {
+    for ( int i = 0; i < 256; i++ ) {
+        if ( table[i] != nullptr ) {
+            table[i]->clear();
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Columnar (struct of arrays) storage of decoded messages.  Every
+// message id gets one column per value (array fields expand to
+// name[0], name[1], ...) and rows are appended straight from the
+// packed payload using the generated field descriptor tables.
+// Variable length messages (reliable_data: a fixed header and the
+// wrapped command) store the header columns only.
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include "rcfmu_messages.h"
+#include "rcfmu_capture.h"
+
+class message_columns_t {
+public:
+    uint8_t id;
+    uint16_t len;               // expected payload size (variable: header size)
+    bool variable;              // frames may be longer than len
+    vector<string> names;       // one per column
+    vector< vector<double> > columns;
+    uint64_t rows = 0;
+
+    message_columns_t( uint8_t id, const rcfmu_message::field_t *fields,
+                       uint8_t field_count, uint16_t len,
+                       bool variable = false );
+
+    void append( const uint8_t *payload );
+    void reserve( size_t n );
+    void clear();               // drop rows (keeps capacity)
+
+private:
+    const rcfmu_message::field_t *fields;
+    uint8_t field_count;
+};
+
+class columnar_decoder_t {
+public:
+    uint64_t decoded = 0;
+    uint64_t size_errors = 0;
+    uint64_t unhandled = 0;     // unknown ids
+
+    columnar_decoder_t();       // registers all messages
+    ~columnar_decoder_t();
+
+    template <class M> void add( bool variable = false ) {
+        delete table[M::id];
+        table[M::id] = new message_columns_t(M::id, M::fields(), M::field_count, M::len, variable);
+    }
+
+    bool decode( const frame_t &frame );
+    message_columns_t *get( uint8_t id ) { return table[id]; }
+    void clear();
+
+private:
+    message_columns_t *table[256];
+};
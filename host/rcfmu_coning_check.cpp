@@ -0,0 +1,140 @@
+// Check the high rate IMU front end (src/imu_integrator.h) against a
+// finely integrated truth trajectory.
+//
+//   rcfmu_coning_check [ins_hz] [seconds]
+//
+// 1. Coning: rates [A cos wt, A sin wt, 0] (a classic coning motion
+//    that rectifies into a steady drift about z.)  Attitude error after
+//    the run when the 100 hz filter is fed: one instantaneous sample
+//    per frame (the old front end), the plain sum of the INS delta
+//    angles, and the coning compensated delta angle.
+// 2. Sculling: angular oscillation about x with in phase acceleration
+//    along y (rectifies into a steady velocity along z.)  Velocity
+//    error for the same three cases.
+//
+// Exits non-zero if compensation doesn't beat the plain sum by a wide
+// margin.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "imu_integrator.h"
+
+typedef Eigen::Vector3d vec3;
+typedef Eigen::Quaterniond quat;
+
+static const int FRAME_HZ = 100;
+static const int TRUTH_STEPS = 100;     // truth steps per INS sample
+
+// rotation by a rotation vector
+template <class V>
+static quat rotvec( const V &phi ) {
+    double angle = phi.norm();
+    if ( angle < 1e-12 ) {
+        return quat(1.0, 0.5 * phi(0), 0.5 * phi(1), 0.5 * phi(2)).normalized();
+    }
+    return quat(Eigen::AngleAxisd(angle, phi.template cast<double>() / angle));
+}
+
+static double angle_deg( const quat &a, const quat &b ) {
+    return 2.0 * asin(std::min(1.0, (a.conjugate() * b).vec().norm())) * 180.0 / M_PI;
+}
+
+struct motion_t {
+    virtual vec3 omega( double t ) const = 0;
+    virtual vec3 force( double t ) const = 0;
+    virtual ~motion_t() {}
+};
+
+struct coning_t : motion_t {
+    double A = 0.02, w = 2.0 * M_PI * 20.0; // 0.02 rad at 20 hz
+    vec3 omega( double t ) const { return vec3(A * w * cos(w * t), A * w * sin(w * t), 0.0); }
+    vec3 force( double t ) const { return vec3(0.0, 0.0, 0.0); }
+};
+
+struct sculling_t : motion_t {
+    double A = 0.02, B = 2.0, w = 2.0 * M_PI * 20.0;
+    vec3 omega( double t ) const { return vec3(A * w * cos(w * t), 0.0, 0.0); }
+    vec3 force( double t ) const { return vec3(0.0, B * cos(w * t), 0.0); }
+};
+
+struct result_t {
+    double att_deg[3];          // sample, sum, compensated
+    double vel_mps[3];
+};
+
+static result_t run( const motion_t &m, int ins_hz, double seconds ) {
+    int decimation = ins_hz / FRAME_HZ;
+    double h = 1.0 / ((double)ins_hz * TRUTH_STEPS);
+    int frames = seconds * FRAME_HZ;
+
+    quat q_true = quat::Identity();
+    vec3 v_true = vec3::Zero();
+    quat q_est[3] = { quat::Identity(), quat::Identity(), quat::Identity() };
+    vec3 v_est[3] = { vec3::Zero(), vec3::Zero(), vec3::Zero() };
+    imu_integrator_t integ;
+
+    double t = 0.0;
+    for ( int f = 0; f < frames; f++ ) {
+        // frame start attitudes: the velocity comparison uses truth so
+        // it measures only the velocity increment error
+        quat q_frame = q_true;
+        integ.reset();
+        vec3 sum_dtheta = vec3::Zero(), sum_dvel = vec3::Zero();
+        for ( int k = 0; k < decimation; k++ ) {
+            vec3 dtheta = vec3::Zero(), dvel = vec3::Zero();
+            for ( int s = 0; s < TRUTH_STEPS; s++ ) {
+                double tm = t + 0.5 * h;
+                vec3 om = m.omega(tm);
+                vec3 fb = m.force(tm);
+                // half step attitude for the velocity update
+                quat q_mid = q_true * rotvec(0.5 * h * om);
+                v_true += q_mid * (fb * h);
+                q_true = q_true * rotvec(h * om);
+                dtheta += om * h;
+                dvel += fb * h;
+                t += h;
+            }
+            integ.add(dtheta.cast<float>(), dvel.cast<float>(), 1.0f / ins_hz);
+            sum_dtheta += dtheta;
+            sum_dvel += dvel;
+        }
+        // old front end: the frame's last instantaneous sample
+        double dt = 1.0 / FRAME_HZ;
+        vec3 om_sample = m.omega(t), f_sample = m.force(t);
+        q_est[0] = q_est[0] * rotvec(om_sample * dt);
+        q_est[1] = q_est[1] * rotvec(sum_dtheta);
+        q_est[2] = q_est[2] * rotvec(integ.delta_angle());
+        v_est[0] += q_frame * (f_sample * dt);
+        v_est[1] += q_frame * sum_dvel;
+        v_est[2] += q_frame * integ.delta_velocity().cast<double>();
+    }
+    result_t r;
+    for ( int i = 0; i < 3; i++ ) {
+        r.att_deg[i] = angle_deg(q_true, q_est[i]);
+        r.vel_mps[i] = (v_true - v_est[i]).norm();
+    }
+    return r;
+}
+
+int main( int argc, char **argv ) {
+    int ins_hz = argc > 1 ? atoi(argv[1]) : 400;
+    double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+    if ( ins_hz < FRAME_HZ || ins_hz % FRAME_HZ ) {
+        printf("ins_hz must be a multiple of %d\n", FRAME_HZ);
+        return 1;
+    }
+    printf("INS %d hz into %d hz frames, %.0f s\n", ins_hz, FRAME_HZ, seconds);
+    printf("%-10s %14s %14s %14s\n", "", "one sample", "plain sum", "compensated");
+    result_t c = run(coning_t(), ins_hz, seconds);
+    printf("%-10s %12.4f d %12.4f d %12.4f d\n", "coning",
+           c.att_deg[0], c.att_deg[1], c.att_deg[2]);
+    result_t s = run(sculling_t(), ins_hz, seconds);
+    printf("%-10s %10.4f m/s %10.4f m/s %10.4f m/s\n", "sculling",
+           s.vel_mps[0], s.vel_mps[1], s.vel_mps[2]);
+
+    bool ok = c.att_deg[2] < 0.2 * c.att_deg[1] && s.vel_mps[2] < 0.2 * s.vel_mps[1];
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+// Link goodput under injected bit errors, som vs cobs framing.
+//
+//   rcfmu_goodput [frames]
+//
+// Encodes a flight-like stream of telemetry frames, flips random bits
+// at several bit error rates, decodes, and reports the fraction of
+// frames recovered intact, payload goodput as a fraction of wire
+// bytes, and any corrupted frames that passed the checksum.
+//
+// Then targeted corruptions (a damaged length byte, byte bursts) are
+// placed one per 100 frames and the stream is fed to the scanner in
+// small chunks as a receiver would see it.  For each corruption we
+// report the frames lost and the frames that were held back (decoded
+// only after later bytes arrived) while the scanner resynchronized.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+using std::vector;
+
+#include "rcfmu_messages.h"
+#include "rcfmu_capture.h"
+
+using namespace rcfmu_message;
+
+struct sent_t {
+    uint8_t id;
+    vector<uint8_t> payload;
+};
+
+// every telemetry message leads with frame_usec, which we use as a
+// unique frame index to match decoded frames to what was sent
+template <class M>
+static void add( vector<sent_t> &sent, M &msg ) {
+    msg.frame_usec = sent.size();
+    msg.pack();
+    sent_t s;
+    s.id = msg.id;
+    s.payload.assign(msg.payload, msg.payload + msg.len);
+    sent.push_back(s);
+}
+
+static void make_stream( vector<sent_t> &sent, size_t count ) {
+    imu_t imu; memset(&imu, 0, sizeof(imu));
+    ekf_t ekf; memset(&ekf, 0, sizeof(ekf));
+    pilot_t pilot; memset(&pilot, 0, sizeof(pilot));
+    gps_t gps; memset(&gps, 0, sizeof(gps));
+    for ( uint32_t frame = 0; sent.size() < count; frame++ ) {
+        imu.ax_mps2 = 0.01 * (frame % 100);
+        imu.az_mps2 = -9.81;
+        add(sent, imu);
+        ekf.altitude_m = 300.0 + 0.001 * frame;
+        add(sent, ekf);
+        add(sent, pilot);
+        if ( frame % 10 == 0 ) {
+            add(sent, gps);
+        }
+    }
+}
+
+// (starts, when given, gets each frame's wire offset plus the end)
+static vector<uint8_t> encode( const vector<sent_t> &sent, format_t format,
+                               vector<size_t> *starts = nullptr ) {
+    vector<uint8_t> wire;
+    uint8_t buf[serial_framing::cobs_max_size(serial_framing::MAX_PAYLOAD)];
+    for ( const sent_t &s: sent ) {
+        if ( starts ) {
+            starts->push_back(wire.size());
+        }
+        size_t n = encode_frame(buf, s.id, s.payload.data(), s.payload.size(), format);
+        wire.insert(wire.end(), buf, buf + n);
+    }
+    if ( starts ) {
+        starts->push_back(wire.size());
+    }
+    return wire;
+}
+
+// the decoded frame matches what was sent (returns its index)
+static bool match( const vector<sent_t> &sent, const frame_t &frame,
+                   uint32_t *index ) {
+    *index = 0;
+    if ( frame.len >= 4 ) {
+        memcpy(index, frame.payload, 4);
+    }
+    return *index < sent.size() && sent[*index].id == frame.id
+        && sent[*index].payload.size() == frame.len
+        && memcmp(sent[*index].payload.data(), frame.payload, frame.len) == 0;
+}
+
+// flip bits independently with probability ber (geometric gaps)
+static uint64_t inject( vector<uint8_t> &wire, double ber, std::mt19937_64 &rng ) {
+    if ( ber <= 0.0 ) {
+        return 0;
+    }
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    uint64_t bits = wire.size() * 8;
+    uint64_t flips = 0;
+    double pos = 0.0;
+    while ( true ) {
+        pos += floor(log(1.0 - uniform(rng)) / log(1.0 - ber));
+        if ( pos >= bits ) {
+            break;
+        }
+        uint64_t bit = pos;
+        wire[bit / 8] ^= 1 << (bit % 8);
+        flips++;
+        pos += 1.0;
+    }
+    return flips;
+}
+
+// targeted corruption cases
+enum corruption_t { CORRUPT_LENGTH, CORRUPT_BURST };
+
+struct corruption_case_t {
+    const char *name;
+    corruption_t kind;
+    size_t burst;               // bytes overwritten (CORRUPT_BURST)
+};
+
+static const size_t EVENT_SPACING = 100;    // frames between corruptions
+static const size_t RX_CHUNK = 16;          // bytes per receive
+
+// Corrupt one frame every EVENT_SPACING frames and return where each
+// corruption landed (frame index and the wire offset just past it.)
+// The length byte is inverted: the low byte follows SOM0 SOM1 id, and
+// in cobs framing it follows the code byte and id (neither is zero.)
+static void corrupt( vector<uint8_t> &wire, const vector<size_t> &starts,
+                     const corruption_case_t &c, framing_t framing,
+                     std::mt19937_64 &rng, vector<size_t> &event_frames,
+                     vector<size_t> &event_ends ) {
+    size_t frames = starts.size() - 1;
+    for ( size_t k = EVENT_SPACING / 2; k + EVENT_SPACING < frames; k += EVENT_SPACING ) {
+        size_t pos, n;
+        if ( c.kind == CORRUPT_LENGTH ) {
+            pos = starts[k] + (framing == FRAMING_COBS ? 2 : 3);
+            n = 1;
+            wire[pos] = ~wire[pos];
+        } else {
+            pos = starts[k] + rng() % (starts[k + 1] - starts[k]);
+            n = c.burst;
+            for ( size_t i = pos; i < pos + n && i < wire.size(); i++ ) {
+                wire[i] = rng();
+            }
+        }
+        event_frames.push_back(k);
+        event_ends.push_back(pos + n);
+    }
+}
+
+static void targeted( const vector<sent_t> &sent ) {
+    const corruption_case_t cases[] = {
+        { "length byte", CORRUPT_LENGTH, 0 },
+        { "burst 4", CORRUPT_BURST, 4 },
+        { "burst 32", CORRUPT_BURST, 32 },
+        { "burst 256", CORRUPT_BURST, 256 },
+    };
+    const framing_t framings[] = { FRAMING_SOM, FRAMING_COBS };
+    printf("\ntargeted corruption, one per %u frames, %u byte receives\n",
+           (unsigned)EVENT_SPACING, (unsigned)RX_CHUNK);
+    printf("case         framing  events  lost/event  max lost  delayed/event  max delay (bytes)  false accepts\n");
+    for ( const corruption_case_t &c: cases ) {
+        for ( framing_t framing: framings ) {
+            std::mt19937_64 rng(1234);
+            format_t format;
+            format.framing = framing;
+            vector<size_t> starts;
+            vector<uint8_t> wire = encode(sent, format, &starts);
+            vector<size_t> event_frames, event_ends;
+            corrupt(wire, starts, c, framing, rng, event_frames, event_ends);
+
+            // feed the receiver RX_CHUNK bytes at a time; a frame is
+            // delayed if it decodes later than the receive holding its
+            // last byte
+            vector<size_t> decoded_at(sent.size(), 0); // 0: lost
+            uint64_t false_accepts = 0;
+            size_t pos = 0;
+            for ( size_t avail = 0; avail < wire.size(); ) {
+                avail = std::min(avail + RX_CHUNK, wire.size());
+                frame_scanner_t scan(wire.data() + pos, avail - pos, format);
+                frame_t frame;
+                while ( scan.next(frame) ) {
+                    uint32_t index;
+                    if ( match(sent, frame, &index) ) {
+                        decoded_at[index] = avail;
+                    } else {
+                        false_accepts++;
+                    }
+                }
+                pos += scan.position();
+            }
+
+            uint64_t lost = 0, delayed = 0, max_lost = 0;
+            size_t max_delay = 0;
+            for ( size_t e = 0; e < event_frames.size(); e++ ) {
+                size_t last = e + 1 < event_frames.size() ? event_frames[e + 1] : sent.size();
+                uint64_t event_lost = 0;
+                for ( size_t i = event_frames[e]; i < last; i++ ) {
+                    if ( decoded_at[i] == 0 ) {
+                        event_lost++;
+                        continue;
+                    }
+                    size_t end = starts[i + 1];
+                    size_t due = std::min((end + RX_CHUNK - 1) / RX_CHUNK * RX_CHUNK, wire.size());
+                    if ( decoded_at[i] > due ) {
+                        delayed++;
+                        max_delay = std::max(max_delay, decoded_at[i] - end);
+                    }
+                }
+                lost += event_lost;
+                max_lost = std::max(max_lost, event_lost);
+            }
+            double events = event_frames.size();
+            printf("%-12s %-7s %7u %11.2f %9llu %14.2f %18zu %14llu\n",
+                   c.name, framing == FRAMING_COBS ? "cobs" : "som",
+                   (unsigned)event_frames.size(), lost / events,
+                   (unsigned long long)max_lost, delayed / events, max_delay,
+                   (unsigned long long)false_accepts);
+        }
+    }
+}
+
+int main( int argc, char **argv ) {
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    vector<sent_t> sent;
+    make_stream(sent, count);
+    uint64_t payload_bytes = 0;
+    for ( const sent_t &s: sent ) {
+        payload_bytes += s.payload.size();
+    }
+
+    const double bers[] = { 0.0, 1e-6, 1e-5, 1e-4, 3e-4, 1e-3 };
+    const framing_t framings[] = { FRAMING_SOM, FRAMING_COBS };
+    printf("%u frames, %.1f KB payload\n", (unsigned)sent.size(), payload_bytes / 1024.0);
+    printf("framing       ber  bit flips   recovered  goodput  overhead  false accepts\n");
+    for ( double ber: bers ) {
+        for ( framing_t framing: framings ) {
+            std::mt19937_64 rng(1234);
+            format_t format;
+            format.framing = framing;
+            vector<uint8_t> wire = encode(sent, format);
+            size_t wire_bytes = wire.size();
+            uint64_t flips = inject(wire, ber, rng);
+
+            frame_scanner_t scan(wire.data(), wire.size(), format);
+            frame_t frame;
+            uint64_t good = 0, good_bytes = 0, false_accepts = 0;
+            while ( scan.next(frame) ) {
+                uint32_t index;
+                if ( match(sent, frame, &index) ) {
+                    good++;
+                    good_bytes += frame.len;
+                } else {
+                    false_accepts++;
+                }
+            }
+            printf("%-7s %9.0e %10llu %10.4f%% %7.2f%% %8.2f%% %14llu\n",
+                   framing == FRAMING_COBS ? "cobs" : "som", ber,
+                   (unsigned long long)flips,
+                   100.0 * good / sent.size(),
+                   100.0 * good_bytes / wire_bytes,
+                   100.0 * (wire_bytes - payload_bytes) / payload_bytes,
+                   (unsigned long long)false_accepts);
+        }
+    }
+
+    // the targeted cases feed the scanner chunk by chunk, so a shorter
+    // stream
+    vector<sent_t> short_stream(sent.begin(), sent.begin() + std::min(count, (size_t)20000));
+    targeted(short_stream);
+    return 0;
+}
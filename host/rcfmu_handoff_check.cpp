@@ -0,0 +1,147 @@
+// Self check for the firmware's lock free thread handoff primitives
+// (src/spsc_queue.h and src/seqlock.h) under real contention.
+//
+//   rcfmu_handoff_check [seconds]
+//
+// 1. spsc_queue_t: a producer pushes a counting sequence as fast as it
+//    can, the consumer checks every item arrives once and in order
+//    (drops are fine, that's the full queue policy.)
+// 2. seqlock_t: a writer publishes structs whose fields all derive
+//    from one counter, readers check every accepted copy is
+//    consistent and that versions never go backwards.
+//
+// Exits non-zero on any failure.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "seqlock.h"
+#include "spsc_queue.h"
+
+struct sample_t {
+    uint32_t seq;
+    uint32_t check;             // ~seq
+    double payload[6];
+};
+
+static int failures = 0;
+
+static void check_queue( double seconds ) {
+    spsc_queue_t<sample_t, 8> queue;
+    std::atomic<bool> done{false};
+    uint32_t produced = 0;
+
+    std::thread producer([&] {
+        while ( !done ) {
+            sample_t s;
+            s.seq = produced;
+            s.check = ~produced;
+            for ( int i = 0; i < 6; i++ ) {
+                s.payload[i] = produced * (i + 1);
+            }
+            if ( queue.push(s) ) {
+                produced++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    sample_t s;
+    while ( std::chrono::steady_clock::now() < end ) {
+        for ( int n = 0; n < 1000; n++ ) {
+            if ( !queue.pop(s) ) {
+                std::this_thread::yield();
+                continue;
+            }
+            if ( s.seq != received || s.check != ~s.seq || s.payload[5] != s.seq * 6.0 ) {
+                errors++;
+            }
+            received = s.seq + 1;
+        }
+    }
+    done = true;
+    producer.join();
+    while ( queue.pop(s) ) {
+        if ( s.seq != received ) {
+            errors++;
+        }
+        received = s.seq + 1;
+    }
+    printf("spsc_queue: %u items, %u full queue drops, high water %u/%u, %u errors\n",
+           received, queue.dropped, queue.high_water, queue.capacity(), errors);
+    if ( errors || received != produced ) {
+        failures++;
+    }
+}
+
+static void check_seqlock( double seconds ) {
+    seqlock_t<sample_t> lock;
+    std::atomic<bool> done{false};
+    uint32_t writes = 0;
+
+    std::thread writer([&] {
+        sample_t s;
+        while ( !done ) {
+            s.seq = writes;
+            s.check = ~writes;
+            for ( int i = 0; i < 6; i++ ) {
+                s.payload[i] = writes * (i + 1);
+            }
+            lock.write(s);
+            writes++;
+        }
+    });
+
+    std::atomic<uint32_t> reads{0}, misses{0}, errors{0};
+    auto reader = [&] {
+        uint32_t last = 0;
+        sample_t s;
+        while ( !done ) {
+            if ( !lock.read(s) ) {
+                misses++;
+                std::this_thread::yield();
+                continue;
+            }
+            reads++;
+            bool ok = s.check == ~s.seq && s.seq >= last;
+            for ( int i = 0; i < 6; i++ ) {
+                ok = ok && s.payload[i] == s.seq * (i + 1.0);
+            }
+            if ( !ok ) {
+                errors++;
+            }
+            last = s.seq;
+        }
+    };
+    std::thread r1(reader), r2(reader);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    done = true;
+    writer.join();
+    r1.join();
+    r2.join();
+    printf("seqlock: %u writes, %u consistent reads, %u gave up, %u torn\n",
+           writes, reads.load(), misses.load(), errors.load());
+    if ( errors || reads == 0 ) {
+        failures++;
+    }
+}
+
+int main( int argc, char **argv ) {
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    check_queue(seconds);
+    check_seqlock(seconds);
+    if ( failures ) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
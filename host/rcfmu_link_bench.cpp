@@ -0,0 +1,284 @@
+// SerialLink throughput and latency benchmark.
+//
+//   rcfmu_link_bench [--socket|--pty] [--cobs] [--seconds n] [baud ...]
+//
+// The firmware side is a real SerialLink writing the full telemetry
+// set every 10 ms frame (pilot, airdata, power, ekf and imu each frame,
+// gps at 10 hz, status at 1 hz) the way FMU.cpp does.  The host side is
+// a second SerialLink feeding the columnar decoder.  Latency is from
+// the frame_usec stamp at write to decode.
+//
+// Loopback mode first checks that a frame larger than a tx queue slot
+// and the uart buffer arrives intact and in order.
+//
+// By default the two are joined by an in-memory loopback paced at each
+// simulated baud rate (with a 4 KB uart tx buffer) on a simulated
+// clock, so the numbers are what the wire allows: frames wait in the
+// tx queue and are evicted by its drop policy exactly as on the board.  --socket and
+// --pty run the same traffic over a unix socket pair or a
+// pseudo-terminal as fast as they go, in real time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+using std::vector;
+
+#include "rcfmu_messages.h"
+#include "rcfmu_columns.h"
+#include "rcfmu_transport.h"
+#include "serial_link.h"
+
+using namespace rcfmu_message;
+
+static const uint32_t FRAME_USEC = 10000;       // 100 hz main loop
+static const uint32_t POLL_USEC = 100;          // host read interval
+
+struct stats_t {
+    uint64_t offered = 0;       // messages written
+    uint64_t dropped = 0;       // dropped or evicted by the tx queue
+    uint64_t received = 0;
+    uint64_t latency_sum = 0;
+    uint32_t latency_max = 0;
+};
+
+template <class M>
+static void send( SerialLink &link, M &msg, uint32_t now_usec, stats_t &stats ) {
+    msg.frame_usec = now_usec;
+    msg.sequence++;
+    msg.pack();
+    stats.offered++;
+    link.write_packet(msg.id, msg.payload, msg.len);
+}
+
+class telemetry_t {
+public:
+    pilot_t pilot;
+    gps_t gps;
+    airdata_t airdata;
+    power_t power;
+    status_t status;
+    ekf_t ekf;
+    imu_t imu;
+
+    telemetry_t() {
+        memset(&pilot, 0, sizeof(pilot));
+        memset(&gps, 0, sizeof(gps));
+        memset(&airdata, 0, sizeof(airdata));
+        memset(&power, 0, sizeof(power));
+        memset(&status, 0, sizeof(status));
+        memset(&ekf, 0, sizeof(ekf));
+        memset(&imu, 0, sizeof(imu));
+    }
+
+    // one main loop frame of output (imu last, as the end of frame marker)
+    void write( SerialLink &link, uint32_t frame, uint32_t now_usec, stats_t &stats ) {
+        imu.ax_mps2 = 0.01 * (frame % 100);
+        imu.az_mps2 = -9.81;
+        ekf.altitude_m = 300.0 + 0.001 * frame;
+        send(link, pilot, now_usec, stats);
+        if ( frame % 10 == 0 ) {
+            send(link, gps, now_usec, stats);
+        }
+        send(link, airdata, now_usec, stats);
+        send(link, power, now_usec, stats);
+        if ( frame % 100 == 0 ) {
+            send(link, status, now_usec, stats);
+        }
+        send(link, ekf, now_usec, stats);
+        send(link, imu, now_usec, stats);
+    }
+};
+
+// same drop policy as comms_t::init()
+static void set_priorities( SerialLink &link ) {
+    link.set_tx_priority(imu_id, TX_PRIORITY_STALE);
+    link.set_tx_priority(pilot_id, TX_PRIORITY_STALE);
+}
+
+static void receive( SerialLink &link, columnar_decoder_t &decoder,
+                     uint32_t now_usec, stats_t &stats ) {
+    while ( link.update() ) {
+        frame_t frame;
+        frame.id = link.pkt_id;
+        frame.len = link.pkt_len;
+        frame.payload = link.payload;
+        decoder.decode(frame);
+        uint32_t stamp;
+        memcpy(&stamp, link.payload, sizeof(stamp));
+        uint32_t latency = now_usec - stamp;
+        stats.received++;
+        stats.latency_sum += latency;
+        if ( latency > stats.latency_max ) {
+            stats.latency_max = latency;
+        }
+    }
+}
+
+static void report( const char *name, uint32_t baud, double secs,
+                    stats_t &stats, SerialLink &fmu, SerialLink &host ) {
+    // drops by message id from the tx queue's own accounting
+    tx_queue_t::counters_t counters[256];
+    uint8_t high_water;
+    fmu.get_tx_counters(0, 255, counters, &high_water);
+    string drops;
+    for ( int i = 0; i < 255; i++ ) {
+        if ( counters[i].dropped ) {
+            stats.dropped += counters[i].dropped;
+            drops += " " + std::to_string(i) + ":" + std::to_string(counters[i].dropped);
+        }
+    }
+    printf("%-9s %8u %9.1f %9.1f %8.2f%% %9.3f %9.3f %7u\n",
+           name, baud,
+           host.rx_bytes / secs / 1024.0,
+           stats.received / secs,
+           stats.offered ? 100.0 * stats.dropped / stats.offered : 0.0,
+           stats.received ? stats.latency_sum / 1000.0 / stats.received : 0.0,
+           stats.latency_max / 1000.0,
+           (unsigned)host.parse_errors);
+    if ( drops.length() ) {
+        printf("          dropped by id:%s (queue high water %d)\n",
+               drops.c_str(), high_water);
+    }
+}
+
+// simulated clock, paced at baud
+static void run_loopback( uint32_t baud, double seconds, serial_framing::format_t format ) {
+    uint64_t now = 0;
+    loopback_t loop([&]() { return now; });
+    SerialLink fmu, host;
+    fmu.open(baud, &loop.a, format);
+    host.open(baud, &loop.b, format);
+    set_priorities(fmu);
+    columnar_decoder_t decoder;
+    telemetry_t telemetry;
+    stats_t stats;
+    uint32_t frames = seconds * 1000000 / FRAME_USEC;
+    for ( uint32_t frame = 0; frame < frames; frame++ ) {
+        telemetry.write(fmu, frame, now, stats);
+        for ( uint32_t t = 0; t < FRAME_USEC; t += POLL_USEC ) {
+            now += POLL_USEC;
+            fmu.drain();        // the firmware io thread
+            receive(host, decoder, now, stats);
+        }
+    }
+    report("loopback", baud, seconds, stats, fmu, host);
+}
+
+// A frame larger than a tx queue slot (and than the uart buffer) goes
+// through the spill buffer and out in pieces, between its neighbours.
+static bool check_large_frame( serial_framing::format_t format ) {
+    uint64_t now = 0;
+    loopback_t loop([&]() { return now; }, 512);
+    SerialLink fmu, host;
+    fmu.open(115200, &loop.a, format);
+    host.open(115200, &loop.b, format);
+    vector<uint8_t> big(3000);
+    for ( size_t i = 0; i < big.size(); i++ ) {
+        big[i] = i * 7;
+    }
+    uint8_t small[8] = {};
+    fmu.write_packet(1, small, sizeof(small));
+    fmu.write_packet(2, big.data(), big.size());
+    fmu.write_packet(3, small, sizeof(small));
+    uint8_t expect = 1;
+    for ( int t = 0; t < 100000 && expect <= 3; t++ ) {
+        now += POLL_USEC;
+        fmu.drain();
+        while ( host.update() ) {
+            if ( host.pkt_id != expect
+                 || (expect == 2 && (host.pkt_len != big.size()
+                                     || memcmp(host.payload, big.data(), big.size()))) ) {
+                return false;
+            }
+            expect++;
+        }
+    }
+    return expect == 4;
+}
+
+// real transports, as fast as they go
+static void run_real( const char *name, serial_transport_t &a,
+                      serial_transport_t &b, uint32_t baud, double seconds,
+                      serial_framing::format_t format ) {
+    SerialLink fmu, host;
+    fmu.open(baud, &a, format);
+    host.open(baud, &b, format);
+    set_priorities(fmu);
+    columnar_decoder_t decoder;
+    telemetry_t telemetry;
+    stats_t stats;
+    uint64_t start = host_micros();
+    uint64_t end = start + seconds * 1000000;
+    uint32_t frame = 0;
+    uint64_t now;
+    while ( (now = host_micros()) < end ) {
+        telemetry.write(fmu, frame++, now, stats);
+        receive(host, decoder, host_micros(), stats);
+        if ( frame % 1000 == 0 ) {
+            decoder.clear();
+        }
+    }
+    // drain
+    uint64_t drain_end = host_micros() + 100000;
+    while ( host_micros() < drain_end ) {
+        receive(host, decoder, host_micros(), stats);
+    }
+    report(name, baud, (host_micros() - start) / 1000000.0, stats, fmu, host);
+}
+
+int main( int argc, char **argv ) {
+    enum { LOOPBACK, SOCKET, PTY } mode = LOOPBACK;
+    double seconds = 10.0;
+    serial_framing::format_t format;
+    vector<uint32_t> bauds;
+    for ( int i = 1; i < argc; i++ ) {
+        if ( !strcmp(argv[i], "--socket") ) {
+            mode = SOCKET;
+        } else if ( !strcmp(argv[i], "--pty") ) {
+            mode = PTY;
+        } else if ( !strcmp(argv[i], "--cobs") ) {
+            format.framing = serial_framing::FRAMING_COBS;
+        } else if ( !strcmp(argv[i], "--seconds") && i + 1 < argc ) {
+            seconds = atof(argv[++i]);
+        } else {
+            bauds.push_back(strtoul(argv[i], nullptr, 10));
+        }
+    }
+    if ( bauds.empty() ) {
+        if ( mode == LOOPBACK ) {
+            bauds = { 115200, 230400, 460800, 500000, 921600, 2000000 };
+        } else {
+            bauds = { 500000 };
+        }
+    }
+
+    if ( mode == LOOPBACK ) {
+        bool ok = check_large_frame(format);
+        printf("large frame through the spill buffer: %s\n", ok ? "ok" : "FAIL");
+        if ( !ok ) {
+            return 1;
+        }
+    }
+    printf("transport     baud    KB/s   msgs/s    dropped  lat avg  lat max  errors\n");
+    printf("                                               (ms)     (ms)\n");
+    for ( uint32_t baud: bauds ) {
+        if ( mode == LOOPBACK ) {
+            run_loopback(baud, seconds, format);
+        } else if ( mode == SOCKET ) {
+            unix_socket_transport_t a, b;
+            if ( !unix_socket_transport_t::pair(a, b) ) {
+                return 1;
+            }
+            run_real("socket", a, b, baud, seconds, format);
+        } else {
+            tty_transport_t a, b;
+            if ( !a.open_pty() || !b.open(a.slave_path().c_str()) ) {
+                return 1;
+            }
+            run_real("pty", a, b, baud, seconds, format);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,764 @@
+// Navigation filter covariance math: cost and heap use per step.
+//
+//   rcfmu_nav_bench [steps]
+//
+// 1. The 15 state filter's covariance time update (every imu sample)
+//    and gps measurement update (every 10th sample): as it was written
+//    for heap (dynamic) matrices, the same expressions on fixed size
+//    matrices, the noalias() evaluation into members, and what the
+//    filters use (src/nav/ekf15_cov.h): packed P with the block
+//    structured time update and the packed Joseph update, sequential
+//    scalar updates, and the UD factored form (Thornton time update,
+//    Bierman updates.)  Heap allocations per step (malloc is wrapped
+//    at link time), time and cycles per update, flops per time update,
+//    covariance storage, agreement of the packed and dense (and UD)
+//    results, and whether P stays positive definite under a float
+//    stress case.
+// 2. EKF15, EKF15_mag and EKF15_ud end to end on a synthetic stationary
+//    trajectory: time per step, measurement update cycles, heap
+//    allocations and a sanity check of the solution, with batch and
+//    sequential (scalar) measurement updates.  The two replays of the
+//    same input must agree, and innovation gating must reject
+//    injected gps outliers.  EKF15_ud must track EKF15, and each
+//    /config/nav/select must reproduce its filter through nav_mgr's
+//    selection (src/nav_filters.h.)
+//
+// Exits non-zero if a fixed size filter allocates or diverges, the
+// packed covariance math disagrees with the dense math, sequential updates
+// disagree with batch, gating doesn't help, or the batch or sequential
+// Joseph or UD covariance disagrees or loses positive definiteness.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "eigen3/Eigen/Cholesky"
+
+#include "nav/coremag.h"
+#include "nav/ekf15.h"
+#include "nav/ekf15_cov.h"
+#include "nav/ekf15_mag.h"
+#include "nav/ekf15_ud.h"
+#include "nav/nav_constants.h"
+#include "nav/nav_functions.h"
+#include "nav_filters.h"
+
+// count every heap allocation made from our objects (eigen allocates
+// with malloc, and its code is all inlined here and in the filter
+// objects)
+static unsigned long allocs = 0;
+
+extern "C" void *__real_malloc( size_t size );
+extern "C" void *__wrap_malloc( size_t size ) {
+    allocs++;
+    return __real_malloc(size);
+}
+typedef std::chrono::steady_clock clock_type;
+
+static double usec_since( clock_type::time_point start ) {
+    return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+
+// time stamp counter (reference cycles) where there is one
+static inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+typedef Eigen::Matrix<float,15,12> Matrix15x12f;
+
+// In place A = 0.5*(A+A').  (A = (A + A.transpose()) * 0.5 aliases:
+// elements below the diagonal would read already averaged values.)
+template <class M>
+inline void symmetrize(M &A) {
+    for ( int j = 1; j < A.cols(); j++ ) {
+        for ( int i = 0; i < j; i++ ) {
+            float avg = 0.5f * (A(i,j) + A(j,i));
+            A(i,j) = avg;
+            A(j,i) = avg;
+        }
+    }
+}
+
+static const float DT = 0.01;           // 100 hz
+static const int GPS_DIVIDER = 10;      // 10 hz
+static const float GRAV = 9.814;
+
+static const float RW[4] = { 0.05f * 0.05f, 0.00175f * 0.00175f,
+                             2 * 0.01f * 0.01f / 100.0f, 2 * 0.00025f * 0.00025f / 50.0f };
+
+// The error model of a tilted, rotating body, as the filter's blocks
+// and as the dense F and G (the values don't matter for cost, the
+// pattern does)
+struct jacobian_t {
+    ekf15_model_t model;
+    Matrix15f F;
+    Matrix15x12f G;
+};
+
+static void make_jacobians( jacobian_t &j ) {
+    Eigen::Matrix3f C_B2N = quat2dcm(eul2quat(0.1, -0.05, 1.2)).transpose();
+    Eigen::Vector3f f_b(0.3, -0.2, -GRAV), om_ib(0.02, -0.01, 0.05);
+    Eigen::Matrix3f I3 = Eigen::Matrix3f::Identity();
+    ekf15_model_t &m = j.model;
+    m.gs2att = -2.0f * C_B2N * sk(f_b);
+    m.gs2acc = -C_B2N;
+    m.att2att = -sk(om_ib);
+    m.gs2pos = -2 * GRAV / EarthRadius;
+    m.tau_a = 100.0f;
+    m.tau_g = 50.0f;
+    for ( int i = 0; i < 12; i++ ) {
+        m.rw(i) = RW[i / 3];
+    }
+    Matrix15f &F = j.F;
+    F.setZero();
+    F.block<3,3>(0,3) = I3;
+    F(5,2) = m.gs2pos;
+    F.block<3,3>(3,6) = m.gs2att;
+    F.block<3,3>(3,9) = m.gs2acc;
+    F.block<3,3>(6,6) = m.att2att;
+    F.block<3,3>(6,12) = -0.5f * I3;
+    F.block<3,3>(9,9) = (-1.0f / m.tau_a) * I3;
+    F.block<3,3>(12,12) = (-1.0f / m.tau_g) * I3;
+    Matrix15x12f &G = j.G;
+    G.setZero();
+    G.block<3,3>(3,0) = -C_B2N;
+    G.block<3,3>(6,3) = -0.5f * I3;
+    G.block<3,3>(9,6) = I3;
+    G.block<3,3>(12,9) = I3;
+}
+
+template <class M15, class M12, class M6>
+static void init_noise( M15 &P, M12 &Rw, M6 &R ) {
+    P.setZero();
+    float p_init[5] = { 10.0f, 1.0f, 0.34906f, 0.9810f, 0.01745f };
+    for ( int i = 0; i < 15; i++ ) {
+        P(i,i) = p_init[i / 3] * p_init[i / 3];
+    }
+    Rw.setZero();
+    for ( int i = 0; i < 12; i++ ) {
+        Rw(i,i) = RW[i / 3];
+    }
+    R.setZero();
+    float r[6] = { 9.0f, 9.0f, 36.0f, 0.25f, 0.25f, 1.0f };
+    for ( int i = 0; i < 6; i++ ) {
+        R(i,i) = r[i];
+    }
+}
+
+// the covariance math as it was, on heap matrices
+struct dynamic_cov_t {
+    Eigen::MatrixXf F, PHI, P, Qw, Q, ImKH, KRKt, I15, G, K, Rw, H, R;
+    dynamic_cov_t() : F(15,15), PHI(15,15), P(15,15), Qw(15,15), Q(15,15),
+                      ImKH(15,15), KRKt(15,15), I15(15,15), G(15,12),
+                      K(15,6), Rw(12,12), H(6,15), R(6,6) {
+        I15.setIdentity();
+        H.setZero();
+        H.topLeftCorner(6,6).setIdentity();
+        init_noise(P, Rw, R);
+    }
+    void time_update( const jacobian_t &j, float dt ) {
+        F = j.F;
+        G = j.G;
+        PHI = I15 + F * dt;
+        Qw = G * Rw * G.transpose() * dt;
+        Q = PHI * Qw;
+        Q = (Q + Q.transpose()) * 0.5;
+        P = PHI * P * PHI.transpose() + Q;
+        P = (P + P.transpose()) * 0.5;
+    }
+    void measurement_update() {
+        K = P * H.transpose() * (H * P * H.transpose() + R).inverse();
+        ImKH = I15 - K * H;
+        KRKt = K * R * K.transpose();
+        P = ImKH * P * ImKH.transpose() + KRKt;
+    }
+};
+
+// the same expressions on fixed size matrices (stack temporaries)
+struct fixed_cov_t {
+    Matrix15f F, PHI, P, Qw, Q, ImKH, KRKt, I15;
+    Matrix15x12f G;
+    Matrix15x6f K;
+    Matrix12f Rw;
+    Matrix6x15f H;
+    Matrix6f R;
+    fixed_cov_t() {
+        I15.setIdentity();
+        H.setZero();
+        H.topLeftCorner(6,6).setIdentity();
+        init_noise(P, Rw, R);
+    }
+    void time_update( const jacobian_t &j, float dt ) {
+        F = j.F;
+        G = j.G;
+        PHI = I15 + F * dt;
+        Qw = G * Rw * G.transpose() * dt;
+        Q = PHI * Qw;
+        Q = (Q + Q.transpose()).eval() * 0.5;
+        P = PHI * P * PHI.transpose() + Q;
+        P = (P + P.transpose()).eval() * 0.5;
+    }
+    void measurement_update() {
+        K = P * H.transpose() * (H * P * H.transpose() + R).inverse();
+        ImKH = I15 - K * H;
+        KRKt = K * R * K.transpose();
+        P = ImKH * P * ImKH.transpose() + KRKt;
+    }
+};
+
+// dense, noalias() into member scratch matrices (the measurement
+// update is still the filters')
+struct noalias_cov_t : fixed_cov_t {
+    Matrix15f T15;
+    Matrix15x12f T15x12;
+    Matrix15x6f PHt, KR;
+    Matrix6f S;
+    void time_update( const jacobian_t &j, float dt ) {
+        F = j.F;
+        G = j.G;
+        PHI = I15 + F * dt;
+        T15x12.noalias() = G * Rw;
+        Qw.noalias() = T15x12 * G.transpose();
+        Qw *= dt;
+        Q.noalias() = PHI * Qw;
+        symmetrize(Q);
+        T15.noalias() = PHI * P;
+        P.noalias() = T15 * PHI.transpose();
+        P += Q;
+        symmetrize(P);
+    }
+    void measurement_update() {
+        PHt.noalias() = P * H.transpose();
+        S.noalias() = H * PHt;
+        S += R;
+        K.noalias() = PHt * S.inverse();
+        ImKH = I15;
+        ImKH.noalias() -= K * H;
+        KR.noalias() = K * R;
+        KRKt.noalias() = KR * K.transpose();
+        T15.noalias() = ImKH * P;
+        P.noalias() = T15 * ImKH.transpose();
+        P += KRKt;
+    }
+};
+
+// as src/nav/ekf15.cpp: packed P, the nonzero blocks only in the time
+// update and the packed Joseph kernel in the (batch) measurement update
+struct packed_cov_t {
+    sym15_t P, P0;
+    Matrix15x6f K, PHt, W;
+    Matrix6x15f H;
+    Matrix6f R, S;
+    packed_cov_t() {
+        Matrix12f Rw;
+        H.setZero();
+        H.topLeftCorner(6,6).setIdentity();
+        init_noise(P, Rw, R);
+    }
+    void time_update( const jacobian_t &j, float dt ) {
+        ekf15_propagate(P, P0, j.model, dt);
+    }
+    void measurement_update() {
+        ekf15_pht(P, H, PHt);
+        S.noalias() = H * PHt;
+        S += R;
+        K.noalias() = PHt * S.inverse();
+        ekf15_joseph_update(P, K, H, R, PHt, W);
+    }
+};
+
+// with sequential updates (config.sequential)
+struct sequential_cov_t : packed_cov_t {
+    Vector15f x;
+    void measurement_update() {
+        x.setZero();
+        for ( int i = 0; i < 6; i++ ) {
+            ekf15_scalar_update(P, x, i, 0.0f, R(i,i), 0.0f);
+        }
+    }
+};
+
+// as src/nav/ekf15_ud.cpp: P = U*D*U', Thornton time update and
+// Bierman scalar updates
+struct ud_cov_t {
+    Matrix15f U, T15;
+    Vector15f d, x;
+    Matrix15x27f W;
+    Vector6f r;
+    ud_cov_t() {
+        Matrix15f P;
+        Matrix12f Rw;
+        Matrix6f R;
+        init_noise(P, Rw, R);
+        U.setIdentity();
+        d = P.diagonal();
+        r = R.diagonal();
+    }
+    void time_update( const jacobian_t &j, float dt ) {
+        ekf15_ud_propagate(U, d, T15, W, j.model, dt);
+    }
+    void measurement_update() {
+        x.setZero();
+        for ( int i = 0; i < 6; i++ ) {
+            ekf15_ud_scalar_update(U, d, x, i, 0.0f, r(i), 0.0f);
+        }
+    }
+};
+
+template <class C>
+static Matrix15f covariance( const C &c ) {
+    return c.P;
+}
+static Matrix15f covariance( const packed_cov_t &c ) {
+    Matrix15f P;
+    c.P.unpack(P);
+    return P;
+}
+static Matrix15f covariance( const sequential_cov_t &c ) {
+    return covariance((const packed_cov_t &)c);
+}
+static Matrix15f covariance( const ud_cov_t &c ) {
+    return c.U * c.d.asDiagonal() * c.U.transpose();
+}
+
+struct cov_result_t {
+    double time_usec;           // per time update
+    double meas_usec;           // per measurement update
+    double time_cycles;
+    double meas_cycles;
+    double allocs;              // per imu step
+    Matrix15f P;
+};
+
+template <class C>
+static cov_result_t run_cov( int steps ) {
+    C *c = new C;               // outside the counted region
+    jacobian_t j;
+    make_jacobians(j);
+    double time_usec = 0.0, meas_usec = 0.0;
+    uint64_t time_cycles = 0, meas_cycles = 0;
+    unsigned long start_allocs = allocs;
+    for ( int i = 0; i < steps; i++ ) {
+        clock_type::time_point t0 = clock_type::now();
+        uint64_t c0 = cycles();
+        c->time_update(j, DT);
+        time_cycles += cycles() - c0;
+        time_usec += usec_since(t0);
+        if ( i % GPS_DIVIDER == 0 ) {
+            t0 = clock_type::now();
+            c0 = cycles();
+            c->measurement_update();
+            meas_cycles += cycles() - c0;
+            meas_usec += usec_since(t0);
+        }
+    }
+    int updates = (steps + GPS_DIVIDER - 1) / GPS_DIVIDER;
+    cov_result_t r;
+    r.allocs = (double)(allocs - start_allocs) / steps;
+    r.time_usec = time_usec / steps;
+    r.meas_usec = meas_usec / updates;
+    r.time_cycles = (double)time_cycles / steps;
+    r.meas_cycles = (double)meas_cycles / updates;
+    r.P = covariance(*c);
+    delete c;
+    return r;
+}
+
+// Absurdly precise measurements (10 um, 2 um/s) collapse the position
+// and velocity variances by many orders of magnitude at every update,
+// a stress case for float covariance updates.  Returns
+// how many of the updates left P (as the filter holds it, factored in
+// long double) not positive definite.
+typedef Eigen::Matrix<long double,15,15> Matrix15ld;
+
+static void make_precise( packed_cov_t &c ) {
+    c.R *= 1e-11f;
+}
+static void make_precise( ud_cov_t &c ) {
+    c.r *= 1e-11f;
+}
+static Matrix15ld exact_covariance( const packed_cov_t &c ) {
+    return covariance(c).cast<long double>();
+}
+static Matrix15ld exact_covariance( const ud_cov_t &c ) {
+    Matrix15ld U = c.U.cast<long double>();
+    return U * c.d.cast<long double>().asDiagonal() * U.transpose();
+}
+
+template <class C>
+static int not_positive_definite( int steps ) {
+    C *c = new C;
+    make_precise(*c);
+    jacobian_t j;
+    make_jacobians(j);
+    int count = 0;
+    for ( int i = 0; i < steps; i++ ) {
+        c->time_update(j, DT);
+        if ( i % GPS_DIVIDER == 0 ) {
+            c->measurement_update();
+            Eigen::LLT<Matrix15ld> llt(exact_covariance(*c));
+            if ( llt.info() != Eigen::Success ) {
+                count++;
+            }
+        }
+    }
+    delete c;
+    return count;
+}
+
+// Time update flops, counted from the kernels (a multiply-add is 2)
+static int dense_time_flops() {
+    return 2 * 225                      // PHI = I + F*dt
+        + 2 * 15 * 12 * 12              // G*Rw
+        + 2 * 15 * 15 * 12 + 225        // *G'*dt
+        + 2 * 15 * 15 * 15 + 2 * 105    // Q = PHI*Qw, symmetrized
+        + 2 * 2 * 15 * 15 * 15          // PHI*P*PHI'
+        + 225 + 2 * 105;                // + Q, symmetrized
+}
+static int block_time_flops() {
+    // PHI*X for the row blocks over n columns: pos dt*vel, vel
+    // 2 3x3 blocks and the gs2pos row, att a 3x3 block and att2gyr,
+    // the biases a scale
+    struct rows {
+        static int flops( int n ) {
+            return 2 * 3 * n + (2 * 2 * 9 * n + 2 * n) + (2 * 9 * n + 2 * 3 * n) + 2 * 3 * n;
+        }
+    };
+    int phi_p = rows::flops(15);
+    int phi_t = 2 * 3 * 15 + (2 * 2 * 9 * 12 + 2 * 12) + (2 * 9 * 9 + 2 * 3 * 9)
+        + 3 * 6 + 3 * 3;                // upper block triangle only
+    int setup = 3 * 9 + 3;              // dt * blocks, I + dt*att2att
+    int q = 15 + (9 + 2 * 27)           // noise vectors, vel block
+        + 18 + 9 + 27 + 27              // pos/vel, vel/vel, vel/att, vel/acc
+        + 18 + 18 + 7 + 6 + 6;          // att/att, att/gyr, biases
+    return phi_p + phi_t + setup + q;
+}
+static int ud_time_flops() {
+    // PHI*U over each row block's nonzero columns (15, 15, 9, 6, 3)
+    int phi_u = 2 * 3 * 15 + (2 * 2 * 9 * 15 + 2 * 15) + (2 * 9 * 9 + 2 * 3 * 9)
+        + 3 * 6 + 3 * 3;
+    int setup = 3 * 9 + 3 + 4 * 9 + 9 + 12;     // dt * blocks, M*G, weights
+    // weighted Gram-Schmidt: row j's n nonzero columns (27, 27, 18,
+    // 12, 6 by row block) against each of the j rows above it
+    int mwgs = 0;
+    for ( int j = 0; j < 15; j++ ) {
+        static const int n_cols[5] = { 27, 27, 18, 12, 6 };
+        int n = n_cols[j / 3];
+        mwgs += 3 * n + 1 + j * (4 * n + 1);
+    }
+    return phi_u + setup + mwgs;
+}
+
+static void measurement_update( EKF15 *ekf, const IMUdata &imu, const GPSdata &gps ) {
+    ekf->measurement_update(gps);
+}
+static void measurement_update( EKF15_ud *ekf, const IMUdata &imu, const GPSdata &gps ) {
+    ekf->measurement_update(gps);
+}
+static void measurement_update( EKF15_mag *ekf, const IMUdata &imu, const GPSdata &gps ) {
+    ekf->measurement_update(imu, gps);
+}
+
+// nav_mgr's path to the filters (src/nav_filters.h): whichever one
+// /config/nav/select names, tuned from /config/nav
+static PropertyNode config_nav_node;
+struct selected_filter_t : nav_filters_t {
+    selected_filter_t() {
+        configure(config_nav_node);
+    }
+};
+static void measurement_update( nav_filters_t *ekf, const IMUdata &imu, const GPSdata &gps ) {
+    ekf->measurement_update(imu, gps);
+}
+
+struct nav_run_t {
+    bool sequential;
+    float gate_sigma;
+    int outlier_every;          // every n'th gps fix is 100 m off (0 = none)
+};
+
+struct nav_result_t {
+    double time_usec;           // per time update
+    double meas_cycles;         // per measurement update
+    double allocs;              // per imu step
+    uint32_t gated;
+    float max_pos_err;          // m, after the first 10 seconds
+    bool ok;
+    std::vector<NAVdata> replay; // the solution after each gps update
+};
+
+// stationary, level, facing north at 45N: noisy imu at 100 hz with a
+// small gyro bias, gps at 10 hz
+template <class EKF>
+static nav_result_t run_nav( const char *name, int steps, nav_run_t run ) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    EKF *ekf = new EKF;
+    NAVconfig config = ekf->get_config();
+    config.sequential = run.sequential;
+    config.gate_sigma = run.gate_sigma;
+    ekf->set_config(config);
+    nav_result_t r;
+    r.replay.reserve(steps / GPS_DIVIDER + 1);
+    r.max_pos_err = 0.0f;
+    IMUdata imu = {};
+    GPSdata gps = {};
+    gps.lat = 45.0;
+    gps.lon = -93.0;
+    gps.alt = 300.0;
+    gps.unix_sec = 1.7e9;
+    gps.sats = 10;
+    double field[6];
+    calc_magvar(gps.lat * D2R, gps.lon * D2R, gps.alt / 1000.0,
+                unixdate_to_julian_days(gps.unix_sec), field);
+    Eigen::Vector3f mag(field[3], field[4], field[5]);
+    mag.normalize();
+    double usec = 0.0;
+    uint64_t meas_cycles = 0;
+    int fixes = 0;
+    unsigned long start_allocs = 0;
+    NAVdata nav = {};
+    for ( int i = 0; i < steps; i++ ) {
+        imu.time = i * DT;
+        imu.p = 0.001f + 0.002f * noise(rng);
+        imu.q = -0.0005f + 0.002f * noise(rng);
+        imu.r = 0.0008f + 0.002f * noise(rng);
+        imu.ax = 0.05f * noise(rng);
+        imu.ay = 0.05f * noise(rng);
+        imu.az = -GRAV + 0.05f * noise(rng);
+        imu.hx = mag(0) + 0.01f * noise(rng);
+        imu.hy = mag(1) + 0.01f * noise(rng);
+        imu.hz = mag(2) + 0.01f * noise(rng);
+        gps.time = imu.time;
+        if ( i == 0 ) {
+            ekf->init(imu, gps);
+            start_allocs = allocs;
+            continue;
+        }
+        clock_type::time_point t0 = clock_type::now();
+        ekf->time_update(imu);
+        usec += usec_since(t0);
+        if ( i % GPS_DIVIDER == 0 ) {
+            GPSdata g = gps;
+            g.lat += 2.0 * noise(rng) / 111000.0;
+            g.lon += 2.0 * noise(rng) / 79000.0;
+            g.vn = 0.1f * noise(rng);
+            g.ve = 0.1f * noise(rng);
+            g.vd = 0.2f * noise(rng);
+            fixes++;
+            if ( run.outlier_every && fixes % run.outlier_every == 0 ) {
+                g.lat += 100.0 / 111000.0;
+            }
+            uint64_t c0 = cycles();
+            measurement_update(ekf, imu, g);
+            meas_cycles += cycles() - c0;
+            nav = ekf->get_nav();
+            r.replay.push_back(nav);
+            if ( imu.time > 10.0 ) {
+                float north_m = (nav.lat * R2D - gps.lat) * 111000.0;
+                float east_m = (nav.lon * R2D - gps.lon) * 79000.0;
+                float err = sqrt(north_m * north_m + east_m * east_m);
+                if ( err > r.max_pos_err ) {
+                    r.max_pos_err = err;
+                }
+            }
+        }
+    }
+    r.time_usec = usec / (steps - 1);
+    r.meas_cycles = (double)meas_cycles / fixes;
+    r.allocs = (double)(allocs - start_allocs) / (steps - 1);
+    r.gated = nav.gated;
+    float north_m = (nav.lat * R2D - gps.lat) * 111000.0;
+    float east_m = (nav.lon * R2D - gps.lon) * 79000.0;
+    float speed = sqrt(nav.vn * nav.vn + nav.ve * nav.ve + nav.vd * nav.vd);
+    r.ok = isfinite(nav.Pp0) && nav.Pp0 > 0.0f && isfinite(nav.Pgbz)
+        && fabs(north_m) < 10.0f && fabs(east_m) < 10.0f
+        && fabs(nav.alt - gps.alt) < 20.0f && speed < 1.0f
+        && fabs(nav.phi) < 0.1f && fabs(nav.the) < 0.1f;
+    const char *mode = !run.sequential ? "batch"
+        : run.gate_sigma > 0.0f ? "outl+gate"
+        : run.outlier_every ? "outliers" : "sequential";
+    printf("  %-10s %-10s %6.2f %8.0f %6.2f  %5.2f %5.2f %5.2f m %5.2f m  %.3f m/s %6u\n",
+           name, mode, r.time_usec, r.meas_cycles, r.allocs,
+           north_m, east_m, nav.alt - gps.alt, r.max_pos_err, speed, (unsigned)r.gated);
+    delete ekf;
+    return r;
+}
+
+// largest difference between two replays of the same input
+static void compare_replays( const char *name, const char *what,
+                             const nav_result_t &a, const nav_result_t &b,
+                             float tolerance, int &failures ) {
+    float pos_m = 0.0f, vel_mps = 0.0f, att_deg = 0.0f;
+    for ( size_t i = 0; i < a.replay.size() && i < b.replay.size(); i++ ) {
+        const NAVdata &x = a.replay[i], &y = b.replay[i];
+        pos_m = std::max(pos_m, (float)fabs((x.lat - y.lat) * R2D * 111000.0));
+        pos_m = std::max(pos_m, (float)fabs((x.lon - y.lon) * R2D * 79000.0));
+        pos_m = std::max(pos_m, (float)fabs(x.alt - y.alt));
+        vel_mps = std::max(vel_mps, std::max(fabs(x.vn - y.vn),
+                                             std::max(fabs(x.ve - y.ve), fabs(x.vd - y.vd))));
+        att_deg = std::max(att_deg, (float)(R2D * std::max(fabs(x.phi - y.phi),
+                                                          std::max(fabs(x.the - y.the),
+                                                                   fabs(x.psi - y.psi)))));
+    }
+    bool ok = pos_m < 0.01f * tolerance && vel_mps < 0.001f * tolerance
+        && att_deg < 0.1f * tolerance;
+    printf("  %-10s %s replay: max diff %.2e m %.2e m/s %.2e deg %s\n",
+           name, what, pos_m, vel_mps, att_deg, ok ? "" : " FAILED");
+    if ( !ok ) {
+        failures++;
+    }
+}
+
+// returns the sequential replay
+template <class EKF>
+static nav_result_t run_filter( const char *name, int steps, bool has_batch,
+                                int &failures ) {
+    nav_result_t batch;
+    if ( has_batch ) {
+        batch = run_nav<EKF>(name, steps, { false, 0.0f, 0 });
+    }
+    nav_result_t seq = run_nav<EKF>(name, steps, { true, 0.0f, 0 });
+    nav_result_t outl = run_nav<EKF>(name, steps, { true, 0.0f, 20 });
+    nav_result_t gated = run_nav<EKF>(name, steps, { true, 5.0f, 20 });
+    if ( has_batch ) {
+        printf("  %-10s sequential vs batch measurement update: %.1fx\n", name,
+               batch.meas_cycles / seq.meas_cycles);
+        // float rounding differs between the two, most visibly in the
+        // weakly observable yaw of a stationary EKF15
+        compare_replays(name, "batch vs sequential", batch, seq, 1.0f, failures);
+    } else {
+        batch = seq;
+    }
+    printf("  %-10s gps outliers (100 m, every 20th fix): max pos err %.2f m ungated,"
+           " %.2f m gated (%u rejected)\n", name, outl.max_pos_err,
+           gated.max_pos_err, (unsigned)gated.gated);
+    if ( batch.allocs > 0.0 || seq.allocs > 0.0 || gated.allocs > 0.0 ) {
+        printf("  FAILED: %s allocates\n", name);
+        failures++;
+    }
+    if ( !batch.ok || !seq.ok || !gated.ok ) {
+        printf("  FAILED: %s diverged\n", name);
+        failures++;
+    }
+    if ( gated.gated == 0 || gated.max_pos_err >= outl.max_pos_err ) {
+        printf("  FAILED: %s gating didn't reject the outliers\n", name);
+        failures++;
+    }
+    return seq;
+}
+
+int main( int argc, char **argv ) {
+    int steps = argc > 1 ? atoi(argv[1]) : 100000;
+    if ( steps < 2 * GPS_DIVIDER ) {
+        printf("need at least %d steps\n", 2 * GPS_DIVIDER);
+        return 1;
+    }
+    int failures = 0;
+
+    printf("15 state covariance math, %d steps (gps every %d)\n", steps, GPS_DIVIDER);
+    printf("  time update flops: dense %d, block %d (%.1fx fewer), ud %d\n",
+           dense_time_flops(), block_time_flops(),
+           (double)dense_time_flops() / block_time_flops(), ud_time_flops());
+    printf("  covariance storage: dense %d bytes, packed %d bytes (%.0f%% less);"
+           " filters: EKF15 %d, EKF15_mag %d, EKF15_ud %d bytes\n",
+           (int)sizeof(Matrix15f), (int)sizeof(sym15_t),
+           100.0 * (1.0 - (double)sizeof(sym15_t) / sizeof(Matrix15f)),
+           (int)sizeof(EKF15), (int)sizeof(EKF15_mag), (int)sizeof(EKF15_ud));
+    printf("  %-10s %10s %10s %12s %12s %12s\n", "", "time usec", "meas usec",
+           "time cycles", "meas cycles", "allocs/step");
+    cov_result_t d = run_cov<dynamic_cov_t>(steps);
+    cov_result_t f = run_cov<fixed_cov_t>(steps);
+    cov_result_t n = run_cov<noalias_cov_t>(steps);
+    cov_result_t b = run_cov<packed_cov_t>(steps);
+    cov_result_t s = run_cov<sequential_cov_t>(steps);
+    cov_result_t u = run_cov<ud_cov_t>(steps);
+    const char *names[6] = { "dynamic", "fixed", "noalias", "packed", "sequential", "ud" };
+    cov_result_t *rs[6] = { &d, &f, &n, &b, &s, &u };
+    for ( int i = 0; i < 6; i++ ) {
+        printf("  %-10s %10.3f %10.3f %12.0f %12.0f %12.2f\n", names[i],
+               rs[i]->time_usec, rs[i]->meas_usec, rs[i]->time_cycles,
+               rs[i]->meas_cycles, rs[i]->allocs);
+    }
+    printf("  time update: packed vs dynamic %.1fx, vs noalias %.1fx\n",
+           d.time_usec / b.time_usec, n.time_usec / b.time_usec);
+    printf("  measurement update: noalias vs dynamic %.1fx, packed joseph vs noalias %.1fx\n",
+           d.meas_usec / n.meas_usec, n.meas_usec / b.meas_usec);
+    printf("  ud vs sequential: time update %.2fx, measurement update %.2fx the cycles\n",
+           u.time_cycles / s.time_cycles, u.meas_cycles / s.meas_cycles);
+    if ( n.allocs > 0.0 || b.allocs > 0.0 || s.allocs > 0.0 || u.allocs > 0.0 ) {
+        printf("  FAILED: the fixed size path allocates\n");
+        failures++;
+    }
+    float diff = (b.P - n.P).cwiseAbs().maxCoeff() / n.P.cwiseAbs().maxCoeff();
+    printf("  packed vs dense P: max difference %.2e (relative to max |P|)\n", diff);
+    if ( !(diff < 1e-4f) ) {
+        printf("  FAILED: the packed covariance math disagrees\n");
+        failures++;
+    }
+    // (the ud time update's Q has an extra dt^2 term)
+    diff = (u.P - s.P).cwiseAbs().maxCoeff() / s.P.cwiseAbs().maxCoeff();
+    printf("  ud vs sequential P: max difference %.2e (relative to max |P|)\n", diff);
+    if ( !(diff < 1e-3f) ) {
+        printf("  FAILED: the ud filter's covariance disagrees\n");
+        failures++;
+    }
+    int updates = (steps + GPS_DIVIDER - 1) / GPS_DIVIDER;
+    int batch_npd = not_positive_definite<packed_cov_t>(steps);
+    int seq_npd = not_positive_definite<sequential_cov_t>(steps);
+    int ud_npd = not_positive_definite<ud_cov_t>(steps);
+    printf("  precise gps: P not positive definite after %d (batch joseph), %d (sequential),"
+           " %d (ud) of %d updates\n", batch_npd, seq_npd, ud_npd, updates);
+    if ( batch_npd > 0 ) {
+        printf("  FAILED: the batch joseph covariance (the default) isn't positive definite\n");
+        failures++;
+    }
+    if ( seq_npd > 0 ) {
+        printf("  FAILED: the sequential joseph covariance isn't positive definite\n");
+        failures++;
+    }
+    if ( ud_npd > 0 ) {
+        printf("  FAILED: the ud covariance isn't positive definite\n");
+        failures++;
+    }
+
+    printf("filters end to end, %d steps\n", steps);
+    printf("  %-10s %-10s %6s %8s %6s  %-20s %-7s  %-9s %6s\n", "", "mode",
+           "t usec", "m cycles", "allocs", "final pos err", "max err", "speed", "gated");
+    nav_result_t ekf15 = run_filter<EKF15>("EKF15", steps, true, failures);
+    nav_result_t ekf15_mag = run_filter<EKF15_mag>("EKF15_mag", steps, true, failures);
+    nav_result_t ekf15_ud = run_filter<EKF15_ud>("EKF15_ud", steps, false, failures);
+    printf("  %-10s time update vs EKF15: %.2fx the time\n", "EKF15_ud",
+           ekf15_ud.time_usec / ekf15.time_usec);
+    // the same filter, but Q differs slightly (see ekf15_cov.h)
+    compare_replays("EKF15_ud", "EKF15 vs EKF15_ud", ekf15, ekf15_ud, 10.0f, failures);
+
+    // each /config/nav/select through nav_mgr's selection and dispatch
+    // must reproduce its filter exactly
+    const char *selects[3] = { "nav15", "nav15_mag", "nav15_ud" };
+    const nav_result_t *direct[3] = { &ekf15, &ekf15_mag, &ekf15_ud };
+    config_nav_node = PropertyNode("/config/nav");
+    for ( int i = 0; i < 3; i++ ) {
+        config_nav_node.setString("select", selects[i]);
+        nav_result_t sel = run_nav<selected_filter_t>(selects[i], steps, { true, 0.0f, 0 });
+        if ( sel.replay.size() != direct[i]->replay.size() || !sel.ok ) {
+            printf("  FAILED: select %s didn't run its filter\n", selects[i]);
+            failures++;
+        }
+        compare_replays(selects[i], "select vs direct", *direct[i], sel, 1e-6f, failures);
+    }
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
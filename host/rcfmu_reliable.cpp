@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include "rcfmu_messages.h"
+#include "rcfmu_reliable.h"
+
+using namespace reliable_channel;
+
+reliable_sender_t::reliable_sender_t( write_fn_t write, uint16_t window,
+                                      uint16_t initial_seq ):
+    write(write), window(window ? window : 1), next_seq(initial_seq),
+    syn_seq(initial_seq)
+{
+}
+
+void reliable_sender_t::send( uint8_t inner_id, const uint8_t *payload,
+                              uint16_t len, uint64_t now_usec )
+{
+    rcfmu_message::reliable_data_t header;
+    header.seq = next_seq++;
+    header.flags = 0;
+    header.inner_id = inner_id;
+    header.pack();
+    entry_t e;
+    e.seq = header.seq;
+    e.sent_usec = 0;
+    e.retransmitted = false;
+    e.payload.assign(header.payload, header.payload + header.len);
+    e.payload.insert(e.payload.end(), payload, payload + len);
+    queue.push_back(e);
+    poll(now_usec);
+}
+
+void reliable_sender_t::transmit( entry_t &e, uint64_t now_usec ) {
+    // the flags byte follows the 16 bit sequence number
+    e.payload[2] = (e.seq == syn_seq) ? FLAG_SYN : 0;
+    e.sent_usec = now_usec;
+    write(rcfmu_message::reliable_data_id, e.payload.data(), e.payload.size());
+}
+
+// resend everything in flight, oldest first
+void reliable_sender_t::go_back( uint64_t now_usec ) {
+    for ( size_t i = 0; i < inflight; i++ ) {
+        queue[i].retransmitted = true;
+        transmit(queue[i], now_usec);
+        retransmits++;
+    }
+    dup_acks = 0;
+    recovering = true;
+}
+
+void reliable_sender_t::on_ack( uint16_t ack_seq, uint8_t flags,
+                                uint64_t now_usec )
+{
+    if ( flags & ACK_FLAG_RESYNC ) {
+        // the receiver has no session (it rebooted or never saw our
+        // SYN): restart the session at the oldest unacked command
+        if ( !queue.empty() && inflight ) {
+            syn_seq = queue.front().seq;
+            resyncs++;
+            go_back(now_usec);
+        }
+        return;
+    }
+    if ( queue.empty() || !inflight ) {
+        return;
+    }
+    int16_t advance = seq_diff(ack_seq, queue.front().seq);
+    if ( advance <= 0 || advance > (int16_t)inflight ) {
+        // (acks for frames that were already past the gap keep coming
+        // after a go back, only count dups again once an ack advances)
+        if ( advance == 0 && !recovering && ++dup_acks >= DUP_ACK_THRESHOLD ) {
+            fast_retransmits++;
+            go_back(now_usec);
+        }
+        return;
+    }
+    dup_acks = 0;
+    recovering = false;
+    // rtt sample from the newest acked command, unless it was resent
+    // (then we can't tell which copy is being acked)
+    const entry_t &last = queue[advance - 1];
+    if ( !last.retransmitted ) {
+        uint32_t sample = now_usec - last.sent_usec;
+        if ( srtt == 0 ) {
+            srtt = sample;
+            rttvar = sample / 2;
+        } else {
+            uint32_t err = sample > srtt ? sample - srtt : srtt - sample;
+            rttvar = (3 * rttvar + err) / 4;
+            srtt = (7 * srtt + sample) / 8;
+        }
+        rto = srtt + 4 * rttvar;
+        if ( rto < MIN_RTO_USEC ) rto = MIN_RTO_USEC;
+        if ( rto > MAX_RTO_USEC ) rto = MAX_RTO_USEC;
+    }
+    if ( flags & ACK_FLAG_REJECTED ) {
+        rejected++;             // the newest acked command wasn't applied
+    }
+    for ( int16_t i = 0; i < advance; i++ ) {
+        queue.pop_front();
+    }
+    inflight -= advance;
+    acked += advance;
+    // restart the timer for whatever is still outstanding
+    for ( size_t i = 0; i < inflight; i++ ) {
+        queue[i].sent_usec = now_usec;
+    }
+    poll(now_usec);
+}
+
+bool reliable_sender_t::on_ack( const uint8_t *payload, uint16_t len,
+                                uint64_t now_usec )
+{
+    rcfmu_message::reliable_ack_t ack;
+    if ( !ack.unpack((uint8_t *)payload, len) ) {
+        return false;
+    }
+    on_ack(ack.next_seq, ack.flags, now_usec);
+    return true;
+}
+
+void reliable_sender_t::poll( uint64_t now_usec ) {
+    if ( inflight && now_usec - queue.front().sent_usec >= rto ) {
+        timeouts++;
+        rto = rto * 2 > MAX_RTO_USEC ? MAX_RTO_USEC : rto * 2;
+        go_back(now_usec);
+    }
+    while ( inflight < queue.size() && inflight < window ) {
+        transmit(queue[inflight], now_usec);
+        inflight++;
+        sent++;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Host side sender for the reliable command channel (see
+// reliable_channel.h for the receiver and the wire protocol.)
+//
+// Commands are queued with send() and transmitted as reliable_data
+// messages, up to `window` of them unacked in flight.  A cumulative
+// reliable_ack removes everything before its next_seq.  Anything still
+// unacked after the retransmit timeout, or after three duplicate acks,
+// is resent from the oldest unacked command on (go-back-N, matching
+// the firmware's in order receiver.)  The timeout tracks the measured
+// ack round trip (smoothed rtt + 4 * rtt variance, Karn's rule, with
+// exponential backoff.)  A command the firmware's handler rejected is
+// acked like any other (resending can't help) but counted in
+// `rejected`.  Only the ack right after it carries the flag, so a lost
+// reject ack goes uncounted.
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "reliable_channel.h"
+
+class reliable_sender_t {
+public:
+    // transmit one framed message (id is always reliable_data_id)
+    typedef std::function<void(uint8_t id, const uint8_t *payload, uint16_t len)> write_fn_t;
+
+    uint64_t sent = 0;              // first transmissions
+    uint64_t retransmits = 0;
+    uint64_t timeouts = 0;
+    uint64_t fast_retransmits = 0;
+    uint64_t acked = 0;
+    uint64_t resyncs = 0;
+    uint64_t rejected = 0;          // acked with ACK_FLAG_REJECTED
+
+    // initial_seq should differ between host sessions (e.g. seed it
+    // from the clock) so the receiver can tell a new session's SYN
+    // from a retransmit of the previous one's.
+    reliable_sender_t( write_fn_t write, uint16_t window = 8,
+                       uint16_t initial_seq = 0 );
+
+    // queue a command, it goes out as soon as the window allows
+    void send( uint8_t inner_id, const uint8_t *payload, uint16_t len,
+               uint64_t now_usec );
+    // feed every received reliable_ack here
+    void on_ack( uint16_t next_seq, uint8_t flags, uint64_t now_usec );
+    bool on_ack( const uint8_t *payload, uint16_t len, uint64_t now_usec );
+    // transmit queued commands and run the retransmit timer
+    void poll( uint64_t now_usec );
+
+    size_t queued() { return queue.size(); }     // unacked + unsent
+    size_t in_flight() { return inflight; }
+    bool idle() { return queue.empty(); }
+    uint32_t rto_usec() { return rto; }
+    uint32_t srtt_usec() { return srtt; }
+
+private:
+    struct entry_t {
+        uint16_t seq;
+        uint64_t sent_usec;
+        bool retransmitted;
+        std::vector<uint8_t> payload;   // reliable_data header + command
+    };
+
+    static const uint32_t MIN_RTO_USEC = 20000;   // > one firmware frame
+    static const uint32_t MAX_RTO_USEC = 2000000;
+    static const uint8_t DUP_ACK_THRESHOLD = 3;
+
+    write_fn_t write;
+    uint16_t window;
+    uint16_t next_seq;
+    uint16_t syn_seq;
+    std::deque<entry_t> queue;      // oldest unacked first
+    size_t inflight = 0;            // queue entries transmitted so far
+    uint8_t dup_acks = 0;
+    bool recovering = false;        // went back, no ack has advanced since
+    uint32_t srtt = 0;
+    uint32_t rttvar = 0;
+    uint32_t rto = 200000;
+
+    void transmit( entry_t &e, uint64_t now_usec );
+    void go_back( uint64_t now_usec );
+};
@@ -0,0 +1,170 @@
+// Reliable command channel simulation.
+//
+//   rcfmu_reliable_sim [commands]
+//
+// Streams a config upload (64 byte commands) through the host sender
+// and the firmware's receiver over a simulated serial link: both
+// directions serialize at the link baud rate, add a fixed latency and
+// drop whole frames at random (a frame that fails its checksum).  The
+// firmware side runs at its 100 hz frame rate, handling everything
+// that arrived since the last frame and answering with one ack.
+// Checks exactly once, in order delivery (commands the handler rejects
+// are consumed and flagged, not resent) and reports completion time
+// and throughput for several window sizes and loss rates.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+using std::deque;
+using std::vector;
+
+#include "rcfmu_messages.h"
+#include "rcfmu_reliable.h"
+
+using namespace rcfmu_message;
+
+static const uint32_t BAUD = 500000;
+static const uint32_t LATENCY_USEC = 2000;      // one way (usb/uart buffering)
+static const uint32_t FRAME_USEC = 10000;       // firmware main loop
+static const uint16_t COMMAND_LEN = 64;
+static const uint32_t REJECT_EVERY = 100;       // handler rejects these
+
+struct packet_t {
+    uint64_t arrive_usec;
+    vector<uint8_t> payload;
+};
+
+// one direction of the link
+class sim_link_t {
+public:
+    uint64_t dropped = 0;
+
+    sim_link_t( double loss, uint32_t seed ): loss(loss), rng(seed) {}
+
+    void write( const uint8_t *payload, uint16_t len, uint64_t now_usec ) {
+        // som framing overhead and 10 bits per byte on the wire
+        uint64_t wire_usec = (uint64_t)(len + 7) * 10 * 1000000 / BAUD;
+        busy_usec = (busy_usec > now_usec ? busy_usec : now_usec) + wire_usec;
+        if ( uniform(rng) < loss ) {
+            dropped++;
+            return;
+        }
+        packet_t p;
+        p.arrive_usec = busy_usec + LATENCY_USEC;
+        p.payload.assign(payload, payload + len);
+        pending.push_back(p);
+    }
+    bool read( packet_t &p, uint64_t now_usec ) {
+        if ( pending.empty() || pending.front().arrive_usec > now_usec ) {
+            return false;
+        }
+        p = pending.front();
+        pending.pop_front();
+        return true;
+    }
+
+private:
+    double loss;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> uniform{0.0, 1.0};
+    uint64_t busy_usec = 0;
+    deque<packet_t> pending;
+};
+
+static void send_ack( reliable_channel::receiver_t &receiver, sim_link_t &downlink,
+                      uint64_t now ) {
+    reliable_ack_t reply;
+    reply.next_seq = receiver.next_seq;
+    reply.flags = receiver.ack_flags();
+    reply.pack();
+    downlink.write(reply.payload, reply.len, now);
+}
+
+static void run( uint32_t commands, uint16_t window, double loss ) {
+    sim_link_t uplink(loss, 1), downlink(loss, 2);
+    uint64_t now = 0;
+    reliable_sender_t sender(
+        [&](uint8_t id, const uint8_t *payload, uint16_t len) {
+            uplink.write(payload, len, now);
+        }, window, 0x1234);
+    reliable_channel::receiver_t receiver;
+
+    uint32_t queued = 0, delivered = 0, errors = 0;
+    uint8_t command[COMMAND_LEN];
+    while ( (delivered < commands || !sender.idle()) && now < 600ull * 1000000 ) {
+        // the host keeps its queue topped up and polls every 100 usec
+        while ( queued < commands && sender.queued() < window * 2u ) {
+            memset(command, 0, sizeof(command));
+            memcpy(command, &queued, sizeof(queued));
+            sender.send(config_json_id, command, sizeof(command), now);
+            queued++;
+        }
+        packet_t p;
+        while ( downlink.read(p, now) ) {
+            sender.on_ack(p.payload.data(), p.payload.size(), now);
+        }
+        sender.poll(now);
+
+        // firmware frame
+        if ( now % FRAME_USEC == 0 ) {
+            bool ack = false;
+            while ( uplink.read(p, now) ) {
+                reliable_data_t header;
+                header.unpack(p.payload.data(), p.payload.size());
+                ack = true;
+                if ( receiver.accept(header.seq, header.flags)
+                     == reliable_channel::accept_deliver ) {
+                    uint32_t index;
+                    memcpy(&index, p.payload.data() + header.len, sizeof(index));
+                    if ( index != delivered ) {
+                        errors++;
+                    }
+                    delivered++;
+                    // the handler rejects every REJECT_EVERY'th command,
+                    // acked at once so the flag isn't folded into a
+                    // later cumulative ack
+                    bool ok = index % REJECT_EVERY != REJECT_EVERY - 1;
+                    receiver.consume(ok);
+                    if ( !ok ) {
+                        send_ack(receiver, downlink, now);
+                        ack = false;
+                    }
+                }
+            }
+            if ( ack ) {
+                send_ack(receiver, downlink, now);
+            }
+        }
+        now += 100;
+    }
+    double secs = now / 1000000.0;
+    printf("%6u %6.1f%% %9.2f %10.1f %8llu %8llu %8llu %8u %s\n",
+           window, loss * 100.0, secs,
+           delivered * COMMAND_LEN / secs / 1024.0,
+           (unsigned long long)sender.retransmits,
+           (unsigned long long)sender.timeouts,
+           (unsigned long long)receiver.duplicates,
+           sender.srtt_usec() / 1000,
+           (delivered == commands && errors == 0
+            && receiver.rejected == commands / REJECT_EVERY
+            && (loss > 0.0 || sender.rejected == receiver.rejected)) ? "ok" : "FAIL");
+}
+
+int main( int argc, char **argv ) {
+    uint32_t commands = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    printf("%u x %d byte commands at %u baud, %u usec latency, %u hz firmware loop\n",
+           commands, COMMAND_LEN, BAUD, LATENCY_USEC, 1000000 / FRAME_USEC);
+    printf("window   loss  time (s)  KB/s      resent timeouts     dups srtt(ms) check\n");
+    const uint16_t windows[] = { 1, 4, 8, 32 };
+    const double losses[] = { 0.0, 0.01, 0.05 };
+    for ( double loss: losses ) {
+        for ( uint16_t window: windows ) {
+            run(commands, window, loss);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,301 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rcfmu_transport.h"
+
+uint64_t host_micros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// fd
+
+fd_transport_t::~fd_transport_t() {
+    if ( fd >= 0 ) {
+        ::close(fd);
+    }
+}
+
+void fd_transport_t::end() {
+    if ( fd >= 0 ) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool fd_transport_t::set_nonblocking() {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+uint32_t fd_transport_t::available() {
+    int count = 0;
+    if ( fd < 0 || ioctl(fd, FIONREAD, &count) < 0 ) {
+        return 0;
+    }
+    return count;
+}
+
+ssize_t fd_transport_t::read( uint8_t *buf, uint16_t count ) {
+    ssize_t n = ::read(fd, buf, count);
+    if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+        return 0;
+    }
+    return n;
+}
+
+// SerialLink writes a frame in up to three pieces after checking
+// txspace(), so finish a partial write rather than tear the frame
+size_t fd_transport_t::write( const uint8_t *buf, size_t count ) {
+    size_t total = 0;
+    while ( total < count ) {
+        ssize_t n = ::write(fd, buf + total, count - total);
+        if ( n > 0 ) {
+            total += n;
+        } else if ( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+            struct pollfd p = { fd, POLLOUT, 0 };
+            if ( poll(&p, 1, 100) <= 0 ) {
+                break;          // nobody is reading
+            }
+        } else {
+            break;
+        }
+    }
+    return total;
+}
+
+// the kernel buffer sizes aren't visible, so report room for a
+// maximum size frame whenever the descriptor is writable
+uint32_t fd_transport_t::txspace() {
+    struct pollfd p = { fd, POLLOUT, 0 };
+    if ( fd < 0 || poll(&p, 1, 0) != 1 || !(p.revents & POLLOUT) ) {
+        return 0;
+    }
+    return serial_framing::cobs_max_size(serial_framing::MAX_PAYLOAD);
+}
+
+// tty
+
+bool tty_transport_t::open_pty() {
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if ( fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0 ) {
+        perror("pty");
+        end();
+        return false;
+    }
+    slave = ptsname(fd);
+    slave_fd = ::open(slave.c_str(), O_RDWR | O_NOCTTY);
+    if ( slave_fd < 0 ) {
+        perror(slave.c_str());
+        end();
+        return false;
+    }
+    // raw mode on the slave side so bytes pass through untouched
+    struct termios tio;
+    tcgetattr(slave_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave_fd, TCSANOW, &tio);
+    return set_nonblocking();
+}
+
+bool tty_transport_t::open( const char *device ) {
+    fd = ::open(device, O_RDWR | O_NOCTTY);
+    if ( fd < 0 ) {
+        perror(device);
+        return false;
+    }
+    return set_nonblocking();
+}
+
+static speed_t baud2speed( uint32_t baud ) {
+    switch ( baud ) {
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    default: return B0;
+    }
+}
+
+bool tty_transport_t::begin( uint32_t baud ) {
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct termios tio;
+    if ( tcgetattr(fd, &tio) < 0 ) {
+        return true;            // not a tty line (pty master)
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    speed_t speed = baud2speed(baud);
+    if ( speed != B0 ) {
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+    } else {
+        fprintf(stderr, "unsupported tty baud rate: %u\n", baud);
+    }
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+void tty_transport_t::end() {
+    fd_transport_t::end();
+    if ( slave_fd >= 0 ) {
+        ::close(slave_fd);
+        slave_fd = -1;
+    }
+}
+
+// unix socket
+
+static bool unix_address( const char *path, struct sockaddr_un &addr ) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if ( strlen(path) >= sizeof(addr.sun_path) ) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+    return true;
+}
+
+bool unix_socket_transport_t::connect( const char *path ) {
+    struct sockaddr_un addr;
+    if ( !unix_address(path, addr) ) {
+        return false;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( fd < 0 || ::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ) {
+        perror(path);
+        end();
+        return false;
+    }
+    return set_nonblocking();
+}
+
+bool unix_socket_transport_t::listen( const char *path ) {
+    struct sockaddr_un addr;
+    if ( !unix_address(path, addr) ) {
+        return false;
+    }
+    unlink(path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( listen_fd < 0
+         || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+         || ::listen(listen_fd, 1) < 0 ) {
+        perror(path);
+        end();
+        return false;
+    }
+    listen_path = path;
+    return true;
+}
+
+bool unix_socket_transport_t::accept() {
+    fd = ::accept(listen_fd, nullptr, nullptr);
+    if ( fd < 0 ) {
+        perror("accept");
+        return false;
+    }
+    return set_nonblocking();
+}
+
+bool unix_socket_transport_t::pair( unix_socket_transport_t &a,
+                                    unix_socket_transport_t &b ) {
+    int fds[2];
+    if ( socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0 ) {
+        perror("socketpair");
+        return false;
+    }
+    a.fd = fds[0];
+    b.fd = fds[1];
+    return a.set_nonblocking() && b.set_nonblocking();
+}
+
+void unix_socket_transport_t::end() {
+    fd_transport_t::end();
+    if ( listen_fd >= 0 ) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        unlink(listen_path.c_str());
+    }
+}
+
+// loopback
+
+byte_pipe_t::byte_pipe_t( clock_fn_t clock, uint32_t tx_buffer_size ):
+    tx_buffer_size(tx_buffer_size), clock(clock)
+{
+}
+
+// move bytes from the (simulated) tx buffer across the wire
+void byte_pipe_t::advance() {
+    if ( delivered == written ) {
+        return;
+    }
+    if ( baud == 0 ) {
+        delivered = written;
+        return;
+    }
+    uint64_t bytes_on_wire = (clock() - wire_usec) * baud / 10000000;
+    uint64_t d = wire_start + bytes_on_wire;
+    delivered = d < written ? d : written;
+}
+
+size_t byte_pipe_t::write( const uint8_t *buf, size_t count ) {
+    advance();
+    if ( delivered == written ) {
+        // the wire was idle, it starts again now
+        wire_usec = clock();
+        wire_start = delivered;
+    }
+    if ( baud && count > txspace() ) {
+        count = txspace();
+    }
+    bytes.insert(bytes.end(), buf, buf + count);
+    written += count;
+    return count;
+}
+
+uint32_t byte_pipe_t::available() {
+    advance();
+    return delivered - consumed;
+}
+
+ssize_t byte_pipe_t::read( uint8_t *buf, uint16_t count ) {
+    uint32_t avail = available();
+    if ( count > avail ) {
+        count = avail;
+    }
+    std::copy(bytes.begin(), bytes.begin() + count, buf);
+    bytes.erase(bytes.begin(), bytes.begin() + count);
+    consumed += count;
+    return count;
+}
+
+uint32_t byte_pipe_t::txspace() {
+    advance();
+    uint64_t queued = written - delivered;
+    return queued < tx_buffer_size ? tx_buffer_size - queued : 0;
+}
+
+loopback_t::loopback_t( byte_pipe_t::clock_fn_t clock, uint32_t tx_buffer_size ):
+    a2b(clock, tx_buffer_size), b2a(clock, tx_buffer_size),
+    a(b2a, a2b), b(a2b, b2a)
+{
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// Host transports for SerialLink (see serial_transport.h.)
+//
+// * tty_transport_t: a pseudo-terminal (the slave side is a normal tty
+//   path that host software can open like the real serial port), or a
+//   real serial device.
+// * unix_socket_transport_t: a stream socket (connect, listen/accept,
+//   or a connected pair.)
+// * loopback_t: an in-memory pair of transports.  Each direction can
+//   be paced at a simulated baud rate (10 bits per byte) behind a
+//   fixed size tx buffer, like a uart, against a caller supplied
+//   clock.
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+using std::string;
+
+#include "serial_framing.h"
+#include "serial_transport.h"
+
+// any non-blocking file descriptor
+class fd_transport_t: public serial_transport_t {
+public:
+    ~fd_transport_t();
+
+    bool begin( uint32_t baud ) { return fd >= 0; }
+    void end();
+    bool is_initialized() { return fd >= 0; }
+    uint32_t available();
+    ssize_t read( uint8_t *buf, uint16_t count );
+    size_t write( const uint8_t *buf, size_t count );
+    uint32_t txspace();
+
+    int get_fd() { return fd; }
+
+protected:
+    int fd = -1;
+    bool set_nonblocking();
+};
+
+class tty_transport_t: public fd_transport_t {
+public:
+    bool open_pty();                    // see slave_path()
+    bool open( const char *device );    // a real serial port
+    bool begin( uint32_t baud );        // sets the line speed (raw 8N1)
+    void end();
+    const string &slave_path() { return slave; }
+
+private:
+    int slave_fd = -1;                  // held open so reads don't EIO
+    string slave;
+};
+
+class unix_socket_transport_t: public fd_transport_t {
+public:
+    bool connect( const char *path );
+    bool listen( const char *path );    // then accept()
+    bool accept();                      // blocks for one client
+    static bool pair( unix_socket_transport_t &a, unix_socket_transport_t &b );
+    void end();
+
+private:
+    int listen_fd = -1;
+    string listen_path;
+};
+
+// one direction of a loopback: bytes written are delivered to the
+// reader at the simulated baud rate (0 = instantly)
+class byte_pipe_t {
+public:
+    typedef std::function<uint64_t()> clock_fn_t;  // microseconds
+
+    uint32_t baud = 0;
+    uint32_t tx_buffer_size;
+    uint64_t written = 0;
+    uint64_t delivered = 0;
+
+    byte_pipe_t( clock_fn_t clock, uint32_t tx_buffer_size = 4096 );
+
+    size_t write( const uint8_t *buf, size_t count );
+    uint32_t available();
+    ssize_t read( uint8_t *buf, uint16_t count );
+    uint32_t txspace();
+    uint64_t now() { return clock(); }
+
+private:
+    clock_fn_t clock;
+    std::deque<uint8_t> bytes;          // written, not yet read
+    uint64_t consumed = 0;              // bytes read
+    uint64_t wire_usec = 0;             // time the wire went busy
+    uint64_t wire_start = 0;            // bytes delivered at wire_usec
+
+    void advance();
+};
+
+class loopback_transport_t: public serial_transport_t {
+public:
+    loopback_transport_t( byte_pipe_t &rx, byte_pipe_t &tx ): rx(rx), tx(tx) {}
+
+    bool begin( uint32_t baud ) { tx.baud = baud; return true; }
+    bool is_initialized() { return true; }
+    uint32_t available() { return rx.available(); }
+    ssize_t read( uint8_t *buf, uint16_t count ) { return rx.read(buf, count); }
+    size_t write( const uint8_t *buf, size_t count ) { return tx.write(buf, count); }
+    uint32_t txspace() { return tx.txspace(); }
+
+private:
+    byte_pipe_t &rx;
+    byte_pipe_t &tx;
+};
+
+// a connected pair: whatever a writes, b reads and vice versa.  The
+// simulated baud rate of each side is set by its begin(baud) (i.e.
+// SerialLink::open()), 0 for unpaced.
+class loopback_t {
+public:
+    byte_pipe_t a2b;
+    byte_pipe_t b2a;
+    loopback_transport_t a;
+    loopback_transport_t b;
+
+    loopback_t( byte_pipe_t::clock_fn_t clock, uint32_t tx_buffer_size = 4096 );
+};
+
+uint64_t host_micros();                 // monotonic clock
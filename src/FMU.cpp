@@ -7,6 +7,7 @@
 #include "setup_board.h"
 
 #include "airdata.h"
+#include "boot_init.h"
 #include "comms.h"
 #include "config.h"
 #include "gps_mgr.h"
@@ -17,6 +18,7 @@
 #include "pilot.h"
 #include "power.h"
 #include "props2.h"
+#include "rate_scheduler.h"
 
 const AP_HAL::HAL& hal = AP_HAL::get_HAL();
 static AP_BoardConfig BoardConfig;
@@ -60,23 +62,39 @@ static gps_mgr_t gps_mgr;
 static led_t led;
 static menu_t menu;
 static power_t power;
+static uint32_t perf_start_millis = 0;
 
 // -Wmissing-declarations requires these
 void setup();
 void loop();
+static void register_tasks();
 
-void setup() {
+// setup() steps, run by boot_init in registration order on the main
+// thread.  The order is the dependency order: config before anything
+// that reads it, comms after gps.  Gyro settling overlaps the running
+// main loop (ready_ms in the boot report.)
+
+static void init_board() {
     BoardConfig.init();         // setup any board specific drivers
     serial_manager.init();
+}
 
+static void init_console() {
     console = hal.console;
     console->begin(57600);
-    hal.scheduler->delay(2000); // give the electrons a chance to settle
-    
+    // give the electrons a chance to settle: sensor power rails come
+    // up before the drivers probe them and a usb console is enumerated
+    // by the host before the banner goes out (the console step's time
+    // in the boot profile)
+    hal.scheduler->delay(2000);
+
     console->printf("\nRice Creek UAS FMU: Rev %d\n", FIRMWARE_REV);
     console->printf("You are seeing this message on the console interface.\n");
     console->printf("Sensor/config communication is on Serial1 @ %d baud (N81) no flow control.\n", DEFAULT_BAUD);
+    console->printf("(type 'i' for the boot profile)\n");
+}
 
+static void init_config() {
     // load config from sd card
     config.init();
     if ( !config.load_json_config() ) {
@@ -88,174 +106,302 @@ void setup() {
     if ( false ) {
         config.set_serial_number(117);
     }
-    config.read_serial_number();
     console->printf("Serial Number: %d\n", config.read_serial_number());
-    hal.scheduler->delay(100);
 
     config_nav_node = PropertyNode("/config/nav"); // after config.init()
     pilot_node = PropertyNode("/pilot");
-    
-    // airdata
+}
+
+static void init_airdata() {
     airdata.init();
-    
+}
+
+static void init_airdata_sensors() {
+    airdata.calibrate();
+}
+
+static void init_imu() {
     // initialize the IMU and calibration matrices
-    console->printf("before imu_mgr.init()\n");
     imu_mgr.init();
     imu_mgr.set_strapdown_calibration();
     imu_mgr.set_accel_calibration();
     imu_mgr.set_mag_calibration();
-    
+}
+
+static void init_pilot() {
     // initialize the pilot interface (RC in, out & mixer)
     pilot.init();
+}
 
-    // initialize the gps receiver
+static void init_gps() {
     gps_mgr.init();
+}
 
-    // power sensing
+static void init_power() {
     power.init();
-    
-    // led status
+}
+
+static void init_led() {
     led.init();
+}
 
-    // ekf init (just prints availability status)
-    nav_mgr.init();
+static void init_nav() {
+    nav_mgr.init();             // ekf (prints availability status)
+}
 
-    comms.init();              // do this after gps initialization
+static void init_comms() {
+    comms.init();
+}
 
+static void init_menu() {
     menu.init();
+}
+
+void setup() {
+    boot_init.add( "board",    init_board );
+    boot_init.add( "console",  init_console );
+    boot_init.add( "config",   init_config );
+    boot_init.add( "airdata",  init_airdata );
+    boot_init.add( "air_cal",  init_airdata_sensors );
+    boot_init.add( "imu",      init_imu );
+    boot_init.add( "pilot",    init_pilot );
+    boot_init.add( "gps",      init_gps );
+    boot_init.add( "power",    init_power );
+    boot_init.add( "led",      init_led );
+    boot_init.add( "nav",      init_nav );
+    boot_init.add( "comms",    init_comms );     // after gps
+    boot_init.add( "menu",     init_menu );
+    boot_init.add( "tasks",    register_tasks );
+    boot_init.run();
+    boot_init.publish_props();
+    perf_start_millis = AP_HAL::millis();
     
+    boot_init.write_report_ascii();
     printf("Setup finished.\n");
     printf("Ready and transmitting...\n");
 }
 
-// main loop
-void loop() {
-    static uint32_t mainTimer = AP_HAL::millis();
-    static uint32_t hbTimer = AP_HAL::millis();
-    static uint32_t debugTimer = AP_HAL::millis();
-
-    static uint32_t tempTimer = AP_HAL::millis();
-    static uint32_t counter = 0;
-
-    // this is the heartbeat of the system here (DT_MILLIS)
-    // printf("%d - %d >= %d\n", AP_HAL::millis(), mainTimer, DT_MILLIS);
-    if ( AP_HAL::millis() - mainTimer >= DT_MILLIS ) {
-        if ( AP_HAL::millis() - mainTimer > DT_MILLIS ) {
-            comms.main_loop_timer_misses++;
-            mainTimer = AP_HAL::millis(); // catch up
-            if ( comms.main_loop_timer_misses % 25 == 0 ) {
-                console->printf("WARNING: main loop is not completing on time!\n");
-            }
-        } else {
-            mainTimer += DT_MILLIS;
-        }
-        counter++;
-        
-        // 1. Sense motion
-        imu_mgr.update();
+// main loop tasks (registered with the rate scheduler in setup(), in
+// run order)
+
+// 1. Sense motion
+static void task_imu() {
+    imu_mgr.update();
+    comms.begin_frame( imu_mgr.imu_micros ); // timestamp this frame's output
+    if ( !boot_init.is_ready() && imu_mgr.gyros_calibrated == 2 ) {
+        // gyros settled: the end of the boot process
+        boot_init.mark_ready();
+        boot_init.publish_props();
+        console->printf("Ready: %d msec since power on\n", (int)AP_HAL::millis());
+    }
+}
 
-        // 2. Check for gps updates
-        gps_mgr.update();
+// 2. Check for gps updates
+static void task_gps() {
+    gps_mgr.update();
+}
 
-        // 3. Estimate location and attitude
-        if ( config_nav_node.getString("selected") != "none" ) {
-            nav_mgr.update();
-        }
+// 3. Estimate location and attitude
+static void task_nav() {
+    if ( config_nav_node.getString("selected") != "none" ) {
+        nav_mgr.update();
+    }
+}
 
-        // 4. Send state to host computer
-        if ( true) {
-            comms.output_counter += comms.write_pilot_in_bin();
-            comms.output_counter += comms.write_gps_bin();
-            comms.output_counter += comms.write_airdata_bin();
-            comms.output_counter += comms.write_power_bin();
-            // do a little extra dance with the return value because
-            // write_status_info_bin() can reset comms.output_counter (but
-            // that gets ignored if we do the math in one step)
-            uint8_t result = comms.write_status_info_bin();
-            comms.output_counter += result;
-            if ( config_nav_node.getString("select") != "none" ) {
-                comms.output_counter += comms.write_nav_bin();
-            }
-            // write imu message last: used as an implicit end of data
-            // frame marker.
-            comms.output_counter += comms.write_imu_bin();
-            hal.scheduler->delay(1);
+// 4. Control: pilot and host inputs, then actuator output right after
+// estimation
+static void task_pilot_in() {
+    if ( pilot.read() ) {
+        bool ap_state = pilot_node.getBool("ap_enabled");
+        static bool last_ap_state = ap_state;
+        if ( ap_state and !last_ap_state ) {
+            console->printf("ap enabled\n");
+        } else if ( !ap_state and last_ap_state ) {
+            console->printf("ap disabled (manaul flight)\n");
         }
+        last_ap_state = ap_state;
+    }
+}
 
-        // 10hz human console output, (begins when gyros finish calibrating)
-        if ( AP_HAL::millis() - debugTimer >= 100 ) {
-            debugTimer = AP_HAL::millis();
-            if ( imu_mgr.gyros_calibrated == 2 ) {
-                menu.update();
-                if ( menu.display_pilot ) { comms.write_pilot_in_ascii(); }
-                if ( menu.display_gps ) { comms.write_gps_ascii(); }
-                if ( menu.display_airdata ) { comms.write_airdata_ascii(); }
-                if ( menu.display_imu ) { comms.write_imu_ascii(); }
-                if ( menu.display_nav ) { comms.write_nav_ascii(); }
-                if ( menu.display_nav_stats ) { comms.write_nav_stats_ascii(); }
-                if ( menu.display_act ) { comms.write_actuator_out_ascii(); }
-            }
-        }
+// read in any host commmands (config, inceptors, etc.)
+static void task_commands() {
+    comms.read_commands();
+    pilot.apply_inceptors();    // newest host inceptors only
+}
 
-        // 10 second heartbeat console output
-        if ( AP_HAL::millis() - hbTimer >= 10000 ) {
-            hbTimer = AP_HAL::millis();
-            if ( imu_mgr.gyros_calibrated == 2 ) {
-                comms.write_status_info_ascii();
-                comms.write_power_ascii();
-                float elapsed_sec = (AP_HAL::millis() - tempTimer) / 1000.0;
-                console->printf("Available mem: %d bytes\n",
-                                (unsigned int)hal.util->available_memory());
-                console->printf("Performance = %.1f hz\n", counter/elapsed_sec);
-                //PropertyNode("/").pretty_print();
-                console->printf("\n");
+static void task_pilot_out() {
+    if ( pilot.changed ) {
+        pilot.write();
+    }
+    rate_scheduler.mark_output( imu_mgr.imu_micros );
+}
+
+// 5. Send state to host computer (one task per message so each is
+// profiled on its own)
+static void task_tlm_pilot() {
+    comms.output_counter += comms.write_pilot_in_bin();
+}
+
+static void task_tlm_gps() {
+    comms.output_counter += comms.write_gps_bin();
+}
+
+static void task_tlm_airdata() {
+    comms.output_counter += comms.write_airdata_bin();
+}
+
+static void task_tlm_power() {
+    comms.output_counter += comms.write_power_bin();
+}
+
+static void task_tlm_status() {
+    // do a little extra dance with the return value because
+    // write_status_info_bin() can reset comms.output_counter (but
+    // that gets ignored if we do the math in one step)
+    int result = comms.write_status_info_bin();
+    comms.output_counter += result;
+}
+
+static void task_tlm_nav() {
+    if ( config_nav_node.getString("select") != "none" ) {
+        comms.output_counter += comms.write_nav_bin();
+    }
+}
+
+static void task_tlm_profile() {
+    comms.output_counter += comms.write_task_profile_bin();
+    comms.output_counter += comms.write_frame_timing_bin();
+}
+
+// write imu message last: used as an implicit end of data frame
+// marker.
+static void task_tlm_imu() {
+    comms.output_counter += comms.write_imu_bin();
+}
+
+// (telemetry thread) snapshot this frame's messages, the thread packs
+// and writes them
+static void task_tlm_snapshot() {
+    comms.queue_telemetry( config_nav_node.getString("select") != "none" );
+}
+
+static void task_airdata() {
+    airdata.update();
+}
+
+// read power values
+static void task_power() {
+    power.update();
+}
+
+// blink the led
+static void task_led() {
+    led.do_policy(imu_mgr.gyros_calibrated);
+    led.update();
+}
+
+// human console output, (begins when gyros finish calibrating)
+static void task_console() {
+    if ( imu_mgr.gyros_calibrated == 2 ) {
+        menu.update();
+        if ( menu.display_pilot ) { comms.write_pilot_in_ascii(); }
+        if ( menu.display_gps ) { comms.write_gps_ascii(); }
+        if ( menu.display_airdata ) { comms.write_airdata_ascii(); }
+        if ( menu.display_imu ) { comms.write_imu_ascii(); }
+        if ( menu.display_nav ) { comms.write_nav_ascii(); }
+        if ( menu.display_nav_stats ) { comms.write_nav_stats_ascii(); }
+        if ( menu.display_act ) { comms.write_actuator_out_ascii(); }
+    }
+}
+
+// 10 second heartbeat console output
+static void task_heartbeat() {
+    if ( imu_mgr.gyros_calibrated == 2 ) {
+        comms.write_status_info_ascii();
+        comms.write_power_ascii();
+        float elapsed_sec = (AP_HAL::millis() - perf_start_millis) / 1000.0;
+        console->printf("Available mem: %d bytes\n",
+                        (unsigned int)hal.util->available_memory());
+        console->printf("Performance = %.1f hz\n",
+                        rate_scheduler.frame_count / elapsed_sec);
+        rate_scheduler.write_overruns_ascii();
+        //PropertyNode("/").pretty_print();
+        console->printf("\n");
 
 #if 0
-                // system info
-                ExpandingString dma_info {};
-                ExpandingString mem_info {};
-                ExpandingString uart_info {};
-                ExpandingString thread_info {};
-                hal.util->dma_info(dma_info);
-                hal.util->mem_info(mem_info);
-                hal.util->uart_info(uart_info);
-                hal.util->thread_info(thread_info);
-                console->printf("dma info:\n%s\n", dma_info.get_string());
-                console->printf("mem info:\n%s\n", mem_info.get_string());
-                console->printf("uart info:\n%s\n", uart_info.get_string());
-                // console->printf("thread info:\n%s\n", thread_info.get_string());
+        // system info
+        ExpandingString dma_info {};
+        ExpandingString mem_info {};
+        ExpandingString uart_info {};
+        ExpandingString thread_info {};
+        hal.util->dma_info(dma_info);
+        hal.util->mem_info(mem_info);
+        hal.util->uart_info(uart_info);
+        hal.util->thread_info(thread_info);
+        console->printf("dma info:\n%s\n", dma_info.get_string());
+        console->printf("mem info:\n%s\n", mem_info.get_string());
+        console->printf("uart info:\n%s\n", uart_info.get_string());
+        // console->printf("thread info:\n%s\n", thread_info.get_string());
 #endif
-            }
-        }
-        
-        // airdata
-        airdata.update();
-
-        // read power values
-        power.update();
-
-        if ( pilot.read() ) {
-            bool ap_state = pilot_node.getBool("ap_enabled");
-            static bool last_ap_state = ap_state;
-            if ( ap_state and !last_ap_state ) {
-                console->printf("ap enabled\n");
-            } else if ( !ap_state and last_ap_state ) {
-                console->printf("ap disabled (manaul flight)\n");
-            }
-            last_ap_state = ap_state;
-        }
+    }
+}
+
+// per task timing under /performance/tasks
+static void task_perf_props() {
+    rate_scheduler.publish_props();
+}
 
-        // read in any host commmands (config, inceptors, etc.)
-        comms.read_commands();
+// Only the sense -> estimate -> control -> actuate chain (and reading
+// host commands, which feed control) is critical.  Telemetry and the
+// airdata/power reads are deferrable: a late message or reading costs
+// the host one frame of freshness, it doesn't change what the vehicle
+// does this frame.  The telemetry messages share one priority so they
+// keep their order (imu last, the end of frame marker); status and the
+// task profile are housekeeping and go after everything else.
+static void register_tasks() {
+    //                       name           function          hz         priority       budget (usec)
+    rate_scheduler.add_task( "imu",         task_imu,         MASTER_HZ, TASK_CRITICAL, 1000 );
+    rate_scheduler.add_task( "gps",         task_gps,         MASTER_HZ, TASK_CRITICAL, 500 );
+    rate_scheduler.add_task( "nav",         task_nav,         MASTER_HZ, TASK_CRITICAL, 3000 );
+    rate_scheduler.add_task( "pilot_in",    task_pilot_in,    MASTER_HZ, TASK_CRITICAL, 300 );
+    rate_scheduler.add_task( "commands",    task_commands,    MASTER_HZ, TASK_CRITICAL, 1000 );
+    rate_scheduler.add_task( "pilot_out",   task_pilot_out,   MASTER_HZ, TASK_CRITICAL, 300 );
+    if ( comms.telemetry_threaded() ) {
+        rate_scheduler.add_task( "tlm_snapshot", task_tlm_snapshot, MASTER_HZ, TASK_HIGH, 1000 );
+    } else {
+        rate_scheduler.add_task( "tlm_pilot",   task_tlm_pilot,   MASTER_HZ, TASK_HIGH,     200 );
+        rate_scheduler.add_task( "tlm_gps",     task_tlm_gps,     MASTER_HZ, TASK_HIGH,     200 );
+        rate_scheduler.add_task( "tlm_airdata", task_tlm_airdata, MASTER_HZ, TASK_HIGH,     200 );
+        rate_scheduler.add_task( "tlm_power",   task_tlm_power,   MASTER_HZ, TASK_HIGH,     200 );
+        rate_scheduler.add_task( "tlm_status",  task_tlm_status,  MASTER_HZ, TASK_LOW,      300 );
+        rate_scheduler.add_task( "tlm_nav",     task_tlm_nav,     MASTER_HZ, TASK_HIGH,     300 );
+        rate_scheduler.add_task( "tlm_profile", task_tlm_profile, MASTER_HZ, TASK_LOW,      200 );
+        rate_scheduler.add_task( "tlm_imu",     task_tlm_imu,     MASTER_HZ, TASK_HIGH,     200 );
+    }
+    rate_scheduler.add_task( "airdata",     task_airdata,     MASTER_HZ, TASK_NORMAL,   300 );
+    rate_scheduler.add_task( "power",       task_power,       MASTER_HZ, TASK_NORMAL,   200 );
+    rate_scheduler.add_task( "led",         task_led,         MASTER_HZ, TASK_NORMAL,   100 );
+    rate_scheduler.add_task( "console",     task_console,     10,        TASK_LOW,      2000 );
+    rate_scheduler.add_task( "heartbeat",   task_heartbeat,   0.1,       TASK_LOW,      3000 );
+    rate_scheduler.add_task( "perf_props",  task_perf_props,  1,         TASK_LOW,      1500 );
+}
 
-        if ( pilot.changed ) {
-            pilot.write();
+// main loop: each frame is triggered by the arrival of an INS sample
+// (the INS runs at MASTER_HZ and we sleep until it has data), so
+// sensor to actuator latency is short and constant.
+void loop() {
+    static uint32_t last_sample_usec = 0;
+
+    uint32_t sample_usec = imu_mgr.wait_for_sample();
+    if ( last_sample_usec && sample_usec - last_sample_usec > DT_MICROS * 3 / 2 ) {
+        // missed at least one sample
+        comms.main_loop_timer_misses++;
+        if ( comms.main_loop_timer_misses % 25 == 0 ) {
+            console->printf("WARNING: main loop is not completing on time!\n");
         }
-
-        // blink the led
-        led.do_policy(imu_mgr.gyros_calibrated);
-        led.update();
     }
+    last_sample_usec = sample_usec;
+    rate_scheduler.run_frame( sample_usec );
 }
 
 AP_HAL_MAIN();
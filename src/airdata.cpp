@@ -8,7 +8,10 @@ void airdata_t::init() {
     error_count = 0;
     ready = false;
     airdata_node.setUInt("error_count", error_count);
+}
 
+// sensor bring up and zero pressure calibration (its own boot step)
+void airdata_t::calibrate() {
     console->printf("Initializing & calibrating airspeed...\n");
     // can't, private: airspeed.param[0].type = TYPE_I2C_MS5525;
     airspeed.init();
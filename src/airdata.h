@@ -21,5 +21,6 @@ private:
 public:
 
     void init();
+    void calibrate();
     void update();
 };
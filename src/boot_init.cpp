@@ -0,0 +1,68 @@
+#include "setup_board.h"
+
+#include "boot_init.h"
+#include "props2.h"
+
+void boot_init_t::add( const char *name, boot_fn_t fn ) {
+    if ( num_steps >= MAX_STEPS ) {
+        AP_HAL::panic("boot: too many steps (MAX_STEPS = %d) at %s",
+                      MAX_STEPS, name);
+    }
+    step_t &s = steps[num_steps++];
+    s.name = name;
+    s.fn = fn;
+    s.start_usec = s.end_usec = 0;
+}
+
+void boot_init_t::run() {
+    begin_usec = AP_HAL::micros();
+    for ( uint8_t i = 0; i < num_steps; i++ ) {
+        step_t &s = steps[i];
+        s.start_usec = AP_HAL::micros();
+        s.fn();
+        s.end_usec = AP_HAL::micros();
+    }
+    finish_usec = AP_HAL::micros();
+}
+
+void boot_init_t::mark_ready() {
+    ready_usec = AP_HAL::micros();
+}
+
+void boot_init_t::write_report_ascii() {
+    console->printf("Boot profile (msec since power on)\n");
+    console->printf("  name         start    end   msec\n");
+    uint32_t total_usec = 0;
+    for ( uint8_t i = 0; i < num_steps; i++ ) {
+        step_t &s = steps[i];
+        uint32_t usec = s.end_usec - s.start_usec;
+        total_usec += usec;
+        console->printf("  %-10s %7d %6d %6d\n", s.name,
+                        (int)(s.start_usec / 1000), (int)(s.end_usec / 1000),
+                        (int)(usec / 1000));
+    }
+    console->printf("  init: %d msec elapsed for %d msec of steps\n",
+                    (int)((finish_usec - begin_usec) / 1000),
+                    (int)(total_usec / 1000));
+    if ( ready_usec ) {
+        console->printf("  ready at %d msec\n", (int)(ready_usec / 1000));
+    } else {
+        console->printf("  not ready yet\n");
+    }
+}
+
+void boot_init_t::publish_props() {
+    PropertyNode boot_node("/performance/boot");
+    for ( uint8_t i = 0; i < num_steps; i++ ) {
+        step_t &s = steps[i];
+        PropertyNode node = boot_node.getChild(s.name);
+        node.setUInt("start_ms", s.start_usec / 1000);
+        node.setUInt("duration_ms", (s.end_usec - s.start_usec) / 1000);
+    }
+    boot_node.setUInt("init_start_ms", begin_usec / 1000);
+    boot_node.setUInt("init_end_ms", finish_usec / 1000);
+    boot_node.setUInt("ready_ms", ready_usec / 1000);
+}
+
+// global shared instance
+boot_init_t boot_init;
@@ -0,0 +1,47 @@
+// Subsystem initialization steps and boot profiler
+
+#pragma once
+
+#include <stdint.h>
+
+// setup() registers each init step in the order it must run and run()
+// executes them one after another on the main thread.  Every step's
+// start and end time (since power on) is recorded for the boot report,
+// along with the time the system is "ready" (set by the caller, e.g.
+// once the gyros have settled.)
+
+typedef void (*boot_fn_t)();
+
+class boot_init_t {
+
+public:
+
+    static const uint8_t MAX_STEPS = 16;
+
+    struct step_t {
+        const char *name;
+        boot_fn_t fn;
+        uint32_t start_usec;
+        uint32_t end_usec;
+    };
+
+    // more than MAX_STEPS is a programming error and panics
+    void add( const char *name, boot_fn_t fn );
+    void run();
+
+    void mark_ready();
+    bool is_ready() { return ready_usec > 0; }
+
+    void write_report_ascii();
+    void publish_props();       // under /performance/boot
+
+private:
+
+    step_t steps[MAX_STEPS];
+    uint8_t num_steps = 0;
+    uint32_t begin_usec = 0;    // entered run()
+    uint32_t finish_usec = 0;   // every step done
+    uint32_t ready_usec = 0;
+};
+
+extern boot_init_t boot_init;
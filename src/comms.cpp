@@ -9,10 +9,8 @@
 #include "setup_board.h"
 
 #include "airdata.h"
-#include "imu_mgr.h"            // reset gyros
-#include "nav_mgr.h"            // reset ekf
-#include "pilot.h"              // update_ap()
 #include "nav/nav_constants.h"
+#include "rate_scheduler.h"
 #include "serial_link.h"
 #include "rcfmu_messages.h"
 
@@ -20,6 +18,21 @@
 
 #include <AP_HAL/AP_HAL.h>
 
+// echo replies immediately so the host can measure round trip time
+// and our clock offset (rx/tx stamps bracket our own latency)
+static bool handle_echo( uint8_t *buf, uint16_t message_size ) {
+    uint64_t rx_usec = AP_HAL::micros64();
+    static rcfmu_message::command_echo_t echo;
+    echo.unpack(buf, message_size);
+    comms.write_echo_reply_bin( echo.host_usec, echo.sequence, rx_usec );
+    return true;
+}
+
+// reliable_data wraps another command with a sequence number
+static bool handle_reliable_data( uint8_t *buf, uint16_t message_size ) {
+    return comms.parse_reliable_bin( buf, message_size );
+}
+
 void comms_t::init() {
     config_node = PropertyNode("/config");
     effector_node = PropertyNode("/effectors");
@@ -30,52 +43,248 @@ void comms_t::init() {
     power_node = PropertyNode("/sensors/power");
     pilot_node = PropertyNode("/pilot");
     
-    // serial.open(DEFAULT_BAUD, hal.serial(0)); // usb/console
-    serial.open(DEFAULT_BAUD, hal.serial(1)); // telemetry 1
-    // serial.open(DEFAULT_BAUD, hal.serial(2)); // telemetry 2
+    // Output ports: /config/comms/ports/<name> gives each port's
+    // serial number, baud, link format and message rates (hz.)
+    // Without a ports section a single port on serial 1 sends
+    // everything with the link format from /config/comms.
+    PropertyNode config_comms_node = config_node.getChild("comms");
+    PropertyNode ports_node = config_comms_node.getChild("ports", false);
+    if ( !ports_node.isNull() ) {
+        vector<string> names = ports_node.getChildren();
+        for ( unsigned int i = 0; i < names.size(); i++ ) {
+            open_port( names[i].c_str(), ports_node.getChild(names[i].c_str()) );
+        }
+    }
+    if ( num_ports == 0 ) {
+        open_port( "telemetry1", config_comms_node );
+    }
+
+    // pack and write telemetry off the control thread
+    if ( config_comms_node.getBool("thread") ) {
+        start_telemetry_thread();
+    }
+
+    register_handler( rcfmu_message::command_echo_id,
+                      rcfmu_message::command_echo_t::len, handle_echo );
+    register_handler( rcfmu_message::reliable_data_id, ANY_SIZE,
+                      handle_reliable_data );
 }
 
-bool comms_t::parse_message_bin( uint8_t id, uint8_t *buf, uint8_t message_size )
-{
-    bool result = false;
+// default telemetry rates (hz), a port's "rates" section replaces the
+// whole set
+struct telemetry_rate_t {
+    const char *name;
+    uint8_t id;
+    uint16_t hz;
+};
+static const telemetry_rate_t default_rates[] = {
+    { "pilot", rcfmu_message::pilot_id, MASTER_HZ },
+    { "gps", rcfmu_message::gps_id, MASTER_HZ },    // (when new)
+    { "airdata", rcfmu_message::airdata_id, MASTER_HZ },
+    { "power", rcfmu_message::power_id, MASTER_HZ },
+    { "status", rcfmu_message::status_id, 1 },
+    { "ekf", rcfmu_message::ekf_id, MASTER_HZ },
+    { "imu", rcfmu_message::imu_id, MASTER_HZ },
+    { "task_profile", rcfmu_message::task_profile_id, 10 }, // (one task each)
+    { "frame_timing", rcfmu_message::frame_timing_id, 4 },
+};
+
+bool comms_t::open_port( const char *name, PropertyNode port_node ) {
+    static_assert(sizeof(port_t) + SerialLink::SPILL_SIZE <= PORT_RAM_BUDGET,
+                  "comms port RAM budget");
+    if ( num_ports >= MAX_PORTS ) {
+        console->printf("comms: too many ports, skipping: %s\n", name);
+        return false;
+    }
 
-    // console->print("message id = "); console->print(id); console->print(" len = "); console->println(message_size);
-    
-    if ( id == rcfmu_message::command_inceptors_id ) {
-        static rcfmu_message::command_inceptors_t inceptors;
-        inceptors.unpack(buf, message_size);
-        if ( message_size == inceptors.len ) {
-            pilot.update_ap(&inceptors);
-            result = true;
+    // link format: framing "som" (default) or "cobs", checksum
+    // "fletcher16" (default), "fletcher32" or "crc32c"
+    serial_framing::format_t format;
+    if ( port_node.getString("framing") == "cobs" ) {
+        format.framing = serial_framing::FRAMING_COBS;
+    }
+    string checksum = port_node.getString("checksum");
+    if ( checksum == "fletcher32" ) {
+        format.checksum = serial_checksum::CHECKSUM_FLETCHER32;
+    } else if ( checksum == "crc32c" ) {
+        format.checksum = serial_checksum::CHECKSUM_CRC32C;
+    }
+    // serial 0 = usb/console, 1 = telemetry 1, 2 = telemetry 2
+    uint8_t serial_num = port_node.hasChild("serial") ? port_node.getUInt("serial") : 1;
+    uint32_t baud = port_node.hasChild("baud") ? port_node.getUInt("baud") : DEFAULT_BAUD;
+
+    port_t *port = new port_t;
+    if ( port == nullptr ) {
+        return false;
+    }
+    port->name = name;
+    port->baud = baud;
+    port->reliable_ack_pending = false;
+    memset(port->divider, 0, sizeof(port->divider));
+    PropertyNode rates_node = port_node.getChild("rates", false);
+    for ( unsigned int i = 0; i < sizeof(default_rates) / sizeof(telemetry_rate_t); i++ ) {
+        const telemetry_rate_t &r = default_rates[i];
+        float hz = rates_node.isNull() ? r.hz : rates_node.getDouble(r.name);
+        if ( hz > 0.0 ) {
+            int divider = MASTER_HZ / hz + 0.5;
+            port->divider[r.id] = divider < 1 ? 1 : (divider > 255 ? 255 : divider);
         }
-    // example of receiving a config message, doing something, and
-    // replying with an ack
-    // } else if ( id == rcfmu_message::config_airdata_id ) {
-    //     config.airdata_cfg.unpack(buf, message_size);
-    //     if ( message_size == config.airdata_cfg.len ) {
-    //         console->printf("received new airdata config\n");
-    //         console->printf("Swift barometer on I2C: 0x%X\n",
-    //                         config.airdata_cfg.swift_baro_addr);
-    //         config.write_storage();
-    //         write_ack_bin( id, 0 );
-    //         result = true;
-    //     }
-    } else if ( id == rcfmu_message::command_zero_gyros_id && message_size == 1 ) {
-        console->printf("received zero gyros command\n");
-        imu_mgr.gyros_calibrated = 0;   // start state
-        write_ack_bin( id, 0 );
-        result = true;
-    } else if ( id == rcfmu_message::command_reset_ekf_id && message_size == 1 ) {
-        console->printf("received reset ekf command\n");
-        nav_mgr.reinit();
-        write_ack_bin( id, 0 );
-        result = true;
-    } else {
+    }
+
+    console->printf("comms port %s: serial %d\n", name, serial_num);
+    port->link.open( baud, hal.serial(serial_num), format );
+
+    // tx queue drop policy: a newer imu/pilot frame is always on the
+    // way, command replies must get through
+    port->link.set_tx_priority( rcfmu_message::imu_id, TX_PRIORITY_STALE );
+    port->link.set_tx_priority( rcfmu_message::pilot_id, TX_PRIORITY_STALE );
+    port->link.set_tx_priority( rcfmu_message::command_ack_id, TX_PRIORITY_NEVER_DROP );
+    port->link.set_tx_priority( rcfmu_message::echo_reply_id, TX_PRIORITY_NEVER_DROP );
+    port->link.set_tx_priority( rcfmu_message::reliable_ack_id, TX_PRIORITY_NEVER_DROP );
+
+    ports[num_ports++] = port;
+    return true;
+}
+
+void comms_t::begin_frame( uint32_t imu_usec ) {
+    frame_usec = imu_usec;
+    frame_count++;
+}
+
+// true if any port sends this message id in the current frame (so the
+// message isn't assembled and packed for nobody)
+bool comms_t::due( uint8_t id ) {
+    for ( uint8_t i = 0; i < num_ports; i++ ) {
+        uint8_t d = ports[i]->divider[id];
+        if ( d && frame_count % d == 0 ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// write one packed payload to every port that wants it in the given
+// frame (the telemetry thread sends a frame after the loop moves on)
+int comms_t::publish( uint8_t id, uint8_t *payload, uint16_t len, uint32_t frame ) {
+    int result = 0;
+    for ( uint8_t i = 0; i < num_ports; i++ ) {
+        uint8_t d = ports[i]->divider[id];
+        if ( d && frame % d == 0 ) {
+            result += ports[i]->link.write_packet( id, payload, len );
+        }
+    }
+    return result;
+}
+
+int comms_t::reply( uint8_t id, uint8_t *payload, uint16_t len ) {
+    if ( rx_port >= num_ports ) {
+        return 0;
+    }
+    return ports[rx_port]->link.write_packet( id, payload, len );
+}
+
+bool comms_t::register_handler( uint8_t id, uint16_t expected_size,
+                                message_handler_t handler, bool ack )
+{
+    if ( handlers[id].handler != nullptr ) {
+        console->printf("comms: replacing handler for message id: %d\n", id);
+    }
+    handler_entry_t &h = handlers[id];
+    h.handler = handler;
+    h.expected_size = expected_size;
+    h.ack = ack;
+    h.count = h.size_errors = h.total_usec = h.max_usec = 0;
+    return true;
+}
+
+bool comms_t::parse_message_bin( uint8_t id, uint8_t *buf, uint16_t message_size )
+{
+    handler_entry_t &h = handlers[id];
+    if ( h.handler == nullptr ) {
+        unknown_messages++;
         console->printf("unknown message id: %d len: %d\n", id, message_size);
+        return false;
+    }
+    if ( h.expected_size != ANY_SIZE && message_size != h.expected_size ) {
+        h.size_errors++;
+        return false;
+    }
+    uint32_t start_usec = AP_HAL::micros();
+    bool result = h.handler( buf, message_size );
+    uint32_t elapsed_usec = AP_HAL::micros() - start_usec;
+    h.count++;
+    h.total_usec += elapsed_usec;
+    if ( elapsed_usec > h.max_usec ) {
+        h.max_usec = elapsed_usec;
+    }
+    if ( result && h.ack ) {
+        write_ack_bin( id, 0 );
     }
     return result;
 }
 
+// unwrap a reliable_data message and dispatch the inner command if it
+// is the next one in sequence.  Duplicates (a retransmit of something
+// we already have, usually because our ack was lost) and frames past
+// a gap are dropped, and every arrival is answered with a cumulative
+// ack so the sender can advance or go back.
+bool comms_t::parse_reliable_bin( uint8_t *buf, uint16_t message_size ) {
+    static rcfmu_message::reliable_data_t header;
+    if ( !header.unpack(buf, message_size) ) {
+        return false;
+    }
+    port_t *port = ports[rx_port];
+    port->reliable_ack_pending = true;
+    reliable_channel::accept_t result = port->reliable_rx.accept(header.seq, header.flags);
+    if ( result != reliable_channel::accept_deliver ) {
+        return false;
+    }
+    // the inner command keeps its own size check and (optional) ack,
+    // the sequence only advances once it has been handled.  A rejected
+    // command is consumed (resending can't help) and acked right away
+    // with ACK_FLAG_REJECTED, before a later command can fold it into
+    // the cumulative ack.
+    bool ok = false;
+    if ( header.inner_id != rcfmu_message::reliable_data_id ) { // no nesting
+        ok = parse_message_bin( header.inner_id, buf + header.len,
+                                message_size - header.len );
+    }
+    port->reliable_rx.consume(ok);
+    if ( !ok ) {
+        write_reliable_ack_bin( port );
+        port->reliable_ack_pending = false;
+    }
+    return ok;
+}
+
+int comms_t::write_reliable_ack_bin( port_t *port ) {
+    static rcfmu_message::reliable_ack_t ack;
+    ack.next_seq = port->reliable_rx.next_seq;
+    ack.flags = port->reliable_rx.ack_flags();
+    ack.pack();
+    return port->link.write_packet( ack.id, ack.payload, ack.len );
+}
+
+void comms_t::write_handler_stats_ascii() {
+    console->printf("Message handlers (unknown ids: %d)\n", (int)unknown_messages);
+    for ( int i = 0; i < 256; i++ ) {
+        handler_entry_t &h = handlers[i];
+        if ( h.handler == nullptr ) {
+            continue;
+        }
+        console->printf("  id: %3d count: %6d size errors: %4d avg: %.1f max: %d (usec)\n",
+                        i, (int)h.count, (int)h.size_errors,
+                        h.count ? (float)h.total_usec / h.count : 0.0,
+                        (int)h.max_usec);
+    }
+    for ( uint8_t i = 0; i < num_ports; i++ ) {
+        reliable_channel::receiver_t &r = ports[i]->reliable_rx;
+        console->printf("Port %s: parse errors: %d reliable next seq: %d delivered: %d duplicates: %d out of order: %d sessions: %d\n",
+                        ports[i]->name.c_str(), (int)ports[i]->link.parse_errors,
+                        r.next_seq, (int)r.delivered, (int)r.duplicates,
+                        (int)r.out_of_order, (int)r.sessions);
+    }
+}
 
 // output an acknowledgement of a message received
 int comms_t::write_ack_bin( uint8_t command_id, uint8_t subcommand_id )
@@ -84,7 +293,21 @@ int comms_t::write_ack_bin( uint8_t command_id, uint8_t subcommand_id )
     ack.command_id = command_id;
     ack.subcommand_id = subcommand_id;
     ack.pack();
-    return serial.write_packet( ack.id, ack.payload, ack.len);
+    return reply( ack.id, ack.payload, ack.len );
+}
+
+
+// answer a host echo request with our receive and transmit timestamps
+int comms_t::write_echo_reply_bin( uint64_t host_usec, uint16_t sequence,
+                                   uint64_t rx_usec )
+{
+    static rcfmu_message::echo_reply_t reply;
+    reply.host_usec = host_usec;
+    reply.sequence = sequence;
+    reply.rx_usec = rx_usec;
+    reply.tx_usec = AP_HAL::micros64();
+    reply.pack();
+    return comms_t::reply( reply.id, reply.payload, reply.len );
 }
 
 
@@ -92,17 +315,23 @@ int comms_t::write_ack_bin( uint8_t command_id, uint8_t subcommand_id )
 int comms_t::write_pilot_in_bin()
 {
     static rcfmu_message::pilot_t pilot1;
+    return fill_pilot_in(pilot1) ? send(pilot1, frame_count) : 0;
+}
 
-    // receiver data
-    for ( int i = 0; i < rcfmu_message::sbus_channels; i++ ) {
-        pilot1.channel[i] = pilot_node.getDouble("manual", i);
+bool comms_t::fill_pilot_in( rcfmu_message::pilot_t &pilot1 )
+{
+    if ( !due(rcfmu_message::pilot_id) ) {
+        return false;
     }
 
-    // flags
-    pilot1.flags = pilot_node.getBool("failsafe");
-    
-    pilot1.pack();
-    return serial.write_packet( pilot1.id, pilot1.payload, pilot1.len);
+    // receiver data and flags
+    static const char *const names[] = {
+        nullptr, nullptr, "manual", "failsafe"
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::pilot_t> pilot_binding(pilot_node, names);
+    pilot_binding.props2msg(pilot1);
+    stamp(pilot1);
+    return true;
 }
 
 void comms_t::write_pilot_in_ascii()
@@ -145,10 +374,25 @@ static inline int32_t intround(float f) {
 int comms_t::write_imu_bin()
 {
     static rcfmu_message::imu_t imu1;
-    imu1.props2msg(imu_node);
-    imu1.pack();
-    int result = serial.write_packet( imu1.id, imu1.payload, imu1.len );
-    return result;
+    return fill_imu(imu1) ? send(imu1, frame_count) : 0;
+}
+
+bool comms_t::fill_imu( rcfmu_message::imu_t &imu1 )
+{
+    if ( !due(rcfmu_message::imu_id) ) {
+        return false;
+    }
+    // field handles are bound once, so this is a straight copy
+    static const char *const names[] = {
+        nullptr, nullptr, "millis",
+        "ax_raw", "ay_raw", "az_raw", "hx_raw", "hy_raw", "hz_raw",
+        "ax_mps2", "ay_mps2", "az_mps2", "p_rps", "q_rps", "r_rps",
+        "hx", "hy", "hz", "temp_C"
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::imu_t> imu_binding(imu_node, names);
+    imu_binding.props2msg(imu1);
+    stamp(imu1);
+    return true;
 }
 
 void comms_t::write_imu_ascii()
@@ -170,30 +414,29 @@ void comms_t::write_imu_ascii()
 int comms_t::write_gps_bin()
 {
     static rcfmu_message::gps_t gps_msg;
-    if ( gps_node.getUInt("millis") != gps_last_millis ) {
-        gps_last_millis = gps_node.getUInt("millis");
-        gps_msg.millis = gps_node.getUInt("millis");
-        gps_msg.unix_usec = gps_node.getUInt64("unix_usec");
-        // for ( int i = 0; i < 8; i++ ) {
-        //     printf("%02X ", *(uint8_t *)(&(gps_msg.unix_usec) + i));
-        // }
-        // printf("%ld\n", gps_msg.unix_usec);
-        gps_msg.num_sats = gps_node.getInt("satellites");
-        gps_msg.status = gps_node.getInt("status");
-        gps_msg.latitude_raw = gps_node.getInt("latitude_raw");
-        gps_msg.longitude_raw = gps_node.getInt("longitude_raw");
-        gps_msg.altitude_m = gps_node.getDouble("altitude_m");
-        gps_msg.vn_mps = gps_node.getDouble("vn_mps");
-        gps_msg.ve_mps = gps_node.getDouble("ve_mps");
-        gps_msg.vd_mps = gps_node.getDouble("vd_mps");
-        gps_msg.hAcc = gps_node.getDouble("hAcc");
-        gps_msg.vAcc = gps_node.getDouble("vAcc");
-        gps_msg.hdop = gps_node.getDouble("hdop");
-        gps_msg.vdop = gps_node.getDouble("vdop");
-        gps_msg.pack();
-        return serial.write_packet( gps_msg.id, gps_msg.payload, gps_msg.len );
+    return fill_gps(gps_msg) ? send(gps_msg, frame_count) : 0;
+}
+
+// (only when there is a new fix)
+bool comms_t::fill_gps( rcfmu_message::gps_t &gps_msg )
+{
+    if ( !due(rcfmu_message::gps_id) ) {
+        return false;
+    }
+    static const char *const names[] = {
+        nullptr, nullptr, "millis", "unix_usec", "satellites", "status",
+        "longitude_raw", "latitude_raw", "altitude_m",
+        "vn_mps", "ve_mps", "vd_mps",
+        "horiz_accuracy_m", "vertical_accuracy_m", "hdop", "vdop"
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::gps_t> gps_binding(gps_node, names);
+    gps_binding.props2msg(gps_msg);
+    if ( gps_msg.millis != gps_last_millis ) {
+        gps_last_millis = gps_msg.millis;
+        stamp(gps_msg);
+        return true;
     } else {
-        return 0;
+        return false;
     }
 }
 
@@ -223,40 +466,46 @@ void comms_t::write_gps_ascii() {
 int comms_t::write_nav_bin()
 {
     static rcfmu_message::ekf_t nav_msg;
-    nav_msg.millis = imu_node.getUInt("millis"); // fixme?
-    nav_msg.lat_rad = nav_node.getDouble("latitude_rad");
-    nav_msg.lon_rad = nav_node.getDouble("longitude_rad");
-    nav_msg.altitude_m = nav_node.getDouble("altitude_m");
-    nav_msg.vn_ms = nav_node.getDouble("vn_mps");
-    nav_msg.ve_ms = nav_node.getDouble("ve_mps");
-    nav_msg.vd_ms = nav_node.getDouble("vd_mps");
-    nav_msg.phi_rad = nav_node.getDouble("phi_rad");
-    nav_msg.the_rad = nav_node.getDouble("the_rad");
-    nav_msg.psi_rad = nav_node.getDouble("psi_rad");
-    nav_msg.p_bias = nav_node.getDouble("p_bias");
-    nav_msg.q_bias = nav_node.getDouble("q_bias");
-    nav_msg.r_bias = nav_node.getDouble("r_bias");
-    nav_msg.ax_bias = nav_node.getDouble("ax_bias");
-    nav_msg.ay_bias = nav_node.getDouble("ay_bias");
-    nav_msg.az_bias = nav_node.getDouble("az_bias");
-    float max_pos_cov = nav_node.getDouble("Pp0");
-    if ( nav_node.getDouble("Pp1") > max_pos_cov ) { max_pos_cov = nav_node.getDouble("Pp1"); }
-    if ( nav_node.getDouble("Pp2") > max_pos_cov ) { max_pos_cov = nav_node.getDouble("Pp2"); }
+    return fill_nav(nav_msg) ? send(nav_msg, frame_count) : 0;
+}
+
+bool comms_t::fill_nav( rcfmu_message::ekf_t &nav_msg )
+{
+    if ( !due(rcfmu_message::ekf_id) ) {
+        return false;
+    }
+    static const char *const names[] = {
+        nullptr, nullptr, nullptr, "latitude_rad", "longitude_rad", "altitude_m",
+        "vn_mps", "ve_mps", "vd_mps", "phi_rad", "the_rad", "psi_rad",
+        "p_bias", "q_bias", "r_bias", "ax_bias", "ay_bias", "az_bias",
+        nullptr, nullptr, nullptr, "status"
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::ekf_t> nav_binding(nav_node, names);
+    nav_binding.props2msg(nav_msg);
+
+    // the time stamp and covariance summaries are derived
+    static const char *const derived[] = {
+        "timestamp", "Pp0", "Pp1", "Pp2", "Pv0", "Pv1", "Pv2", "Pa0", "Pa1", "Pa2"
+    };
+    static rcfmu_message::props_values_t<10> nav_values(nav_node, derived);
+    nav_msg.millis = nav_values.get(0) * 1000.0;
+    float max_pos_cov = nav_values.get(1);
+    if ( nav_values.get(2) > max_pos_cov ) { max_pos_cov = nav_values.get(2); }
+    if ( nav_values.get(3) > max_pos_cov ) { max_pos_cov = nav_values.get(3); }
     if ( max_pos_cov > 655.0 ) { max_pos_cov = 655.0; }
     nav_msg.max_pos_cov = max_pos_cov;
-    float max_vel_cov = nav_node.getDouble("Pv0");
-    if ( nav_node.getDouble("Pv1") > max_vel_cov ) { max_vel_cov = nav_node.getDouble("Pv1"); }
-    if ( nav_node.getDouble("Pv2") > max_vel_cov ) { max_vel_cov = nav_node.getDouble("Pv2"); }
+    float max_vel_cov = nav_values.get(4);
+    if ( nav_values.get(5) > max_vel_cov ) { max_vel_cov = nav_values.get(5); }
+    if ( nav_values.get(6) > max_vel_cov ) { max_vel_cov = nav_values.get(6); }
     if ( max_vel_cov > 65.5 ) { max_vel_cov = 65.5; }
     nav_msg.max_vel_cov = max_vel_cov;
-    float max_att_cov = nav_node.getDouble("Pa0");
-    if ( nav_node.getDouble("Pa1") > max_att_cov ) { max_att_cov = nav_node.getDouble("Pa1"); }
-    if ( nav_node.getDouble("Pa2") > max_att_cov ) { max_att_cov = nav_node.getDouble("Pa2"); }
-    if ( max_att_cov > 6.55 ) { max_vel_cov = 6.55; }
+    float max_att_cov = nav_values.get(7);
+    if ( nav_values.get(8) > max_att_cov ) { max_att_cov = nav_values.get(8); }
+    if ( nav_values.get(9) > max_att_cov ) { max_att_cov = nav_values.get(9); }
+    if ( max_att_cov > 6.55 ) { max_att_cov = 6.55; }
     nav_msg.max_att_cov = max_att_cov;
-    nav_msg.status = nav_node.getInt("status");
-    nav_msg.pack();
-    return serial.write_packet( nav_msg.id, nav_msg.payload, nav_msg.len );
+    stamp(nav_msg);
+    return true;
 }
 
 void comms_t::write_nav_ascii() {
@@ -307,16 +556,24 @@ void comms_t::write_nav_stats_ascii() {
 int comms_t::write_airdata_bin()
 {
     static rcfmu_message::airdata_t airdata1;
-    // FIXME: proprty names
-    airdata1.baro_press_pa = airdata_node.getDouble("baro_press_pa");
-    airdata1.baro_temp_C = airdata_node.getDouble("baro_tempC");
+    return fill_airdata(airdata1) ? send(airdata1, frame_count) : 0;
+}
+
+bool comms_t::fill_airdata( rcfmu_message::airdata_t &airdata1 )
+{
+    if ( !due(rcfmu_message::airdata_id) ) {
+        return false;
+    }
+    // FIXME: proprty names (static_press_pa isn't published yet)
+    static const char *const names[] = {
+        nullptr, nullptr, "baro_press_pa", "baro_tempC", nullptr,
+        "diffPress_pa", "static_press_pa", "temp_C", "error_count"
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::airdata_t> airdata_binding(airdata_node, names);
+    airdata_binding.props2msg(airdata1);
     airdata1.baro_hum = 0.0;
-    airdata1.ext_diff_press_pa = airdata_node.getDouble("diffPress_pa");
-    airdata1.ext_static_press_pa = airdata_node.getDouble("static_press_pa"); // fixme!
-    airdata1.ext_temp_C = airdata_node.getDouble("temp_C");
-    airdata1.error_count = airdata_node.getDouble("error_count");
-    airdata1.pack();
-    return serial.write_packet( airdata1.id, airdata1.payload, airdata1.len );
+    stamp(airdata1);
+    return true;
 }
 
 void comms_t::write_airdata_ascii()
@@ -334,11 +591,21 @@ void comms_t::write_airdata_ascii()
 int comms_t::write_power_bin()
 {
     static rcfmu_message::power_t power1;
-    power1.avionics_v = power_node.getDouble("avionics_v");
-    power1.int_main_v = power_node.getDouble("battery_volts");
-    power1.ext_main_amp = power_node.getDouble("battery_amps");
-    power1.pack();
-    return serial.write_packet( power1.id, power1.payload, power1.len );
+    return fill_power(power1) ? send(power1, frame_count) : 0;
+}
+
+bool comms_t::fill_power( rcfmu_message::power_t &power1 )
+{
+    if ( !due(rcfmu_message::power_id) ) {
+        return false;
+    }
+    static const char *const names[] = {
+        nullptr, nullptr, "battery_volts", "avionics_v", nullptr, "battery_amps"
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::power_t> power_binding(power_node, names);
+    power_binding.props2msg(power1);
+    stamp(power1);
+    return true;
 }
 
 void comms_t::write_power_ascii()
@@ -352,23 +619,56 @@ void comms_t::write_power_ascii()
 // output a binary representation of various status and config information
 int comms_t::write_status_info_bin()
 {
-    static uint32_t write_millis = AP_HAL::millis();
     static rcfmu_message::status_t status;
+    return fill_status_info(status) ? send_status(status, frame_count) : 0;
+}
+
+// status is packed per port: each port reports its own baud and tx
+// queue accounting
+int comms_t::send_status( rcfmu_message::status_t &status, uint32_t frame )
+{
+    int result = 0;
+    for ( uint8_t i = 0; i < num_ports; i++ ) {
+        port_t *port = ports[i];
+        uint8_t d = port->divider[rcfmu_message::status_id];
+        if ( !d || frame % d != 0 ) {
+            continue;
+        }
+        status.baud = port->baud;
+        tx_queue_t::counters_t tx[rcfmu_message::tx_stats_ids];
+        port->link.get_tx_counters( rcfmu_message::tx_stats_first_id,
+                                    rcfmu_message::tx_stats_ids, tx,
+                                    &status.tx_queue_high );
+        for ( int j = 0; j < rcfmu_message::tx_stats_ids; j++ ) {
+            status.tx_queued[j] = tx[j].queued;
+            status.tx_sent[j] = tx[j].sent;
+            status.tx_dropped[j] = tx[j].dropped;
+        }
+        status.pack();
+        result += port->link.write_packet( status.id, status.payload, status.len );
+    }
+    return result;
+}
+
+bool comms_t::fill_status_info( rcfmu_message::status_t &status )
+{
+    static uint32_t write_millis = AP_HAL::millis();
 
     // This info is static or slow changing so we don't need to send
-    // it at a high rate.
-    static int counter = 0;
-    if ( counter > 0 ) {
-        counter--;
-        return 0;
-    } else {
-        counter = MASTER_HZ * 1 - 1; // a message every 1 seconds (-1 so we aren't off by one frame) 
+    // it at a high rate (1 hz by default.)
+    if ( !due(rcfmu_message::status_id) ) {
+        return false;
     }
 
-    status.serial_number = config_node.getInt("serial_number");
+    // only the serial number comes from the property tree
+    static const char *const names[] = {
+        nullptr, nullptr, "serial_number", nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
+    };
+    static rcfmu_message::props_binding_t<rcfmu_message::status_t> status_binding(config_node, names);
+    status_binding.props2msg(status);
     status.firmware_rev = FIRMWARE_REV;
     status.master_hz = MASTER_HZ;
-    status.baud = DEFAULT_BAUD;
 
     // estimate sensor output byte rate
     unsigned long current_time = AP_HAL::millis();
@@ -379,8 +679,14 @@ int comms_t::write_status_info_bin()
     status.byte_rate = byte_rate;
     status.timer_misses = main_loop_timer_misses;
 
-    status.pack();
-    return serial.write_packet( status.id, status.payload, status.len );
+    // (baud and tx queue accounting are per port, see send_status())
+
+    // telemetry thread queue (when enabled)
+    status.tlm_queue_high = tlm_queue.high_water;
+    status.tlm_queue_dropped = tlm_queue.dropped;
+
+    stamp(status);
+    return true;
 }
 
 void comms_t::write_status_info_ascii()
@@ -390,14 +696,177 @@ void comms_t::write_status_info_ascii()
     printf("Uptime: %d(sec)", (unsigned int)(AP_HAL::millis() / 1000));
     printf(" SN: %d", config_node.getInt("serial_number"));
     printf(" Firmware: %d", FIRMWARE_REV);
-    printf(" Main loop hz: %d", MASTER_HZ);
-    printf(" Baud: %d\n", DEFAULT_BAUD);
+    printf(" Main loop hz: %d\n", MASTER_HZ);
+    for ( uint8_t i = 0; i < num_ports; i++ ) {
+        printf("Port %s: baud %d\n", ports[i]->name.c_str(), (int)ports[i]->baud);
+    }
+    if ( tlm_threaded ) {
+        printf("Telemetry queue: depth %d/%d high %d dropped %d frames\n",
+               tlm_queue.size(), tlm_queue.capacity(),
+               tlm_queue.high_water, (int)tlm_queue.dropped);
+    }
+}
+
+// per task execution time profile, one task per message (round robin)
+int comms_t::write_task_profile_bin()
+{
+    static rcfmu_message::task_profile_t profile;
+    return fill_task_profile(profile) ? send(profile, frame_count) : 0;
+}
+
+bool comms_t::fill_task_profile( rcfmu_message::task_profile_t &profile )
+{
+    static uint8_t index = 0;
+
+    if ( !due(rcfmu_message::task_profile_id) || rate_scheduler.size() == 0 ) {
+        return false;
+    }
+    if ( index >= rate_scheduler.size() ) {
+        index = 0;
+    }
+    const rate_scheduler_t::task_t &t = rate_scheduler.get_task(index);
+    const exec_profile_t &p = t.profile;
+    profile.index = index;
+    profile.count = rate_scheduler.size();
+    memset(profile.name, 0, sizeof(profile.name));
+    strncpy((char *)profile.name, t.name, sizeof(profile.name));
+    profile.runs = p.runs;
+    profile.min_usec = p.min_usec < 65535 ? p.min_usec : 65535;
+    profile.mean_usec = p.mean_usec() < 65535 ? p.mean_usec() : 65535;
+    uint32_t p99 = p.quantile_usec(0.99);
+    profile.p99_usec = p99 < 65535 ? p99 : 65535;
+    profile.max_usec = p.max_usec < 65535 ? p.max_usec : 65535;
+    profile.overruns = t.overruns;
+    profile.deferrals = t.deferrals;
+    index++;
+
+    stamp(profile);
+    return true;
+}
+
+// frame timing: one histogram (0 = sample interval error, 1 =
+// duration, 2 = sample to output latency, 3 = frame start delay) and
+// one of the worst frames per message, both round robin
+int comms_t::write_frame_timing_bin()
+{
+    static rcfmu_message::frame_timing_t timing;
+    return fill_frame_timing(timing) ? send(timing, frame_count) : 0;
+}
+
+bool comms_t::fill_frame_timing( rcfmu_message::frame_timing_t &timing )
+{
+    static_assert(rcfmu_message::max_tasks == rate_scheduler_t::MAX_TASKS,
+                  "frame_timing stage count must match the scheduler");
+    static_assert(rcfmu_message::timing_bins == log2_histogram_t::BINS,
+                  "frame_timing histogram must match the scheduler");
+    static uint8_t kind = 0;
+    static uint8_t rank = 0;
+
+    if ( !due(rcfmu_message::frame_timing_id) ) {
+        return false;
+    }
+    const log2_histogram_t *hist[] = { &rate_scheduler.interval_hist,
+                                       &rate_scheduler.duration_hist,
+                                       &rate_scheduler.latency_hist,
+                                       &rate_scheduler.start_hist };
+    const uint8_t kinds = sizeof(hist) / sizeof(hist[0]);
+    timing.hist_kind = kind;
+    memcpy(timing.hist, hist[kind]->bins, sizeof(timing.hist));
+    kind = (kind + 1) % kinds;
+
+    timing.worst_count = rate_scheduler.worst_size();
+    if ( rank >= timing.worst_count ) {
+        rank = 0;
+    }
+    timing.worst_rank = rank;
+    if ( timing.worst_count ) {
+        const rate_scheduler_t::frame_record_t &r = rate_scheduler.get_worst(rank);
+        timing.worst_frame = r.frame;
+        timing.worst_interval_usec = r.interval_usec;
+        timing.worst_start_usec = r.start_usec;
+        timing.worst_duration_usec = r.duration_usec;
+        timing.worst_latency_usec = r.latency_usec;
+        memcpy(timing.worst_stage_usec, r.stage_usec, sizeof(timing.worst_stage_usec));
+        rank++;
+    }
+
+    stamp(timing);
+    return true;
+}
+
+bool comms_t::start_telemetry_thread() {
+#if defined(ARDUPILOT_BUILD)
+    // below the main loop: it only has to keep up on average
+    tlm_threaded = hal.scheduler->thread_create(
+        FUNCTOR_BIND_MEMBER(&comms_t::telemetry_thread, void),
+        "telemetry", 4096, AP_HAL::Scheduler::PRIORITY_IO, 1);
+#endif
+    console->printf("comms: telemetry thread %s\n", tlm_threaded ? "started" : "failed");
+    return tlm_threaded;
+}
+
+// Capture this frame's telemetry (property reads and stamps, no
+// packing) into a snapshot for the telemetry thread.  A full queue
+// drops the whole frame.
+void comms_t::queue_telemetry( bool nav_selected ) {
+    static telemetry_frame_t f;
+    f.frame = frame_count;
+    f.present = 0;
+    if ( fill_pilot_in(f.pilot) ) { f.present |= TLM_PILOT; }
+    if ( fill_gps(f.gps) ) { f.present |= TLM_GPS; }
+    if ( fill_airdata(f.airdata) ) { f.present |= TLM_AIRDATA; }
+    if ( fill_power(f.power) ) { f.present |= TLM_POWER; }
+    if ( fill_status_info(f.status) ) { f.present |= TLM_STATUS; }
+    if ( nav_selected && fill_nav(f.nav) ) { f.present |= TLM_NAV; }
+    if ( fill_task_profile(f.profile) ) { f.present |= TLM_PROFILE; }
+    if ( fill_frame_timing(f.timing) ) { f.present |= TLM_TIMING; }
+    if ( fill_imu(f.imu) ) { f.present |= TLM_IMU; }
+    if ( f.present ) {
+        tlm_queue.push(f);
+        tlm_ready.signal();
+    }
+}
+
+// pack and write one snapshot in the usual order (imu last: the end
+// of frame marker)
+int comms_t::send_telemetry( telemetry_frame_t &f ) {
+    int result = 0;
+    if ( f.present & TLM_PILOT ) { result += send(f.pilot, f.frame); }
+    if ( f.present & TLM_GPS ) { result += send(f.gps, f.frame); }
+    if ( f.present & TLM_AIRDATA ) { result += send(f.airdata, f.frame); }
+    if ( f.present & TLM_POWER ) { result += send(f.power, f.frame); }
+    if ( f.present & TLM_STATUS ) { result += send_status(f.status, f.frame); }
+    if ( f.present & TLM_NAV ) { result += send(f.nav, f.frame); }
+    if ( f.present & TLM_PROFILE ) { result += send(f.profile, f.frame); }
+    if ( f.present & TLM_TIMING ) { result += send(f.timing, f.frame); }
+    if ( f.present & TLM_IMU ) { result += send(f.imu, f.frame); }
+    return result;
+}
+
+void comms_t::telemetry_thread() {
+    static telemetry_frame_t f;
+    while ( true ) {
+        // one signal may cover several pushes, so drain the queue
+        tlm_ready.wait_blocking();
+        while ( tlm_queue.pop(f) ) {
+            output_counter += send_telemetry(f);
+        }
+    }
 }
 
 void comms_t::read_commands() {
-    while ( serial.update() ) {
-        parse_message_bin( serial.pkt_id, serial.payload, serial.pkt_len );
+    for ( rx_port = 0; rx_port < num_ports; rx_port++ ) {
+        port_t *port = ports[rx_port];
+        SerialLink &link = port->link;
+        while ( link.update() ) {
+            parse_message_bin( link.pkt_id, link.payload, link.pkt_len );
+        }
+        if ( port->reliable_ack_pending ) {
+            write_reliable_ack_bin( port );
+            port->reliable_ack_pending = false;
+        }
     }
+    rx_port = 0;
 }
 
 // global shared instance
@@ -16,8 +16,11 @@
 // initialize the imu sensor(s)
 void imu_hal_t::init() {
     printf("AP_InertialSensor startup...\n");
-    hal.scheduler->delay(100);
-    ins.init(100);
+    // the INS loop rate paces the main loop, the backends still read
+    // the sensors at their full rate
+    ins.init(MASTER_HZ);
+    printf("INS rate: %d hz (gyro %d hz, accel %d hz)\n", MASTER_HZ,
+           (int)ins.get_gyro_rate_hz(0), (int)ins.get_accel_rate_hz(0));
     printf("Number of detected accels : %u\n", ins.get_accel_count());
     printf("Number of detected gyros  : %u\n", ins.get_gyro_count());
     printf("ahrs.init()\n");
@@ -25,22 +28,57 @@ void imu_hal_t::init() {
     printf("compass.init()\n");
     compass.init();
     printf("Number of detected compasses  : %u\n", compass.get_count());
-    hal.scheduler->delay(100);
 }
 
-// query the imu
+// Sleep until the INS delivers the frame's update (one per frame) and
+// take its delta angle and delta velocity: the backends accumulate
+// every raw sensor fifo sample since the last update into these, so
+// the frame's full rate motion is there without waking up per sample
+// (an INS loop faster than the frame reschedules on any overshoot and
+// stretches the frame.)  The INS time of the update (not our wake up
+// time) stamps everything computed from the frame.
+uint32_t imu_hal_t::wait_for_sample() {
+    ins.wait_for_sample();
+    ins.update();
+    Vector3f da, dv;
+    float da_dt, dv_dt;
+    if ( !ins.get_delta_angle(0, da, da_dt) ) {
+        da_dt = ins.get_loop_delta_t();
+        da = ins.get_gyro(0) * da_dt;
+    }
+    if ( !ins.get_delta_velocity(0, dv, dv_dt) ) {
+        dv_dt = ins.get_loop_delta_t();
+        dv = ins.get_accel(0) * dv_dt;
+    }
+    integrator.set( Eigen::Vector3f(da.x, da.y, da.z), da_dt,
+                    Eigen::Vector3f(dv.x, dv.y, dv.z), dv_dt );
+    uint64_t now64 = AP_HAL::micros64();
+    raw_micros = ins.get_last_update_usec();
+    raw_micros64 = now64 - (uint32_t)((uint32_t)now64 - raw_micros);
+    raw_millis = raw_micros64 / 1000;
+    return raw_micros;
+}
+
+// the frame's sensor values
 void imu_hal_t::update() {
     // static uint8_t accel_count = ins.get_accel_count();
     // static uint8_t gyro_count = ins.get_gyro_count();
- 
-    raw_millis = AP_HAL::millis();
-
-    ins.wait_for_sample();      // wait until we have a sample
-    ins.update();               // read
 
     // for now just go with the 0'th INS sensor
-    accel = ins.get_accel(0);
-    gyro = ins.get_gyro(0);
+    float da_dt = integrator.dt();
+    float dv_dt = integrator.dvel_dt();
+    if ( da_dt > 0.0 ) {
+        Eigen::Vector3f dtheta = integrator.delta_angle() / da_dt;
+        gyro = Vector3f(dtheta(0), dtheta(1), dtheta(2));
+    } else {
+        gyro = ins.get_gyro(0);
+    }
+    if ( dv_dt > 0.0 ) {
+        Eigen::Vector3f dvel = integrator.delta_velocity() / dv_dt;
+        accel = Vector3f(dvel(0), dvel(1), dvel(2));
+    } else {
+        accel = ins.get_accel(0);
+    }
     temp_C = ins.get_temperature(0);
 
     compass.read();
@@ -4,16 +4,25 @@
 
 #include <AP_Math/AP_Math.h>
 
+#include "imu_integrator.h"
+
 class imu_hal_t {
     
 public:
 
     uint32_t raw_millis;
+    uint32_t raw_micros;        // INS time of the frame's update
+    uint64_t raw_micros64;
+    // frame averages of the compensated increments
+    // (delta / dt), what a perfect single sample would have been
     Vector3f accel;
     Vector3f gyro;
     float temp_C;
     Vector3f mag;
     
+    imu_integrator_t integrator;
+
     void init();
-    void update();
+    uint32_t wait_for_sample(); // block for the next frame, returns its time
+    void update();              // read the sample
 };
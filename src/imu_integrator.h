@@ -0,0 +1,105 @@
+#pragma once
+
+// High rate IMU front end: integrate the INS's delta angle / delta
+// velocity increments (one per INS update, 400-1000 hz) over a main
+// loop frame with coning and sculling compensation, so the (100 hz)
+// filter sees the true attitude change and velocity change of the
+// whole frame rather than one instantaneous sample.
+//
+// Savage's two speed form: per increment k
+//   alpha   += dtheta_k                      (summed angle)
+//   beta    += 1/2 alpha_k-1 x dtheta_k + 1/12 dtheta_k-1 x dtheta_k
+//   upsilon += dvel_k                        (summed velocity)
+//   scul    += 1/2 (alpha_k-1 x dvel_k + upsilon_k-1 x dtheta_k)
+//            + 1/12 (dtheta_k-1 x dvel_k + dvel_k-1 x dtheta_k)
+// and for the frame
+//   delta angle    = alpha + beta            (rotation vector)
+//   delta velocity = upsilon + 1/2 alpha x upsilon + scul
+//
+// When the source has already integrated the increments at the sensor
+// rate (the INS backends sum every fifo sample between INS updates,
+// coning compensated), set() takes the frame's single increment and
+// only the rotation compensation of velocity applies.
+//
+// HAL free (Eigen only) so the host can check it.
+
+#include <stdint.h>
+
+#include "eigen3/Eigen/Core"
+#include "eigen3/Eigen/Geometry"
+
+class imu_integrator_t {
+
+public:
+
+    imu_integrator_t() {
+        dtheta_last.setZero();
+        dvel_last.setZero();
+        reset();
+    }
+
+    // start a new frame (the last increment carries over for the
+    // 1/12 terms)
+    void reset() {
+        alpha.setZero();
+        beta.setZero();
+        upsilon.setZero();
+        scul.setZero();
+        sum_dt = 0.0;
+        sum_dvel_dt = 0.0;
+        samples = 0;
+    }
+
+    // one INS increment: delta angle (rad) and delta velocity (m/s)
+    // over dt (sec)
+    void add( const Eigen::Vector3f &dtheta, const Eigen::Vector3f &dvel, float dt ) {
+        beta += 0.5f * alpha.cross(dtheta) + (1.0f / 12.0f) * dtheta_last.cross(dtheta);
+        scul += 0.5f * (alpha.cross(dvel) + upsilon.cross(dtheta))
+            + (1.0f / 12.0f) * (dtheta_last.cross(dvel) + dvel_last.cross(dtheta));
+        alpha += dtheta;
+        upsilon += dvel;
+        dtheta_last = dtheta;
+        dvel_last = dvel;
+        sum_dt += dt;
+        sum_dvel_dt += dt;
+        samples++;
+    }
+
+    // the frame's one pre-integrated increment (angle and velocity may
+    // cover slightly different intervals, e.g. different gyro and
+    // accel rates)
+    void set( const Eigen::Vector3f &dtheta, float dtheta_dt,
+              const Eigen::Vector3f &dvel, float dvel_dt ) {
+        reset();
+        alpha = dtheta;
+        upsilon = dvel;
+        dtheta_last = dtheta;
+        dvel_last = dvel;
+        sum_dt = dtheta_dt;
+        sum_dvel_dt = dvel_dt;
+        samples = 1;
+    }
+
+    Eigen::Vector3f delta_angle() const {
+        return alpha + beta;
+    }
+    Eigen::Vector3f delta_velocity() const {
+        return upsilon + 0.5f * alpha.cross(upsilon) + scul;
+    }
+    float dt() const {          // delta angle interval
+        return sum_dt;
+    }
+    float dvel_dt() const {     // delta velocity interval
+        return sum_dvel_dt;
+    }
+    uint16_t count() const {
+        return samples;
+    }
+
+private:
+
+    Eigen::Vector3f alpha, beta, upsilon, scul;
+    Eigen::Vector3f dtheta_last, dvel_last;
+    float sum_dt, sum_dvel_dt;
+    uint16_t samples;
+};
@@ -1,6 +1,8 @@
 #include "imu_mgr.h"
 
 #include "setup_board.h"
+#include "comms.h"
+#include "rcfmu_messages.h"
 
 #include <AP_HAL/AP_HAL.h>
 
@@ -80,13 +82,20 @@ void imu_mgr_t::set_mag_calibration() {
 }
 
 // configure the IMU settings and setup the ISR to aquire the data
+static bool handle_zero_gyros( uint8_t *buf, uint16_t message_size ) {
+    console->printf("received zero gyros command\n");
+    imu_mgr.gyros_calibrated = 0;   // start state
+    return true;
+}
+
 void imu_mgr_t::init() {
     printf("imu_mgr.init()\n\n");
-    hal.scheduler->delay(500);
     imu_node = PropertyNode("/sensors/imu");
     imu_calib_node = PropertyNode("/config/imu/calibration");
-    hal.scheduler->delay(100);
     imu_hal.init();
+    comms.register_handler( rcfmu_message::command_zero_gyros_id,
+                            rcfmu_message::command_zero_gyros_t::len,
+                            handle_zero_gyros, true );
 }
 
 // query the imu and update the structures
@@ -102,6 +111,7 @@ void imu_mgr_t::update() {
     
     imu_hal.update();
     imu_millis = imu_hal.raw_millis;
+    imu_micros = imu_hal.raw_micros;
     
     accels_raw << imu_hal.accel.x, imu_hal.accel.y, imu_hal.accel.z, 1.0;
     gyros_raw << imu_hal.gyro.x, imu_hal.gyro.y, imu_hal.gyro.z;
@@ -129,7 +139,8 @@ void imu_mgr_t::update() {
 
     // publish
     imu_node.setUInt("millis", imu_millis);
-    imu_node.setDouble("timestamp", imu_millis / 1000.0);
+    imu_node.setUInt("micros", imu_micros);
+    imu_node.setDouble("timestamp", imu_hal.raw_micros64 / 1000000.0);
     imu_node.setDouble("ax_raw", accels_raw(0));
     imu_node.setDouble("ay_raw", accels_raw(1));
     imu_node.setDouble("az_raw", accels_raw(2));
@@ -46,6 +46,7 @@ public:
     // 0 = uncalibrated, 1 = calibration in progress, 2 = calibration finished
     int gyros_calibrated = 0;
     unsigned long imu_millis = 0;
+    uint32_t imu_micros = 0;
     // raw/uncorrected sensor values
     Eigen::Vector4f accels_raw =  Eigen::Vector4f::Zero();
     Eigen::Vector3f gyros_raw =  Eigen::Vector3f::Zero();
@@ -64,6 +65,8 @@ public:
     void set_accel_calibration();
     void set_mag_calibration();
     void init();
+    // the main loop blocks here, each INS sample starts a frame
+    uint32_t wait_for_sample() { return imu_hal.wait_for_sample(); }
     void update();
 };
 
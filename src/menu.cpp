@@ -1,6 +1,9 @@
 #include "setup_board.h"
 
+#include "boot_init.h"
+#include "comms.h"
 #include "menu.h"
+#include "rate_scheduler.h"
 
 void menu_t::display() {
     console->printf("%s\n",
@@ -13,6 +16,10 @@ void menu_t::display() {
                     "  7) Actuator output\n"
                     "  8) Calibrate IMU strapdown\n"
                     "  9) Pretty print property tree\n"
+                    "  h) Message handler stats\n"
+                    "  t) Task scheduler stats\n"
+                    "  j) Frame timing histograms and worst frames\n"
+                    "  i) Boot (init) profile\n"
                     "  Reboot: type \"reboot\"\n");
 }
 
@@ -67,6 +74,14 @@ void menu_t::update() {
             console->printf("request: %s\n", imu_node.getString("request").c_str());
         } else if ( user_input == '9' ) {
             PropertyNode("/").pretty_print();
+        } else if ( user_input == 'h' ) {
+            comms.write_handler_stats_ascii();
+        } else if ( user_input == 't' ) {
+            rate_scheduler.write_stats_ascii();
+        } else if ( user_input == 'j' ) {
+            rate_scheduler.write_timing_ascii();
+        } else if ( user_input == 'i' ) {
+            boot_init.write_report_ascii();
         } else if ( user_input == reboot_cmd[reboot_count] ) {
             reboot_count++;
             if ( reboot_count == strlen(reboot_cmd) ) {
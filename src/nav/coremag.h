@@ -35,7 +35,10 @@
 
 #pragma once
 
+#include <time.h>
+#if defined(ARDUPILOT_BUILD)
 #include <AP_HAL/AP_HAL.h>
+#endif
 
 /* Convert date to Julian day 1950-2049 */
 unsigned long int yymmdd_to_julian_days( int yy, int mm, int dd );
@@ -63,28 +63,11 @@ void EKF15::default_config()
     config.sig_gps_v_ne = 0.5;  // GPS measurement noise std dev (m/s)
     config.sig_gps_v_d  = 1.0;  // GPS measurement noise std dev (m/s)
     config.sig_mag      = 0.3;  // Magnetometer measurement noise std dev (normalized -1 to 1)
+    config.sequential   = false; // batch Joseph update
+    config.gate_sigma   = 0.0;  // no innovation gating
 }
 
 void EKF15::init(IMUdata imu, GPSdata gps) {
-    F.resize(15,15);
-    PHI.resize(15,15);
-    P.resize(15,15);
-    Qw.resize(15,15);
-    Q.resize(15,15);
-    ImKH.resize(15,15);
-    KRKt.resize(15,15);
-    I15.resize(15,15);
-
-    G.resize(15,12);
-    K.resize(15,6);
-
-    Rw.resize(12,12);
-
-    H.resize(6,15);
-
-    R.resize(6,6);
-    
-    I15.setIdentity();
     I3.setIdentity();
     
 
@@ -116,6 +99,12 @@ void EKF15::init(IMUdata imu, GPSdata gps) {
     P(12,12) = P_GB_INIT*P_GB_INIT; 	P(13,13) = P_GB_INIT*P_GB_INIT;       P(14,14) = P_GB_INIT*P_GB_INIT;
 	
     // ... R
+    // ... the fixed parts of the error model
+    model.gs2pos = -2 * g / EarthRadius;
+    model.tau_a = config.tau_a;
+    model.tau_g = config.tau_g;
+    model.rw = Rw.diagonal();
+
     R.setZero();
     R(0,0) = config.sig_gps_p_ne*config.sig_gps_p_ne;	 R(1,1) = config.sig_gps_p_ne*config.sig_gps_p_ne;  R(2,2) = config.sig_gps_p_d*config.sig_gps_p_d;
     R(3,3) = config.sig_gps_v_ne*config.sig_gps_v_ne;	 R(4,4) = config.sig_gps_v_ne*config.sig_gps_v_ne;  R(5,5) = config.sig_gps_v_d*config.sig_gps_v_d;
@@ -167,6 +156,7 @@ void EKF15::init(IMUdata imu, GPSdata gps) {
 	
     imu_last = imu;
 	
+    nav.gated = 0;
     nav.time = imu.time;
     nav.err_type = data_valid;
 }
@@ -253,64 +243,17 @@ void EKF15::time_update(IMUdata imu) {
     nav.lon += imu_dt*dx(1);
     nav.alt += imu_dt*dx(2);
 	
-    // JACOBIAN
-    F.setZero();
-    // ... pos2gs
-    F(0,3) = 1.0; 	F(1,4) = 1.0; 	F(2,5) = 1.0;
-    // ... gs2pos
-    F(5,2) = -2 * g / EarthRadius;
-	
+    // JACOBIAN (the nonzero blocks)
     // ... gs2att
-    temp33 = C_B2N * sk(f_b);
-	
-    F(3,6) = -2.0*temp33(0,0);  F(3,7) = -2.0*temp33(0,1);  F(3,8) = -2.0*temp33(0,2);
-    F(4,6) = -2.0*temp33(1,0);  F(4,7) = -2.0*temp33(1,1);  F(4,8) = -2.0*temp33(1,2);
-    F(5,6) = -2.0*temp33(2,0);  F(5,7) = -2.0*temp33(2,1);  F(5,8) = -2.0*temp33(2,2);
-	
+    model.gs2att.noalias() = -2.0f * C_B2N * sk(f_b);
     // ... gs2acc
-    F(3,9) = -C_B2N(0,0);  F(3,10) = -C_B2N(0,1);  F(3,11) = -C_B2N(0,2);
-    F(4,9) = -C_B2N(1,0);  F(4,10) = -C_B2N(1,1);  F(4,11) = -C_B2N(1,2);
-    F(5,9) = -C_B2N(2,0);  F(5,10) = -C_B2N(2,1);  F(5,11) = -C_B2N(2,2);
-	
+    model.gs2acc = -C_B2N;
     // ... att2att
-    temp33 = sk(om_ib);
-    F(6,6) = -temp33(0,0);  F(6,7) = -temp33(0,1);  F(6,8) = -temp33(0,2);
-    F(7,6) = -temp33(1,0);  F(7,7) = -temp33(1,1);  F(7,8) = -temp33(1,2);
-    F(8,6) = -temp33(2,0);  F(8,7) = -temp33(2,1);  F(8,8) = -temp33(2,2);
-	
-    // ... att2gyr
-    F(6,12) = -0.5;
-    F(7,13) = -0.5;
-    F(8,14) = -0.5;
+    model.att2att = -sk(om_ib);
 	
-    // ... Accel Markov Bias
-    F(9,9) = -1.0/config.tau_a;    F(10,10) = -1.0/config.tau_a;  F(11,11) = -1.0/config.tau_a;
-    F(12,12) = -1.0/config.tau_g;  F(13,13) = -1.0/config.tau_g;  F(14,14) = -1.0/config.tau_g;
-	
-    // State Transition Matrix: PHI = I15 + F*dt;
-    PHI = I15 + F * imu_dt;
-	
-    // Process Noise
-    G.setZero();
-    G(3,0) = -C_B2N(0,0);   G(3,1) = -C_B2N(0,1);   G(3,2) = -C_B2N(0,2);
-    G(4,0) = -C_B2N(1,0);   G(4,1) = -C_B2N(1,1);   G(4,2) = -C_B2N(1,2);
-    G(5,0) = -C_B2N(2,0);   G(5,1) = -C_B2N(2,1);   G(5,2) = -C_B2N(2,2);
-	
-    G(6,3) = -0.5;
-    G(7,4) = -0.5;
-    G(8,5) = -0.5;
-	
-    G(9,6) = 1.0; 	    G(10,7) = 1.0; 	    G(11,8) = 1.0;
-    G(12,9) = 1.0; 	    G(13,10) = 1.0; 	    G(14,11) = 1.0;
-
-    // Discrete Process Noise
-    Qw = G * Rw * G.transpose() * imu_dt;		// Qw = dt*G*Rw*G'
-    Q = PHI * Qw;					// Q = (I+F*dt)*Qw
-    Q = (Q + Q.transpose()) * 0.5;			// Q = 0.5*(Q+Q')
-	
-    // Covariance Time Update
-    P = PHI * P * PHI.transpose() + Q;			// P = PHI*P*PHI' + Q
-    P = (P + P.transpose()) * 0.5;			// P = 0.5*(P+P')
+    // Covariance Time Update: P = PHI*P*PHI' + Q, PHI = I15 + F*dt,
+    // Q = PHI*Qw (symmetrized), Qw = dt*G*Rw*G'
+    ekf15_propagate(P, P0, model, imu_dt);
 	
     nav.Pp0 = P(0,0);     nav.Pp1 = P(1,1);     nav.Pp2 = P(2,2);
     nav.Pv0 = P(3,3);     nav.Pv1 = P(4,4);     nav.Pv2 = P(5,5);
@@ -344,16 +287,30 @@ void EKF15::measurement_update(GPSdata gps) {
     y(4) = gps.ve - nav.ve;
     y(5) = gps.vd - nav.vd;
 		
-    // Kalman Gain
-    // K = P*H'*inv(H*P*H'+R)
-    K = P * H.transpose() * (H * P * H.transpose() + R).inverse();
-
-    // Covariance Update
-    ImKH = I15 - K * H;	                // ImKH = I - K*H
-		
-    KRKt = K * R * K.transpose();		// KRKt = K*R*K'
-		
-    P = ImKH * P * ImKH.transpose() + KRKt;	// P = ImKH*P*ImKH' + KRKt
+    if ( config.sequential ) {
+        // one scalar update per component (R is diagonal), each gated
+        // on its own innovation.  Computes x directly.
+        x.setZero();
+        for ( int i = 0; i < 6; i++ ) {
+            if ( !ekf15_scalar_update(P, x, i, y(i), R(i,i), config.gate_sigma) ) {
+                nav.gated++;
+            }
+        }
+    } else {
+        // Kalman Gain
+        // K = P*H'*inv(H*P*H'+R)
+        ekf15_pht(P, H, PHt);
+        S.noalias() = H * PHt;
+        S += R;
+        K.noalias() = PHt * S.inverse();
+
+        // Covariance Update
+        // P = ImKH*P*ImKH' + K*R*K', ImKH = I - K*H
+        ekf15_joseph_update(P, K, H, R, PHt, W);
+
+        // Error state correction
+        x.noalias() = K * y;
+    }
 		
     nav.Pp0 = P(0,0);     nav.Pp1 = P(1,1);     nav.Pp2 = P(2,2);
     nav.Pv0 = P(3,3);     nav.Pv1 = P(4,4);     nav.Pv2 = P(5,5);
@@ -362,7 +319,6 @@ void EKF15::measurement_update(GPSdata gps) {
     nav.Pgbx = P(12,12);  nav.Pgby = P(13,13);  nav.Pgbz = P(14,14);
 		
     // State Update
-    x = K * y;
     double denom = fabs(1.0 - (ECC2 * sin(nav.lat) * sin(nav.lat)));
     double denom_sqrt = sqrt(denom);
     double Re = EarthRadius / denom_sqrt;
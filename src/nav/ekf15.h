@@ -16,29 +16,28 @@
 
 #pragma once
 
+#if defined(ARDUPILOT_BUILD)
 #include "setup_board.h"
+#endif
 
 #include <math.h>
 #include "eigen3/Eigen/Core"
 #include "eigen3/Eigen/Geometry"
 #include "eigen3/Eigen/LU"
 
+#include "ekf15_cov.h"
 #include "nav_structs.h"
 
 // define some types for notational convenience and consistency
-//typedef Eigen::Matrix<float,6,6> Matrix6f;
-//typedef Eigen::Matrix<float,12,12> Matrix12f;
-//typedef Eigen::Matrix<float,15,15> Matrix15f;
-//typedef Eigen::Matrix<float,6,15> Matrix6x15f;
-//typedef Eigen::Matrix<float,15,6> Matrix15x6f;
-//typedef Eigen::Matrix<float,15,12> Matrix15x12f;
+typedef Eigen::Matrix<float,12,12> Matrix12f;
 typedef Eigen::Matrix<float,6,1> Vector6f;
-typedef Eigen::Matrix<float,15,1> Vector15f;
 
 class EKF15 {
 
 public:
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     EKF15() {
         default_config();
     }
@@ -58,17 +57,25 @@ public:
     
 private:
 
-    // make our big matrices dynamic (so they get allocated on the
-    // heap) to play nice on embedded systems with small stacks.
-    Eigen::MatrixXf F, PHI, P, Qw, Q, ImKH, KRKt, I15; // 15x15
-    Eigen::MatrixXf G;                                 // 15x12
-    Eigen::MatrixXf K;                                 // 15x6
-    Eigen::MatrixXf Rw;                                // 12x12
-    Eigen::MatrixXf H;                                 // 6x15
-    Eigen::MatrixXf R;                                 // 6x6
+    // fixed size so every product is an unrolled kernel with no heap
+    // allocation.  The filter lives in static storage (nav_mgr), not
+    // on the stack, and the scratch matrices below let every product
+    // be evaluated with noalias() straight into a member instead of a
+    // stack temporary.  F, PHI, G and Q are never formed: the time
+    // update works on the nonzero blocks, and P is packed (its upper
+    // triangle, see ekf15_cov.h.)
+    sym15_t P;
+    sym15_t P0;                                        // scratch (time update)
+    Matrix15x6f K;
+    Matrix12f Rw;
+    ekf15_model_t model;                               // Jacobian blocks
+    Matrix6x15f H;
+    Matrix6f R;
+    Matrix15x6f PHt, W;                                // scratch
+    Matrix6f S;                                        // innovation covariance
     Vector15f x;                                       // 15x1
     Vector6f y;                                        // 6x1
-    Eigen::Matrix3f C_N2B, C_B2N, I3 /* identity */, temp33;
+    Eigen::Matrix3f C_N2B, C_B2N, I3 /* identity */;
     Eigen::Vector3f grav, f_b, om_ib, pos_ins_ned, pos_gps_ned, dx, mag_ned;
 
     Eigen::Quaternionf quat;
@@ -0,0 +1,478 @@
+#include "ekf15_cov.h"
+
+// state blocks (row/column offsets)
+enum { POS = 0, VEL = 3, ATT = 6, ACC = 9, GYR = 12 };
+
+// the blocks of PHI = I + F*dt that aren't 0 or I
+struct phi_blocks_t {
+    float dt;                   // pos2gs
+    Eigen::Matrix3f gs2att;
+    Eigen::Matrix3f gs2acc;
+    Eigen::Matrix3f att2att;    // I + dt * att2att
+    float gs2pos;
+    float att2gyr;              // -0.5 dt
+    float acc2acc;              // 1 - dt/tau_a
+    float gyr2gyr;              // 1 - dt/tau_g
+};
+
+void sym15_t::setZero() {
+    for ( int k = 0; k < 120; k++ ) {
+        p[k] = 0.0f;
+    }
+}
+
+void sym15_t::unpack( Matrix15f &M ) const {
+    int k = 0;
+    for ( int j = 0; j < 15; j++ ) {
+        for ( int i = 0; i <= j; i++ ) {
+            M(i,j) = M(j,i) = p[k++];
+        }
+    }
+}
+
+void sym15_t::pack( const Matrix15f &M ) {
+    int k = 0;
+    for ( int j = 0; j < 15; j++ ) {
+        for ( int i = 0; i <= j; i++ ) {
+            p[k++] = M(i,j);
+        }
+    }
+}
+
+// Y = PHI * X for one row block (R) over columns C0..14
+template <int R, int C0>
+static inline void phi_rows( const phi_blocks_t &k, const Matrix15f &X, Matrix15f &Y ) {
+    const int N = 15 - C0;
+    Eigen::Block<Matrix15f,3,N> y = Y.block<3,N>(R, C0);
+    if ( R == POS ) {
+        y = X.block<3,N>(POS, C0) + k.dt * X.block<3,N>(VEL, C0);
+    } else if ( R == VEL ) {
+        y = X.block<3,N>(VEL, C0);
+        y.noalias() += k.gs2att * X.block<3,N>(ATT, C0);
+        y.noalias() += k.gs2acc * X.block<3,N>(ACC, C0);
+        y.row(2) += k.gs2pos * X.block<1,N>(POS + 2, C0);
+    } else if ( R == ATT ) {
+        y.noalias() = k.att2att * X.block<3,N>(ATT, C0);
+        y += k.att2gyr * X.block<3,N>(GYR, C0);
+    } else if ( R == ACC ) {
+        y = k.acc2acc * X.block<3,N>(ACC, C0);
+    } else {
+        y = k.gyr2gyr * X.block<3,N>(GYR, C0);
+    }
+}
+
+typedef Eigen::Matrix<float,3,15> Matrix3x15f;
+
+// columns C0..14 of rows r..r+2 of the packed P
+template <int C0>
+static inline void load_rows( const sym15_t &P, int r, Matrix3x15f &X ) {
+    for ( int j = C0; j < 15; j++ ) {
+        for ( int i = 0; i < 3; i++ ) {
+            X(i,j) = P(r + i, j);
+        }
+    }
+}
+
+// T = row block R of PHI*P over the columns PHI*P*PHI' needs for its
+// upper block triangle (from the POS block for the POS and VEL rows,
+// from R's own block after that.)  X is scratch.
+template <int R>
+static inline void phi_p_rows( const phi_blocks_t &k, const sym15_t &P,
+                               Matrix3x15f &X, Matrix3x15f &T ) {
+    enum { C0 = R < ATT ? 0 : R, N = 15 - C0 };
+    Eigen::Block<Matrix3x15f,3,N> t = T.block<3,N>(0, C0);
+    Eigen::Block<Matrix3x15f,3,N> x = X.block<3,N>(0, C0);
+    if ( R == POS ) {
+        load_rows<C0>(P, POS, T);
+        load_rows<C0>(P, VEL, X);
+        t += k.dt * x;
+    } else if ( R == VEL ) {
+        load_rows<C0>(P, VEL, T);
+        load_rows<C0>(P, ATT, X);
+        t.noalias() += k.gs2att * x;
+        load_rows<C0>(P, ACC, X);
+        t.noalias() += k.gs2acc * x;
+        for ( int j = C0; j < 15; j++ ) {
+            T(2,j) += k.gs2pos * P(POS + 2, j);
+        }
+    } else if ( R == ATT ) {
+        load_rows<C0>(P, ATT, X);
+        t.noalias() = k.att2att * x;
+        load_rows<C0>(P, GYR, X);
+        t += k.att2gyr * x;
+    } else if ( R == ACC ) {
+        load_rows<C0>(P, ACC, T);
+        t *= k.acc2acc;
+    } else {
+        load_rows<C0>(P, GYR, T);
+        t *= k.gyr2gyr;
+    }
+}
+
+// y = column block B of T*PHI'
+template <int B>
+static inline void phi_t_cols( const phi_blocks_t &k, const Matrix3x15f &T,
+                               Eigen::Matrix3f &y ) {
+    if ( B == POS ) {
+        y = T.block<3,3>(0, POS) + k.dt * T.block<3,3>(0, VEL);
+    } else if ( B == VEL ) {
+        y = T.block<3,3>(0, VEL);
+        y.noalias() += T.block<3,3>(0, ATT) * k.gs2att.transpose();
+        y.noalias() += T.block<3,3>(0, ACC) * k.gs2acc.transpose();
+        y.col(2) += k.gs2pos * T.col(POS + 2);
+    } else if ( B == ATT ) {
+        y.noalias() = T.block<3,3>(0, ATT) * k.att2att.transpose();
+        y += k.att2gyr * T.block<3,3>(0, GYR);
+    } else if ( B == ACC ) {
+        y = k.acc2acc * T.block<3,3>(0, ACC);
+    } else {
+        y = k.gyr2gyr * T.block<3,3>(0, GYR);
+    }
+}
+
+// block (R,B) of P, upper triangle only (R <= B)
+template <int R, int B>
+static inline void store_block( sym15_t &P, const Eigen::Matrix3f &y ) {
+    for ( int j = 0; j < 3; j++ ) {
+        for ( int i = 0; i < (R == B ? j + 1 : 3); i++ ) {
+            P.p[sym15_t::index(R + i, B + j)] = y(i,j);
+        }
+    }
+}
+
+void ekf15_propagate( sym15_t &P, sym15_t &S, const ekf15_model_t &m, float dt ) {
+    phi_blocks_t k;
+    k.dt = dt;
+    k.gs2att = dt * m.gs2att;
+    k.gs2acc = dt * m.gs2acc;
+    k.att2att = Eigen::Matrix3f::Identity() + dt * m.att2att;
+    k.gs2pos = dt * m.gs2pos;
+    k.att2gyr = -0.5f * dt;
+    k.acc2acc = 1.0f - dt / m.tau_a;
+    k.gyr2gyr = 1.0f - dt / m.tau_g;
+
+    // Qw = G*Rw*G'*dt is block diagonal (G maps each noise source into
+    // one state block), so Q = 0.5*(PHI*Qw + Qw*PHI') only has blocks
+    // where PHI does
+    Eigen::Vector3f q_acc = dt * m.rw.segment<3>(0);
+    Eigen::Vector3f q_att = 0.25f * dt * m.rw.segment<3>(3);
+    Eigen::Vector3f q_ab = dt * m.rw.segment<3>(6);
+    Eigen::Vector3f q_gb = dt * m.rw.segment<3>(9);
+    Eigen::Matrix3f q;
+    q.noalias() = m.gs2acc * q_acc.asDiagonal() * m.gs2acc.transpose();
+
+    // P = PHI*S*PHI' + Q one row block at a time (S is the old P), the
+    // upper block triangle only
+    S = P;
+    Matrix3x15f T, X;
+    Eigen::Matrix3f y;
+
+    phi_p_rows<POS>(k, S, X, T);
+    phi_t_cols<POS>(k, T, y);
+    store_block<POS,POS>(P, y);
+    phi_t_cols<VEL>(k, T, y);
+    y += 0.5f * dt * q;
+    store_block<POS,VEL>(P, y);
+    phi_t_cols<ATT>(k, T, y);
+    store_block<POS,ATT>(P, y);
+    phi_t_cols<ACC>(k, T, y);
+    store_block<POS,ACC>(P, y);
+    phi_t_cols<GYR>(k, T, y);
+    store_block<POS,GYR>(P, y);
+
+    phi_p_rows<VEL>(k, S, X, T);
+    phi_t_cols<VEL>(k, T, y);
+    y += q;
+    store_block<VEL,VEL>(P, y);
+    phi_t_cols<ATT>(k, T, y);
+    y.noalias() += 0.5f * k.gs2att * q_att.asDiagonal();
+    store_block<VEL,ATT>(P, y);
+    phi_t_cols<ACC>(k, T, y);
+    y.noalias() += 0.5f * k.gs2acc * q_ab.asDiagonal();
+    store_block<VEL,ACC>(P, y);
+    phi_t_cols<GYR>(k, T, y);
+    store_block<VEL,GYR>(P, y);
+
+    phi_p_rows<ATT>(k, S, X, T);
+    phi_t_cols<ATT>(k, T, y);
+    q.noalias() = 0.5f * k.att2att * q_att.asDiagonal();
+    y += q + q.transpose();
+    store_block<ATT,ATT>(P, y);
+    phi_t_cols<ACC>(k, T, y);
+    store_block<ATT,ACC>(P, y);
+    phi_t_cols<GYR>(k, T, y);
+    y.diagonal() += 0.5f * k.att2gyr * q_gb;
+    store_block<ATT,GYR>(P, y);
+
+    phi_p_rows<ACC>(k, S, X, T);
+    phi_t_cols<ACC>(k, T, y);
+    y.diagonal() += k.acc2acc * q_ab;
+    store_block<ACC,ACC>(P, y);
+    phi_t_cols<GYR>(k, T, y);
+    store_block<ACC,GYR>(P, y);
+
+    phi_p_rows<GYR>(k, S, X, T);
+    phi_t_cols<GYR>(k, T, y);
+    y.diagonal() += k.gyr2gyr * q_gb;
+    store_block<GYR,GYR>(P, y);
+}
+
+// PHt = sum over H's nonzero columns j of P.col(j) * H.col(j)'
+template <int N>
+static void pht( const sym15_t &P, const Eigen::Matrix<float,N,15> &H,
+                 Eigen::Matrix<float,15,N> &PHt ) {
+    PHt.setZero();
+    for ( int j = 0; j < 15; j++ ) {
+        if ( H.col(j).isZero() ) {
+            continue;
+        }
+        for ( int i = 0; i < 15; i++ ) {
+            PHt.row(i) += P(i,j) * H.col(j).transpose();
+        }
+    }
+}
+
+void ekf15_pht( const sym15_t &P, const Matrix6x15f &H, Matrix15x6f &PHt ) {
+    pht<6>(P, H, PHt);
+}
+
+void ekf15_pht( const sym15_t &P, const Matrix9x15f &H, Matrix15x9f &PHt ) {
+    pht<9>(P, H, PHt);
+}
+
+// T(i,j) = P(i,j) - K.row(i)*PHt.row(j)', T = ImKH*P from the packed P
+template <int N>
+static inline float joseph_t( const sym15_t &P, const Eigen::Matrix<float,15,N> &K,
+                              const Eigen::Matrix<float,15,N> &PHt, int i, int j ) {
+    float t = P(i,j);
+    for ( int n = 0; n < N; n++ ) {
+        t -= K(i,n) * PHt(j,n);
+    }
+    return t;
+}
+
+// ImKH = I - K*H, so T = ImKH*P = P - K*PHt' (rank N), and
+// T*ImKH' + K*R*K' = T + (K*R - T*H')*K' = T + W*K'.  T's elements
+// are formed from the packed P as needed, no dense T: first the
+// columns H touches for T*H', then each upper triangle element again
+// (rounded the same way) with W*K' added.  T*H' has to come from the
+// rounded T, not PHt - K*H*PHt: W corrects T's rounding, which
+// matters when R is below P's rounding.
+template <int N>
+static void joseph( sym15_t &P, const Eigen::Matrix<float,15,N> &K,
+                    const Eigen::Matrix<float,N,15> &H,
+                    const Eigen::Matrix<float,N,N> &R,
+                    const Eigen::Matrix<float,15,N> &PHt,
+                    Eigen::Matrix<float,15,N> &W ) {
+    W.noalias() = K * R;
+    for ( int j = 0; j < 15; j++ ) {
+        if ( H.col(j).isZero() ) {
+            continue;
+        }
+        for ( int i = 0; i < 15; i++ ) {
+            W.row(i) -= joseph_t<N>(P, K, PHt, i, j) * H.col(j).transpose();
+        }
+    }
+    int k = 0;
+    for ( int j = 0; j < 15; j++ ) {
+        for ( int i = 0; i <= j; i++ ) {
+            float sum = joseph_t<N>(P, K, PHt, i, j);
+            for ( int n = 0; n < N; n++ ) {
+                sum += W(i,n) * K(j,n);
+            }
+            P.p[k++] = sum;
+        }
+    }
+}
+
+void ekf15_joseph_update( sym15_t &P, const Matrix15x6f &K,
+                          const Matrix6x15f &H, const Matrix6f &R,
+                          const Matrix15x6f &PHt, Matrix15x6f &W ) {
+    joseph<6>(P, K, H, R, PHt, W);
+}
+
+void ekf15_joseph_update( sym15_t &P, const Matrix15x9f &K,
+                          const Matrix9x15f &H, const Matrix9f &R,
+                          const Matrix15x9f &PHt, Matrix15x9f &W ) {
+    joseph<9>(P, K, H, R, PHt, W);
+}
+
+// the common part: Ph = P*h, hx = h'*x.  The scalar Joseph form,
+// k = Ph/s, T = (I - k*h')*P = P - k*Ph' and
+// P = T*(I - k*h')' + r*k*k' = T + w*k' with w = r*k - T*h, where
+// T*h = Ph - k*hPh.  Each element of the upper triangle is computed
+// straight from the packed P, no dense T.  T is rounded before w*k'
+// is added: w carries r, which can be below P's rounding.
+static bool scalar_update( sym15_t &P, Vector15f &x, const Vector15f &Ph,
+                           float hPh, float hx, float y, float r, float gate ) {
+    float s = hPh + r;
+    if ( !(s > 0.0f) ) {
+        return false;           // P has lost definiteness (or r <= 0)
+    }
+    float innov = y - hx;
+    if ( gate > 0.0f && innov * innov > gate * gate * s ) {
+        return false;
+    }
+    Vector15f k = Ph * (1.0f / s);
+    Vector15f w = r * k - (Ph - k * hPh);
+    x += innov * k;
+    int n = 0;
+    for ( int j = 0; j < 15; j++ ) {
+        for ( int i = 0; i <= j; i++ ) {
+            float t = P.p[n] - k(i) * Ph(j);
+            P.p[n++] = t + w(i) * k(j);
+        }
+    }
+    return true;
+}
+
+bool ekf15_scalar_update( sym15_t &P, Vector15f &x, int i,
+                          float y, float r, float gate ) {
+    Vector15f Ph;
+    for ( int j = 0; j < 15; j++ ) {
+        Ph(j) = P(j,i);
+    }
+    return scalar_update(P, x, Ph, Ph(i), x(i), y, r, gate);
+}
+
+bool ekf15_scalar_update( sym15_t &P, Vector15f &x, int col,
+                          const Eigen::Vector3f &h3,
+                          float y, float r, float gate ) {
+    Vector15f Ph;
+    for ( int j = 0; j < 15; j++ ) {
+        Ph(j) = P(j,col) * h3(0) + P(j,col+1) * h3(1) + P(j,col+2) * h3(2);
+    }
+    return scalar_update(P, x, Ph, h3.dot(Ph.segment<3>(col)),
+                         h3.dot(x.segment<3>(col)), y, r, gate);
+}
+
+// W's columns are ordered so each row block's nonzero columns are a
+// suffix: [P*0..5 | acc noise | P*6..8 | gyro noise | P*9..11 | accel
+// bias noise | P*12..14 | gyro bias noise] (P*n is column n of PHI*U.)
+// PHI*U and M*G only reach rightwards (U is upper triangular and each
+// noise source drives its own block and the blocks above it), and the
+// Gram-Schmidt sweep only subtracts lower rows from upper ones, so row
+// block R never has a nonzero left of column C0 below.
+template <int R>
+static inline void mwgs_rows( Matrix15f &U, Vector15f &d, Matrix15x27f &W,
+                              const Eigen::Matrix<float,1,27> &dw ) {
+    enum { C0 = R == ATT ? 9 : R == ACC ? 15 : R == GYR ? 21 : 0, N = 27 - C0 };
+    Eigen::Matrix<float,1,N> c;
+    for ( int j = R + 2; j >= R; j-- ) {
+        c = W.block<1,N>(j, C0).cwiseProduct(dw.tail<N>());
+        float dj = W.block<1,N>(j, C0).dot(c);
+        d(j) = dj;
+        if ( !(dj > 0.0f) ) {
+            continue;           // (only if a whole row is zero)
+        }
+        float inv_dj = 1.0f / dj;
+        for ( int i = 0; i < j; i++ ) {
+            float u = W.block<1,N>(i, C0).dot(c) * inv_dj;
+            U(i,j) = u;
+            W.block<1,N>(i, C0) -= u * W.block<1,N>(j, C0);
+        }
+    }
+}
+
+void ekf15_ud_propagate( Matrix15f &U, Vector15f &d, Matrix15f &T, Matrix15x27f &W,
+                         const ekf15_model_t &m, float dt ) {
+    phi_blocks_t k;
+    k.dt = dt;
+    k.gs2att = dt * m.gs2att;
+    k.gs2acc = dt * m.gs2acc;
+    k.att2att = Eigen::Matrix3f::Identity() + dt * m.att2att;
+    k.gs2pos = dt * m.gs2pos;
+    k.att2gyr = -0.5f * dt;
+    k.acc2acc = 1.0f - dt / m.tau_a;
+    k.gyr2gyr = 1.0f - dt / m.tau_g;
+
+    // W = [PHI*U | M*G] (columns interleaved as above) with
+    // M = I + F*dt/2: M*G*Rw*G'*M'*dt is ekf15_propagate()'s Q (first
+    // order PHI term included) plus a dt^2 term, and can't go
+    // indefinite
+    phi_rows<POS,0>(k, U, T);
+    phi_rows<VEL,0>(k, U, T);
+    phi_rows<ATT,ATT>(k, U, T);
+    phi_rows<ACC,ACC>(k, U, T);
+    phi_rows<GYR,GYR>(k, U, T);
+    W.setZero();
+    W.block<6,6>(POS, 0) = T.block<6,6>(POS, POS);
+    W.block<9,3>(POS, 9) = T.block<9,3>(POS, ATT);
+    W.block<12,3>(POS, 15) = T.block<12,3>(POS, ACC);
+    W.block<15,3>(POS, 21) = T.block<15,3>(POS, GYR);
+    W.block<3,3>(POS, 6) = (0.5f * dt) * m.gs2acc;                  // accel noise
+    W.block<3,3>(VEL, 6) = m.gs2acc;
+    W.block<3,3>(VEL, 12) = (-0.25f * dt) * m.gs2att;               // gyro noise
+    W.block<3,3>(ATT, 12) = -0.5f * (Eigen::Matrix3f::Identity() + 0.5f * dt * m.att2att);
+    W.block<3,3>(VEL, 18) = (0.5f * dt) * m.gs2acc;                 // accel bias noise
+    W.block<3,3>(ACC, 18).diagonal().setConstant(1.0f - 0.5f * dt / m.tau_a);
+    W.block<3,3>(ATT, 24).diagonal().setConstant(-0.25f * dt);      // gyro bias noise
+    W.block<3,3>(GYR, 24).diagonal().setConstant(1.0f - 0.5f * dt / m.tau_g);
+
+    // weights, in the same column order
+    Eigen::Matrix<float,1,27> dw;
+    dw.segment<6>(0) = d.segment<6>(POS).transpose();
+    dw.segment<3>(6) = dt * m.rw.segment<3>(0).transpose();
+    dw.segment<3>(9) = d.segment<3>(ATT).transpose();
+    dw.segment<3>(12) = dt * m.rw.segment<3>(3).transpose();
+    dw.segment<3>(15) = d.segment<3>(ACC).transpose();
+    dw.segment<3>(18) = dt * m.rw.segment<3>(6).transpose();
+    dw.segment<3>(21) = d.segment<3>(GYR).transpose();
+    dw.segment<3>(24) = dt * m.rw.segment<3>(9).transpose();
+
+    // from the last row up: d(j) is row j's weighted norm, and each row
+    // above loses its (weighted) projection onto row j
+    U.setIdentity();
+    mwgs_rows<GYR>(U, d, W, dw);
+    mwgs_rows<ACC>(U, d, W, dw);
+    mwgs_rows<ATT>(U, d, W, dw);
+    mwgs_rows<VEL>(U, d, W, dw);
+    mwgs_rows<POS>(U, d, W, dw);
+}
+
+bool ekf15_ud_scalar_update( Matrix15f &U, Vector15f &d, Vector15f &x, int i,
+                             float y, float r, float gate ) {
+    // f = U'*h is row i of U (zero left of the diagonal), v = d.*f
+    float v[15];
+    float s = r;
+    for ( int j = i; j < 15; j++ ) {
+        v[j] = d(j) * U(i,j);
+        s += U(i,j) * v[j];
+    }
+    float innov = y - x(i);
+    if ( gate > 0.0f && innov * innov > gate * gate * s ) {
+        return false;
+    }
+    // columns left of i are untouched (f and v are zero there.)  b
+    // accumulates the unscaled gain P*h.
+    float b[15] = { 0.0f };
+    float alpha = r;
+    for ( int j = i; j < 15; j++ ) {
+        float f = U(i,j);
+        float alpha0 = alpha;
+        alpha += f * v[j];
+        float lambda = -f / alpha0;
+        d(j) *= alpha0 / alpha;
+        for ( int k = 0; k < j; k++ ) {
+            float u = U(k,j);
+            U(k,j) = u + lambda * b[k];
+            b[k] += u * v[j];
+        }
+        b[j] = v[j];
+    }
+    float gain = innov / alpha;
+    for ( int j = 0; j < 15; j++ ) {
+        x(j) += gain * b[j];
+    }
+    return true;
+}
+
+void ekf15_ud_variances( const Matrix15f &U, const Vector15f &d, Vector15f &var ) {
+    for ( int i = 0; i < 15; i++ ) {
+        float sum = d(i);
+        for ( int j = i + 1; j < 15; j++ ) {
+            sum += U(i,j) * U(i,j) * d(j);
+        }
+        var(i) = sum;
+    }
+}
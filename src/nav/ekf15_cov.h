@@ -0,0 +1,126 @@
+// Packed covariance storage, block structured covariance time update
+// and measurement updates for the 15 state filters (EKF15, EKF15_mag),
+// and the UD factored equivalents (EKF15_ud.)
+//
+// The error state is five 3 vectors: position, velocity, attitude,
+// accel bias and gyro bias.  The Jacobian F is mostly zero blocks
+// (identity, -C_B2N, skew matrices and diagonal Markov terms) and the
+// noise covariance Rw is diagonal, so rather than forming the dense
+// PHI = I + F*dt and G*Rw*G', multiply only the nonzero 3x3 blocks and
+// compute just the upper block triangle of the (symmetric) result.
+// Same answer as the dense form (to rounding) with ~1/14th the flops.
+
+#pragma once
+
+#include "eigen3/Eigen/Core"
+
+typedef Eigen::Matrix<float,15,15> Matrix15f;
+typedef Eigen::Matrix<float,12,1> Vector12f;
+typedef Eigen::Matrix<float,15,1> Vector15f;
+typedef Eigen::Matrix<float,15,27,Eigen::RowMajor> Matrix15x27f;
+typedef Eigen::Matrix<float,6,6> Matrix6f;
+typedef Eigen::Matrix<float,9,9> Matrix9f;
+typedef Eigen::Matrix<float,15,6> Matrix15x6f;
+typedef Eigen::Matrix<float,15,9> Matrix15x9f;
+typedef Eigen::Matrix<float,6,15> Matrix6x15f;
+typedef Eigen::Matrix<float,9,15> Matrix9x15f;
+
+// Symmetric 15x15, packed: the upper triangle by columns, 120 floats
+// instead of 225.  The kernels below read and write only these, so P
+// is symmetric by construction (no mirroring or symmetrizing.)  That
+// doesn't keep it positive definite: that's up to the updates (Joseph
+// form measurement updates, and the time update only adds.)
+struct sym15_t {
+    float p[120];
+
+    // P(i,j) = P(j,i) = p[index(i,j)]
+    static int index( int i, int j ) {
+        return i <= j ? j * (j + 1) / 2 + i : i * (i + 1) / 2 + j;
+    }
+    float operator()( int i, int j ) const { return p[index(i,j)]; }
+    float &operator()( int i, int j ) { return p[index(i,j)]; }
+    void setZero();
+    void unpack( Matrix15f &M ) const;
+    void pack( const Matrix15f &M );    // from M's upper triangle
+};
+
+// the nonzero blocks of F (and G)
+struct ekf15_model_t {
+    Eigen::Matrix3f gs2att;     // d vel / d att: -2 C_B2N [f_b x]
+    Eigen::Matrix3f gs2acc;     // d vel / d accel bias: -C_B2N (and G's accel noise block)
+    Eigen::Matrix3f att2att;    // d att / d att: -[om_ib x]
+    float gs2pos;               // d vd / d pd: -2 g / R
+    float tau_a;                // accel bias correlation time
+    float tau_g;                // gyro bias correlation time
+    Vector12f rw;               // diagonal of Rw
+};
+
+// P = PHI*P*PHI' + Q with PHI = I + F*dt, Qw = G*Rw*G'*dt and
+// Q = 0.5*(PHI*Qw + (PHI*Qw)').  Works on the packed triangle a row
+// block (3x15) at a time, no dense 15x15 P.  S is scratch (the old P.)
+void ekf15_propagate( sym15_t &P, sym15_t &S, const ekf15_model_t &m, float dt );
+
+// PHt = P*H' from the packed P, skipping H's zero columns (the gps
+// and mag H only touch the pos, vel and att blocks.)
+void ekf15_pht( const sym15_t &P, const Matrix6x15f &H, Matrix15x6f &PHt );
+void ekf15_pht( const sym15_t &P, const Matrix9x15f &H, Matrix15x9f &PHt );
+
+// Joseph form batch update, P = ImKH*P*ImKH' + K*R*K' with
+// ImKH = I - K*H (any gain K), computing just the upper triangle
+// straight from the packed P, no dense 15x15.  PHt = P*H' (the caller
+// has it from the gain), W is scratch.
+void ekf15_joseph_update( sym15_t &P, const Matrix15x6f &K,
+                          const Matrix6x15f &H, const Matrix6f &R,
+                          const Matrix15x6f &PHt, Matrix15x6f &W );
+void ekf15_joseph_update( sym15_t &P, const Matrix15x9f &K,
+                          const Matrix9x15f &H, const Matrix9f &R,
+                          const Matrix15x9f &PHt, Matrix15x9f &W );
+
+// Sequential measurement updates.  With a diagonal R each measurement
+// component can be applied as its own scalar update: no matrix
+// inverse, and the covariance update is the scalar Joseph form
+// (I - k*h')*P*(I - k*h')' + r*k*k' on the packed triangle, O(n^2)
+// (k = P*h/s, s = h'*P*h + r.)  Processing the components one after
+// another gives the same answer as the batch update (to rounding) and
+// lets each component be gated on its own innovation.
+//
+// x accumulates the error state correction over the components (zero
+// it first), y is the component's raw innovation (the correction so
+// far is subtracted here.)  If gate > 0 a component whose innovation
+// is beyond gate sigmas (y^2 > gate^2 * s) is skipped and false is
+// returned.  A component with s <= 0 is skipped the same way.
+//
+// The plain downdate P -= P*h*h'*P/s would lose r entirely when it is
+// below P's rounding (a measurement much more precise than the prior)
+// and leave P indefinite; the Joseph form keeps it (see the stress
+// case in host/rcfmu_nav_bench.cpp.)  The filters use these if
+// config.sequential is set.
+
+// h is the unit vector e_i (state i measured directly)
+bool ekf15_scalar_update( sym15_t &P, Vector15f &x, int i,
+                          float y, float r, float gate );
+// h is zero except h(col..col+2) = h3
+bool ekf15_scalar_update( sym15_t &P, Vector15f &x, int col,
+                          const Eigen::Vector3f &h3,
+                          float y, float r, float gate );
+
+// UD factored covariance, P = U*diag(d)*U' with U unit upper
+// triangular (zeros below the diagonal) and d > 0.  Every update
+// works on the factors, so P stays symmetric and positive definite in
+// float with no symmetrization (and no blown up filter to reinit.)
+
+// Thornton time update: the rows of W = [PHI*U | M*G] weighted by
+// diag(d, Rw*dt) are reorthogonalized (modified weighted Gram-Schmidt)
+// into the new U and d, skipping W's structurally zero columns.  With
+// M = I + F*dt/2, Q = M*G*Rw*G'*M'*dt matches ekf15_propagate()'s Q
+// to first order in dt.  T and W are scratch.
+void ekf15_ud_propagate( Matrix15f &U, Vector15f &d, Matrix15f &T, Matrix15x27f &W,
+                         const ekf15_model_t &m, float dt );
+
+// Bierman scalar update for state i measured directly, arguments and
+// gating as ekf15_scalar_update()
+bool ekf15_ud_scalar_update( Matrix15f &U, Vector15f &d, Vector15f &x, int i,
+                             float y, float r, float gate );
+
+// P(i,i) for every i
+void ekf15_ud_variances( const Matrix15f &U, const Vector15f &d, Vector15f &var );
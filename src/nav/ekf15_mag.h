@@ -16,29 +16,28 @@
 
 #pragma once
 
+#if defined(ARDUPILOT_BUILD)
 #include "setup_board.h"
+#endif
 
 #include <math.h>
 #include "eigen3/Eigen/Core"
 #include "eigen3/Eigen/Geometry"
 #include "eigen3/Eigen/LU"
 
+#include "ekf15_cov.h"
 #include "nav_structs.h"
 
 // define some types for notational convenience and consistency
-//typedef Eigen::Matrix<float,9,9>   Matrix9f;
-//typedef Eigen::Matrix<float,12,12> Matrix12f;
-//typedef Eigen::Matrix<float,15,15> Matrix15f;
-//typedef Eigen::Matrix<float,9,15>  Matrix9x15f;
-//typedef Eigen::Matrix<float,15,9>  Matrix15x9f;
-//typedef Eigen::Matrix<float,15,12> Matrix15x12f;
+typedef Eigen::Matrix<float,12,12> Matrix12f;
 typedef Eigen::Matrix<float,9,1> Vector9f;
-typedef Eigen::Matrix<float,15,1> Vector15f;
 
 class EKF15_mag {
 
 public:
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     EKF15_mag() {
 	default_config();
     }
@@ -59,17 +58,25 @@ public:
     
 private:
 
-    // make our big matrices dynamic (so they get allocated on the
-    // heap) to play nice on embedded systems with small stacks.
-    Eigen::MatrixXf F, PHI, P, Qw, Q, ImKH, KRKt, I15; // 15x15
-    Eigen::MatrixXf G;                                 // 15x12
-    Eigen::MatrixXf K;                                 // 15x9
-    Eigen::MatrixXf Rw;                                // 12x12
-    Eigen::MatrixXf H;                                 // 9x15
-    Eigen::MatrixXf R;                                 // 6x6
-    Vector15f x;                                       // 15x11
+    // fixed size so every product is an unrolled kernel with no heap
+    // allocation.  The filter lives in static storage (nav_mgr), not
+    // on the stack, and the scratch matrices below let every product
+    // be evaluated with noalias() straight into a member instead of a
+    // stack temporary.  F, PHI, G and Q are never formed: the time
+    // update works on the nonzero blocks, and P is packed (its upper
+    // triangle, see ekf15_cov.h.)
+    sym15_t P;
+    sym15_t P0;                                        // scratch (time update)
+    Matrix15x9f K;
+    Matrix12f Rw;
+    ekf15_model_t model;                               // Jacobian blocks
+    Matrix9x15f H;
+    Matrix9f R;
+    Matrix15x9f PHt, W;                                // scratch
+    Matrix9f S;                                        // innovation covariance
+    Vector15f x;                                       // 15x1
     Vector9f y;                                        // 9x1
-    Eigen::Matrix3f C_N2B, C_B2N, I3 /* identity */, temp33;
+    Eigen::Matrix3f C_N2B, C_B2N, I3 /* identity */;
     Eigen::Vector3f grav, f_b, om_ib, pos_ins_ned, pos_gps_ned, dx, mag_ned;
 
     Eigen::Quaternionf quat;
@@ -0,0 +1,334 @@
+/*! \file EKF_15state.c
+ *	\brief 15 state EKF navigation filter, UD factored covariance
+ *
+ *	\details  15 state EKF navigation filter using loosely integrated INS/GPS architecture.
+ * 	Time update is done after every IMU data acquisition and GPS measurement
+ * 	update is done every time the new data flag in the GPS data packet is set. Designed by Adhika Lie.
+ *	Attitude is parameterized using quaternions.
+ *	Estimates IMU bias errors.
+ *	\ingroup nav_fcns
+ *
+ * \author University of Minnesota
+ * \author Aerospace Engineering and Mechanics
+ * \copyright Copyright 2011 Regents of the University of Minnesota. All rights reserved.
+ *
+ */
+
+#include "nav_constants.h"
+#include "nav_functions.h"
+#include "ekf15_ud.h"
+
+const float P_P_INIT = 10.0;
+const float P_V_INIT = 1.0;
+const float P_A_INIT = 0.34906;   // 20 deg
+const float P_HDG_INIT = 3.14159; // 180 deg
+const float P_AB_INIT = 0.9810;   // 0.5*g
+const float P_GB_INIT = 0.01745;  // 5 deg/s
+
+const double Rew = 6.359058719353925e+006; // earth radius
+const double Rns = 6.386034030458164e+006; // earth radius
+
+const float g = 9.814;
+
+void EKF15_ud::set_config(NAVconfig _config) {
+    config = _config;
+}
+
+NAVconfig EKF15_ud::get_config() {
+    return config;
+}
+
+void EKF15_ud::default_config()
+{
+    config.sig_w_ax = 0.05;     // Std dev of Accelerometer Wide Band Noise (m/s^2)
+    config.sig_w_ay = 0.05;
+    config.sig_w_az = 0.05;
+    config.sig_w_gx = 0.00175;  // Std dev of gyro output noise (rad/s)  (0.1 deg/s)
+    config.sig_w_gy = 0.00175;
+    config.sig_w_gz = 0.00175;
+    config.sig_a_d  = 0.01;     // Std dev of Accelerometer Markov Bias
+    config.tau_a    = 100.0;    // Correlation time or time constant of b_{ad}
+    config.sig_g_d  = 0.00025;  // Std dev of correlated gyro bias (rad)
+    config.tau_g    = 50.0;     // Correlation time or time constant of b_{gd}
+    config.sig_gps_p_ne = 3.0;  // GPS measurement noise std dev (m)
+    config.sig_gps_p_d  = 6.0;  // GPS measurement noise std dev (m)
+    config.sig_gps_v_ne = 0.5;  // GPS measurement noise std dev (m/s)
+    config.sig_gps_v_d  = 1.0;  // GPS measurement noise std dev (m/s)
+    config.sig_mag      = 0.3;  // Magnetometer measurement noise std dev (normalized -1 to 1)
+    config.sequential   = true; // (always)
+    config.gate_sigma   = 0.0;  // no innovation gating
+}
+
+void EKF15_ud::init(IMUdata imu, GPSdata gps) {
+    I3.setIdentity();
+    
+
+    // Assemble the matrices
+    // .... gravity, g
+    grav = Eigen::Vector3f(0.0, 0.0, g);
+	
+    // ... H is the identity on the first 6 states
+
+    // first order correlation + white noise, tau = time constant for correlation
+    // gain on white noise plus gain on correlation
+    // Rw small - trust time update, Rw more - lean on measurement update
+    // split between accels and gyros and / or noise and correlation
+    // ... Rw (diagonal)
+    model.rw(0) = config.sig_w_ax*config.sig_w_ax;	model.rw(1) = config.sig_w_ay*config.sig_w_ay;	model.rw(2) = config.sig_w_az*config.sig_w_az; //1 sigma on noise
+    model.rw(3) = config.sig_w_gx*config.sig_w_gx;	model.rw(4) = config.sig_w_gy*config.sig_w_gy;	model.rw(5) = config.sig_w_gz*config.sig_w_gz;
+    model.rw(6) = 2*config.sig_a_d*config.sig_a_d/config.tau_a;	model.rw(7) = model.rw(6);	model.rw(8) = model.rw(6);
+    model.rw(9) = 2*config.sig_g_d*config.sig_g_d/config.tau_g;	model.rw(10) = model.rw(9);	model.rw(11) = model.rw(9);
+
+    // ... P (initial) = U*D*U', diagonal
+    U.setIdentity();
+    d(0) = P_P_INIT*P_P_INIT; 	d(1) = P_P_INIT*P_P_INIT; 	d(2) = P_P_INIT*P_P_INIT;
+    d(3) = P_V_INIT*P_V_INIT; 	d(4) = P_V_INIT*P_V_INIT; 	d(5) = P_V_INIT*P_V_INIT;
+    d(6) = P_A_INIT*P_A_INIT; 	d(7) = P_A_INIT*P_A_INIT; 	d(8) = P_HDG_INIT*P_HDG_INIT;
+    d(9) = P_AB_INIT*P_AB_INIT; 	d(10) = P_AB_INIT*P_AB_INIT;	d(11) = P_AB_INIT*P_AB_INIT;
+    d(12) = P_GB_INIT*P_GB_INIT; 	d(13) = P_GB_INIT*P_GB_INIT;	d(14) = P_GB_INIT*P_GB_INIT;
+	
+    // ... the fixed parts of the error model
+    model.gs2pos = -2 * g / EarthRadius;
+    model.tau_a = config.tau_a;
+    model.tau_g = config.tau_g;
+
+    // ... R (diagonal)
+    r(0) = config.sig_gps_p_ne*config.sig_gps_p_ne;	 r(1) = config.sig_gps_p_ne*config.sig_gps_p_ne;  r(2) = config.sig_gps_p_d*config.sig_gps_p_d;
+    r(3) = config.sig_gps_v_ne*config.sig_gps_v_ne;	 r(4) = config.sig_gps_v_ne*config.sig_gps_v_ne;  r(5) = config.sig_gps_v_d*config.sig_gps_v_d;
+	
+    // ... update P in get_nav
+    var = d;
+    nav.Pp0 = var(0);	  nav.Pp1 = var(1);	nav.Pp2 = var(2);
+    nav.Pv0 = var(3);	  nav.Pv1 = var(4);	nav.Pv2 = var(5);
+    nav.Pa0 = var(6);	  nav.Pa1 = var(7);	nav.Pa2 = var(8);
+	
+    nav.Pabx = var(9);	  nav.Paby = var(10);	nav.Pabz = var(11);
+    nav.Pgbx = var(12);   nav.Pgby = var(13);   nav.Pgbz = var(14);
+	
+    // .. then initialize states with GPS Data
+    nav.lat = gps.lat*D2R;
+    nav.lon = gps.lon*D2R;
+    nav.alt = gps.alt;
+	
+    nav.vn = gps.vn;
+    nav.ve = gps.ve;
+    nav.vd = gps.vd;
+	
+    // ... and initialize states with IMU Data, theta from Ax, aircraft
+    // at rest
+    nav.the = asin(imu.ax/g); 
+    // phi from Ay, aircraft at rest
+    nav.phi = asin(imu.ay/(g*cos(nav.the)));
+
+    // this is atan2(x, -y) because the aircraft body X,Y axis are
+    // swapped with the cartesion axes from the top down perspective
+    // nav.psi = 90*D2R - atan2(imu.hx, -imu.hy);
+    // printf("ekf: hx: %.2f hy: %.2f psi: %.2f\n", imu.hx, imu.hy, nav.psi*R2D);
+    // printf("atan2: %.2f\n", atan2(imu.hx, -imu.hy)*R2D);
+
+    // tilt compensated heading
+    nav.psi = atan2(imu.hz*sin(nav.phi)-imu.hy*cos(nav.phi),imu.hx*cos(nav.the)+imu.hy*sin(nav.the)*sin(nav.phi)+imu.hz*sin(nav.the)*cos(nav.phi));
+    //printf("tilt compensated psi: %.2f\n", nav.psi*R2D);
+	
+    quat = eul2quat(nav.phi, nav.the, nav.psi);
+
+    nav.abx = 0.0;
+    nav.aby = 0.0;
+    nav.abz = 0.0;
+
+    // I might want to initialize these to zero assuming imu driver
+    // has made some plausible attempt to zero it's own gyro biases.
+    nav.gbx = imu.p;
+    nav.gby = imu.q;
+    nav.gbz = imu.r;
+	
+    imu_last = imu;
+	
+    nav.gated = 0;
+    nav.time = imu.time;
+    nav.err_type = data_valid;
+}
+
+// Main get_nav filter function
+void EKF15_ud::time_update(IMUdata imu) {
+    // compute time-elapsed 'dt'
+    // This compute the navigation state at the DAQ's Time Stamp
+    float imu_dt = imu.time - imu_last.time;
+    if ( imu_dt < 0.0 ) { imu_dt = 0.0; }
+    if ( imu_dt > 1.0 ) { imu_dt = 1.0; }
+    nav.time = imu.time;
+
+    // ==================  Time Update  ===================
+
+    // Attitude Update
+    // ... Calculate Navigation Rate
+    Eigen::Vector3f vel_vec(nav.vn, nav.ve, nav.vd);
+    Eigen::Vector3d pos_ref(nav.lat, nav.lon, nav.alt);
+
+    if ( false ) {
+        // Get the new Specific forces and Rotation Rate from previous
+        // frame (k) to use in this frame (k+1).  Rectangular
+        // integration.
+        f_b(0) = imu_last.ax - nav.abx;
+        f_b(1) = imu_last.ay - nav.aby;
+        f_b(2) = imu_last.az - nav.abz;
+
+        om_ib(0) = imu_last.p - nav.gbx;
+        om_ib(1) = imu_last.q - nav.gby;
+        om_ib(2) = imu_last.r - nav.gbz;
+    } else if ( false ) {
+        // Combine the Specific forces and Rotation Rate from previous
+        // frame (k) with current frame (k+1) to use in this frame
+        // (k+1).  Trapazoidal integration.
+        f_b(0) = 0.5 * (imu_last.ax + imu.ax) - nav.abx;
+        f_b(1) = 0.5 * (imu_last.ay + imu.ay) - nav.aby;
+        f_b(2) = 0.5 * (imu_last.az + imu.az) - nav.abz;
+
+        om_ib(0) = 0.5 * (imu_last.p + imu.p) - nav.gbx;
+        om_ib(1) = 0.5 * (imu_last.q + imu.q) - nav.gby;
+        om_ib(2) = 0.5 * (imu_last.r + imu.r) - nav.gbz;
+    } else {
+        // Chris says the first two ways are BS
+        f_b(0) = imu.ax - nav.abx;
+        f_b(1) = imu.ay - nav.aby;
+        f_b(2) = imu.az - nav.abz;
+
+        om_ib(0) = imu.p - nav.gbx;
+        om_ib(1) = imu.q - nav.gby;
+        om_ib(2) = imu.r - nav.gbz;
+    }
+
+    imu_last = imu;
+
+    Eigen::Quaternionf dq = Eigen::Quaternionf(1.0, 0.5*om_ib(0)*imu_dt, 0.5*om_ib(1)*imu_dt, 0.5*om_ib(2)*imu_dt);
+    quat = (quat * dq).normalized();
+
+    if (quat.w() < 0) {
+        // Avoid quaternion flips sign
+        quat = Eigen::Quaternionf(-quat.w(), -quat.x(), -quat.y(), -quat.z());
+    }
+    
+    Eigen::Vector3f att_vec = quat2eul(quat);
+    nav.phi = att_vec(0);
+    nav.the = att_vec(1);
+    nav.psi = att_vec(2);
+	
+    // AHRS Transformations
+    C_N2B = quat2dcm(quat);
+    C_B2N = C_N2B.transpose();
+	
+    // Velocity Update
+    dx = C_B2N * f_b;
+    dx += grav;
+	
+    nav.vn += imu_dt*dx(0);
+    nav.ve += imu_dt*dx(1);
+    nav.vd += imu_dt*dx(2);
+	
+    // Position Update
+    dx = llarate(vel_vec, pos_ref);
+    nav.lat += imu_dt*dx(0);
+    nav.lon += imu_dt*dx(1);
+    nav.alt += imu_dt*dx(2);
+	
+    // JACOBIAN (the nonzero blocks)
+    // ... gs2att
+    model.gs2att.noalias() = -2.0f * C_B2N * sk(f_b);
+    // ... gs2acc
+    model.gs2acc = -C_B2N;
+    // ... att2att
+    model.att2att = -sk(om_ib);
+	
+    // Covariance Time Update: U*D*U' = PHI*U*D*U'*PHI' + Q, PHI =
+    // I15 + F*dt, Q = dt*G*Rw*G'
+    ekf15_ud_propagate(U, d, T15, W, model, imu_dt);
+	
+    ekf15_ud_variances(U, d, var);
+    nav.Pp0 = var(0);     nav.Pp1 = var(1);     nav.Pp2 = var(2);
+    nav.Pv0 = var(3);     nav.Pv1 = var(4);     nav.Pv2 = var(5);
+    nav.Pa0 = var(6);     nav.Pa1 = var(7);     nav.Pa2 = var(8);
+    nav.Pabx = var(9);    nav.Paby = var(10);   nav.Pabz = var(11);
+    nav.Pgbx = var(12);   nav.Pgby = var(13);   nav.Pgbz = var(14);
+
+    // ==================  DONE Time Update  ===================
+}
+
+void EKF15_ud::measurement_update(GPSdata gps) {
+    // ==================  GPS Update  ===================
+
+    // Position, converted to NED
+    Eigen::Vector3d pos_ref(nav.lat, nav.lon, nav.alt);
+    Eigen::Vector3d pos_ins_ecef = lla2ecef(pos_ref);
+
+    Eigen::Vector3d pos_gps(gps.lat*D2R, gps.lon*D2R, gps.alt);
+    Eigen::Vector3d pos_gps_ecef = lla2ecef(pos_gps);
+    
+    Eigen::Vector3d pos_error_ecef = pos_gps_ecef - pos_ins_ecef;
+    
+    Eigen::Vector3f pos_error_ned = ecef2ned(pos_error_ecef, pos_ref);
+
+    // Create Measurement: y
+    y(0) = pos_error_ned(0);
+    y(1) = pos_error_ned(1);
+    y(2) = pos_error_ned(2);
+		
+    y(3) = gps.vn - nav.vn;
+    y(4) = gps.ve - nav.ve;
+    y(5) = gps.vd - nav.vd;
+		
+    // one Bierman update per component (R is diagonal), each gated
+    // on its own innovation.  Computes x directly.
+    x.setZero();
+    for ( int i = 0; i < 6; i++ ) {
+        if ( !ekf15_ud_scalar_update(U, d, x, i, y(i), r(i), config.gate_sigma) ) {
+            nav.gated++;
+        }
+    }
+		
+    ekf15_ud_variances(U, d, var);
+    nav.Pp0 = var(0);     nav.Pp1 = var(1);     nav.Pp2 = var(2);
+    nav.Pv0 = var(3);     nav.Pv1 = var(4);     nav.Pv2 = var(5);
+    nav.Pa0 = var(6);     nav.Pa1 = var(7);     nav.Pa2 = var(8);
+    nav.Pabx = var(9);    nav.Paby = var(10);   nav.Pabz = var(11);
+    nav.Pgbx = var(12);   nav.Pgby = var(13);   nav.Pgbz = var(14);
+		
+    // State Update
+    double denom = fabs(1.0 - (ECC2 * sin(nav.lat) * sin(nav.lat)));
+    double denom_sqrt = sqrt(denom);
+    double Re = EarthRadius / denom_sqrt;
+    double Rn = EarthRadius * (1-ECC2) * denom_sqrt / denom;
+    nav.alt = nav.alt - x(2);
+    nav.lat = nav.lat + x(0)/(Re + nav.alt);
+    nav.lon = nav.lon + x(1)/(Rn + nav.alt)/cos(nav.lat);
+		
+    nav.vn = nav.vn + x(3);
+    nav.ve = nav.ve + x(4);
+    nav.vd = nav.vd + x(5);
+
+    // Attitude correction
+    Eigen::Quaternionf dq = Eigen::Quaternionf(1.0, x(6), x(7), x(8));
+    quat = (quat * dq).normalized();
+		
+    Eigen::Vector3f att_vec = quat2eul(quat);
+    nav.phi = att_vec(0);
+    nav.the = att_vec(1);
+    nav.psi = att_vec(2);
+	
+    nav.abx += x(9);
+    nav.aby += x(10);
+    nav.abz += x(11);
+
+    nav.gbx += x(12);
+    nav.gby += x(13);
+    nav.gbz += x(14);
+}
+
+
+NAVdata EKF15_ud::get_nav() {
+    nav.qw = quat.w();
+    nav.qx = quat.x();
+    nav.qy = quat.y();
+    nav.qz = quat.z();
+
+    return nav;
+}
@@ -0,0 +1,80 @@
+/*! \file EKF_15state.c
+ *	\brief 15 state EKF navigation filter, UD factored covariance
+ *
+ *	\details  15 state EKF navigation filter using loosely integrated INS/GPS architecture.
+ * 	Time update is done after every IMU data acquisition and GPS measurement
+ * 	update is done every time the new data flag in the GPS data packet is set. Designed by Adhika Lie.
+ *	Attitude is parameterized using quaternions.
+ *	Estimates IMU bias errors.
+ *	\ingroup nav_fcns
+ *
+ * \author University of Minnesota
+ * \author Aerospace Engineering and Mechanics
+ * \copyright Copyright 2011 Regents of the University of Minnesota. All rights reserved.
+ *
+ */
+
+#pragma once
+
+#if defined(ARDUPILOT_BUILD)
+#include "setup_board.h"
+#endif
+
+#include <math.h>
+#include "eigen3/Eigen/Core"
+#include "eigen3/Eigen/Geometry"
+
+#include "ekf15_cov.h"
+#include "nav_structs.h"
+
+typedef Eigen::Matrix<float,6,1> Vector6f;
+
+// EKF15 with the covariance kept as P = U*D*U' (Thornton time update,
+// Bierman scalar measurement updates, see ekf15_cov.h.)  Same states,
+// inputs and config; the gps components are always applied one at a
+// time (config.sequential is ignored.)
+class EKF15_ud {
+
+public:
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    EKF15_ud() {
+        default_config();
+    }
+    ~EKF15_ud() {}
+
+    // set/get error characteristics of navigation sensors
+    void set_config(NAVconfig _config);
+    NAVconfig get_config();
+    void default_config();
+
+    // main interface
+    void init(IMUdata imu, GPSdata gps);
+    void time_update(IMUdata imu);
+    void measurement_update(GPSdata gps);
+    
+    NAVdata get_nav();
+    
+private:
+
+    // fixed size, no heap allocation; the filter lives in static
+    // storage (nav_mgr) and the scratch matrices are members
+    Matrix15f U;                                       // unit upper triangular
+    Vector15f d;                                       // diagonal of D
+    Vector15f var;                                     // diagonal of P
+    ekf15_model_t model;                               // Jacobian blocks
+    Vector6f r;                                        // diagonal of R
+    Matrix15f T15;                                     // scratch
+    Matrix15x27f W;                                    // scratch
+    Vector15f x;                                       // 15x1
+    Vector6f y;                                        // 6x1
+    Eigen::Matrix3f C_N2B, C_B2N, I3 /* identity */;
+    Eigen::Vector3f grav, f_b, om_ib, pos_ins_ned, pos_gps_ned, dx, mag_ned;
+
+    Eigen::Quaternionf quat;
+
+    IMUdata imu_last;
+    NAVconfig config;
+    NAVdata nav;
+};
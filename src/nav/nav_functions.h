@@ -23,9 +23,11 @@
 
 #pragma once
 
+#if defined(ARDUPILOT_BUILD)
 #include <AP_HAL/AP_HAL.h>
 
 #include "setup_board.h"
+#endif
 
 #include <math.h>
 #include "eigen3/Eigen/Core"
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 struct IMUdata {
     double time;                // seconds
     float p, q, r;		// rad/sec
@@ -70,6 +72,7 @@ struct NAVdata {
     float Pa0, Pa1, Pa2;     // [rad], covariance estimate for angles
     float Pabx, Paby, Pabz;  // [m/sec^2], covariance estimate for accelerometer bias
     float Pgbx, Pgby, Pgbz;  // [rad/sec], covariance estimate for rate gyro bias
+    uint32_t gated;          // measurement components rejected by the innovation gate
     enum errdefs err_type;   // NAV filter status
 };
 
@@ -89,4 +92,6 @@ struct NAVconfig {
     float sig_gps_v_ne;
     float sig_gps_v_d;
     float sig_mag;
+    bool sequential;            // scalar measurement updates (R is diagonal)
+    float gate_sigma;           // innovation gate for sequential updates (0 = off)
 };
@@ -0,0 +1,130 @@
+#include "nav_filters.h"
+
+nav_filters_t::filter_t nav_filters_t::select( const string &selected ) {
+    if ( selected == "nav15" ) {
+        return NAV15;
+    } else if ( selected == "nav15_mag" ) {
+        return NAV15_MAG;
+    } else if ( selected == "nav15_ud" ) {
+        return NAV15_UD;
+    }
+    return NONE;
+}
+
+template <class F>
+void nav_filters_t::configure( PropertyNode &config_nav_node, F &f ) {
+    NAVconfig config = f.get_config();
+    if ( config_nav_node.hasChild("sig_w_accel") ) {
+        config.sig_w_ax = config_nav_node.getDouble("sig_w_accel");
+        config.sig_w_ay = config.sig_w_ax;
+        config.sig_w_az = config.sig_w_ax;
+    }
+    if ( config_nav_node.hasChild("sig_w_gyro") ) {
+        config.sig_w_gx = config_nav_node.getDouble("sig_w_gyro");
+        config.sig_w_gy = config.sig_w_gx;
+        config.sig_w_gz = config.sig_w_gx;
+    }
+    if ( config_nav_node.hasChild("sig_a_d") ) {
+        config.sig_a_d = config_nav_node.getDouble("sig_a_d");
+    }
+    if ( config_nav_node.hasChild("tau_a") ) {
+        config.tau_a = config_nav_node.getDouble("tau_a");
+    }
+    if ( config_nav_node.hasChild("sig_g_d") ) {
+        config.sig_g_d = config_nav_node.getDouble("sig_g_d");
+    }
+    if ( config_nav_node.hasChild("tau_g") ) {
+        config.tau_g = config_nav_node.getDouble("tau_g");
+    }
+    if ( config_nav_node.hasChild("sig_gps_p_ne") ) {
+        config.sig_gps_p_ne = config_nav_node.getDouble("sig_gps_p_ne");
+    }
+    if ( config_nav_node.hasChild("sig_gps_p_d") ) {
+        config.sig_gps_p_d = config_nav_node.getDouble("sig_gps_p_d");
+    }
+    if ( config_nav_node.hasChild("sig_gps_v_ne") ) {
+        config.sig_gps_v_ne = config_nav_node.getDouble("sig_gps_v_ne");
+    }
+    if ( config_nav_node.hasChild("sig_gps_v_d") ) {
+        config.sig_gps_v_d = config_nav_node.getDouble("sig_gps_v_d");
+    }
+    if ( config_nav_node.hasChild("sig_mag") ) {
+        config.sig_mag = config_nav_node.getDouble("sig_mag");
+    }
+    if ( config_nav_node.hasChild("sequential") ) {
+        config.sequential = config_nav_node.getBool("sequential");
+    }
+    if ( config_nav_node.hasChild("gate_sigma") ) {
+        config.gate_sigma = config_nav_node.getDouble("gate_sigma");
+    }
+    f.set_config(config);
+}
+
+void nav_filters_t::configure( PropertyNode &config_nav_node ) {
+    filter = select(config_nav_node.getString("select"));
+    configure(config_nav_node, ekf);
+    configure(config_nav_node, ekf_mag);
+    configure(config_nav_node, ekf_ud);
+}
+
+void nav_filters_t::set_config( NAVconfig config ) {
+    if ( filter == NAV15 ) {
+        ekf.set_config(config);
+    } else if ( filter == NAV15_MAG ) {
+        ekf_mag.set_config(config);
+    } else if ( filter == NAV15_UD ) {
+        ekf_ud.set_config(config);
+    }
+}
+
+NAVconfig nav_filters_t::get_config() {
+    if ( filter == NAV15 ) {
+        return ekf.get_config();
+    } else if ( filter == NAV15_MAG ) {
+        return ekf_mag.get_config();
+    } else if ( filter == NAV15_UD ) {
+        return ekf_ud.get_config();
+    }
+    return NAVconfig();
+}
+
+void nav_filters_t::init( const IMUdata &imu, const GPSdata &gps ) {
+    if ( filter == NAV15 ) {
+        ekf.init(imu, gps);
+    } else if ( filter == NAV15_MAG ) {
+        ekf_mag.init(imu, gps);
+    } else if ( filter == NAV15_UD ) {
+        ekf_ud.init(imu, gps);
+    }
+}
+
+void nav_filters_t::time_update( const IMUdata &imu ) {
+    if ( filter == NAV15 ) {
+        ekf.time_update(imu);
+    } else if ( filter == NAV15_MAG ) {
+        ekf_mag.time_update(imu);
+    } else if ( filter == NAV15_UD ) {
+        ekf_ud.time_update(imu);
+    }
+}
+
+void nav_filters_t::measurement_update( const IMUdata &imu, const GPSdata &gps ) {
+    if ( filter == NAV15 ) {
+        ekf.measurement_update(gps);
+    } else if ( filter == NAV15_MAG ) {
+        ekf_mag.measurement_update(imu, gps);
+    } else if ( filter == NAV15_UD ) {
+        ekf_ud.measurement_update(gps);
+    }
+}
+
+NAVdata nav_filters_t::get_nav() {
+    if ( filter == NAV15 ) {
+        return ekf.get_nav();
+    } else if ( filter == NAV15_MAG ) {
+        return ekf_mag.get_nav();
+    } else if ( filter == NAV15_UD ) {
+        return ekf_ud.get_nav();
+    }
+    return NAVdata();
+}
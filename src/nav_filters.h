@@ -0,0 +1,40 @@
+// The selectable nav filters behind nav_mgr
+
+#pragma once
+
+#include "props2.h"
+#include "nav/nav_structs.h"
+#include "nav/ekf15.h"
+#include "nav/ekf15_mag.h"
+#include "nav/ekf15_ud.h"
+
+// /config/nav/select picks one filter ("nav15", "nav15_mag" or
+// "nav15_ud", anything else is none) and every call goes to it.  The
+// /config/nav tuning is applied to all of them so the selection can
+// change at run time.  No HAL here, so the host nav bench runs the
+// same selection and dispatch as the firmware.
+class nav_filters_t {
+
+public:
+
+    enum filter_t { NONE, NAV15, NAV15_MAG, NAV15_UD };
+    filter_t filter = NONE;
+
+    static filter_t select( const string &selected );
+    void configure( PropertyNode &config_nav_node ); // selection and tuning
+
+    void set_config( NAVconfig config );  // the selected filter's
+    NAVconfig get_config();
+    void init( const IMUdata &imu, const GPSdata &gps );
+    void time_update( const IMUdata &imu );
+    void measurement_update( const IMUdata &imu, const GPSdata &gps );
+    NAVdata get_nav();          // zeros if none is selected
+
+private:
+
+    EKF15 ekf;
+    EKF15_mag ekf_mag;
+    EKF15_ud ekf_ud;
+
+    template <class F> static void configure( PropertyNode &config_nav_node, F &f );
+};
@@ -1,7 +1,18 @@
 #include <math.h>
 
+#include <AP_HAL/AP_HAL.h>
+
+#include "comms.h"
+#include "rcfmu_messages.h"
+
 #include "nav_mgr.h"
 
+static bool handle_reset_ekf( uint8_t *buf, uint16_t message_size ) {
+    console->printf("received reset ekf command\n");
+    nav_mgr.reinit();
+    return true;
+}
+
 void nav_mgr_t::init() {
     config_nav_node = PropertyNode("/config/nav");
     gps_node = PropertyNode("/sensors/gps");
@@ -23,63 +34,32 @@ void nav_mgr_t::init() {
     configure();
     console->printf("configured ekf:\n");
     config_nav_node.pretty_print();
+    comms.register_handler( rcfmu_message::command_reset_ekf_id,
+                            rcfmu_message::command_reset_ekf_t::len,
+                            handle_reset_ekf, true );
+#if defined(AURA_ONBOARD_EKF)
+    if ( config_nav_node.getBool("thread") ) {
+        // below the main loop priority: the filter fills idle time
+        threaded = hal.scheduler->thread_create(
+            FUNCTOR_BIND_MEMBER(&nav_mgr_t::thread_main, void),
+            "nav", 8192, AP_HAL::Scheduler::PRIORITY_IO, 0);
+        console->printf("EKF: filter thread %s\n", threaded ? "started" : "failed");
+    }
+#endif
 }
 
+// the /config/nav tuning goes to every filter so /config/nav/select
+// can be switched at run time (update() re-reads it each frame)
 void nav_mgr_t::configure() {
-    string selected = config_nav_node.getString("select");
-    NAVconfig config;
-    if ( selected == "nav15" ) {
-        config = ekf.get_config();
-    } else if ( selected == "nav15_mag" ) {
-        config = ekf_mag.get_config();
-    }
-    if ( config_nav_node.hasChild("sig_w_accel") ) {
-        config.sig_w_ax = config_nav_node.getDouble("sig_w_accel");
-        config.sig_w_ay = config.sig_w_ax;
-        config.sig_w_az = config.sig_w_ax;
-    }
-    if ( config_nav_node.hasChild("sig_w_gyro") ) {
-        config.sig_w_gx = config_nav_node.getDouble("sig_w_gyro");
-        config.sig_w_gy = config.sig_w_gx;
-        config.sig_w_gz = config.sig_w_gx;
-    }
-    if ( config_nav_node.hasChild("sig_a_d") ) {
-        config.sig_a_d = config_nav_node.getDouble("sig_a_d");
-    }
-    if ( config_nav_node.hasChild("tau_a") ) {
-        config.tau_a = config_nav_node.getDouble("tau_a");
-    }
-    if ( config_nav_node.hasChild("sig_g_d") ) {
-        config.sig_g_d = config_nav_node.getDouble("sig_g_d");
-    }
-    if ( config_nav_node.hasChild("tau_g") ) {
-        config.tau_g = config_nav_node.getDouble("tau_g");
-    }
-    if ( config_nav_node.hasChild("sig_gps_p_ne") ) {
-        config.sig_gps_p_ne = config_nav_node.getDouble("sig_gps_p_ne");
-    }
-    if ( config_nav_node.hasChild("sig_gps_p_d") ) {
-        config.sig_gps_p_d = config_nav_node.getDouble("sig_gps_p_d");
-    }
-    if ( config_nav_node.hasChild("sig_gps_v_ne") ) {
-        config.sig_gps_v_ne = config_nav_node.getDouble("sig_gps_v_ne");
-    }
-    if ( config_nav_node.hasChild("sig_gps_v_d") ) {
-        config.sig_gps_v_d = config_nav_node.getDouble("sig_gps_v_d");
-    }
-    if ( config_nav_node.hasChild("sig_mag") ) {
-        config.sig_mag = config_nav_node.getDouble("sig_mag");
-    }
-    if ( selected == "nav15" ) {
-        ekf.set_config(config);
-    } else if ( selected == "nav15_mag" ) {
-        ekf_mag.set_config(config);
-    }
+#if defined(AURA_ONBOARD_EKF)
+    filters.configure(config_nav_node);
+#endif
 }
 
 void nav_mgr_t::update() {
 #if defined(AURA_ONBOARD_EKF)
-    IMUdata imu1;
+    nav_input_t in;
+    IMUdata &imu1 = in.imu;
     imu1.time = imu_node.getDouble("timestamp");
     imu1.p = imu_node.getDouble("p_rps");
     imu1.q = imu_node.getDouble("q_rps");
@@ -91,7 +71,7 @@ void nav_mgr_t::update() {
     imu1.hy = imu_node.getDouble("hy");
     imu1.hz = imu_node.getDouble("hz");
     
-    GPSdata gps1;
+    GPSdata &gps1 = in.gps;
     gps1.time = gps_node.getDouble("timestamp");
     gps1.unix_sec = gps_node.getDouble("unix_sec");
     gps1.lat = gps_node.getDouble("latitude_deg");
@@ -100,86 +80,139 @@ void nav_mgr_t::update() {
     gps1.vn = gps_node.getDouble("vn_mps");
     gps1.ve = gps_node.getDouble("ve_mps");
     gps1.vd = gps_node.getDouble("vd_mps");
+    in.gps_millis = gps_node.getUInt("millis");
+    in.gps_settle = gps_node.getBool("settle");
+    in.filter = nav_filters_t::select(config_nav_node.getString("select"));
 
-    string selected = config_nav_node.getString("select");
-    if ( !ekf_inited and gps_node.getBool("settle") ) {
-        if ( selected == "nav15" ) {
-            ekf.init(imu1, gps1);
-        } else if ( selected == "nav15_mag" ) {
-            ekf_mag.init(imu1, gps1);
+    nav_output_t out;
+    if ( threaded ) {
+        // hand off the sample and publish the newest finished output
+        // (if any, the filter runs a frame or so behind)
+        input_queue.push(in);
+        input_ready.signal();
+        nav_node.setUInt("thread_queue_dropped", input_queue.dropped);
+        nav_node.setUInt("thread_queue_high", input_queue.high_water);
+        if ( output.version() == output_version || !output.read(out) ) {
+            return;
         }
+        output_version = output.version();
+    } else {
+        step(in, out);
+    }
+    if ( out.step_usec > max_step_usec ) {
+        max_step_usec = out.step_usec;
+    }
+    nav_node.setUInt("step_usec", out.step_usec);
+    nav_node.setUInt("max_step_usec", max_step_usec);
+    publish(out);
+#endif // AURA_ONBOARD_EKF
+}
+
+// one filter update (called from the main loop or the filter thread,
+// never both, so this is the only code touching the filter state)
+void nav_mgr_t::step( const nav_input_t &in, nav_output_t &out ) {
+    uint32_t start_usec = AP_HAL::micros();
+    out = last_out;
+#if defined(AURA_ONBOARD_EKF)
+    const IMUdata &imu1 = in.imu;
+    const GPSdata &gps1 = in.gps;
+    if ( reinit_request.exchange(false) ) {
+        ekf_inited = false;
+    }
+    if ( in.filter != filters.filter ) {
+        // selection changed: start the new filter from scratch
+        filters.filter = in.filter;
+        ekf_inited = false;
+    }
+    if ( !ekf_inited and in.gps_settle ) {
+        filters.init(imu1, gps1);
         ekf_inited = true;
         console->printf("EKF: initialized\n");
     } else if ( ekf_inited ) {
-        if ( selected == "nav15" ) {
-            ekf.time_update(imu1);
-        } else if ( selected == "nav15_mag" ) {
-            ekf_mag.time_update(imu1);
-        }
-        if ( gps_node.getUInt("millis") > gps_last_millis ) {
-            gps_last_millis = gps_node.getUInt("millis");
-            if ( selected == "nav15" ) {
-                ekf.measurement_update(gps1);
-            } else if ( selected == "nav15_mag" ) {
-                ekf_mag.measurement_update(imu1, gps1);
-            }
-            status = 2;         // ok
-        }
-        if ( selected == "nav15" ) {
-            data = ekf.get_nav();
-        } else if ( selected == "nav15_mag" ) {
-            data = ekf_mag.get_nav();
+        filters.time_update(imu1);
+        if ( in.gps_millis > gps_last_millis ) {
+            gps_last_millis = in.gps_millis;
+            filters.measurement_update(imu1, gps1);
+            out.status = 2;     // ok
         }
+        out.data = filters.get_nav();
 
         // sanity checks in case degenerate input leads to the filter
         // blowing up.  look for nans (or even negative #'s) in the
         // covariance matrix.
-        if ( std::isnan(data.Pp0) or std::isnan(data.Pv0)
-             or std::isnan(data.Pa0) or (data.Pp0 < -0.1)
-             or (data.Pv0 < -0.1) or (data.Pa0 < -0.1) ) {
+        const NAVdata &d = out.data;
+        if ( std::isnan(d.Pp0) or std::isnan(d.Pv0)
+             or std::isnan(d.Pa0) or (d.Pp0 < -0.1)
+             or (d.Pv0 < -0.1) or (d.Pa0 < -0.1) ) {
             console->printf("filter blew up...\n");
-            status = 0;
-            reinit();
+            out.status = 0;
+            ekf_inited = false;
         }
         if ( AP_HAL::millis() - gps_last_millis >= 2000 ) {
             // last gps message > 2 seconds ago
-            status = 1;         // no gps
+            out.status = 1;     // no gps
         }
-        
-        // publish
-        nav_node.setDouble("latitude_rad", data.lat);
-        nav_node.setDouble("longitude_rad", data.lon);
-        nav_node.setDouble("altitude_m", data.alt);
-        nav_node.setDouble("vn_mps", data.vn);
-        nav_node.setDouble("ve_mps", data.ve);
-        nav_node.setDouble("vd_mps", data.vd);
-        nav_node.setDouble("phi_rad", data.phi);
-        nav_node.setDouble("the_rad", data.the);
-        nav_node.setDouble("psi_rad", data.psi);
-        nav_node.setDouble("p_bias", data.gbx);
-        nav_node.setDouble("q_bias", data.gby);
-        nav_node.setDouble("r_bias", data.gbz);
-        nav_node.setDouble("ax_bias", data.abx);
-        nav_node.setDouble("ay_bias", data.aby);
-        nav_node.setDouble("az_bias", data.abz);
-        nav_node.setDouble("Pp0", data.Pp0);
-        nav_node.setDouble("Pp1", data.Pp1);
-        nav_node.setDouble("Pp2", data.Pp2);
-        nav_node.setDouble("Pv0", data.Pv0);
-        nav_node.setDouble("Pv1", data.Pv1);
-        nav_node.setDouble("Pv2", data.Pv2);
-        nav_node.setDouble("Pa0", data.Pa0);
-        nav_node.setDouble("Pa1", data.Pa1);
-        nav_node.setDouble("Pa2", data.Pa2);
     } else {
-        status = 0;             // not initialized
+        out.status = 0;         // not initialized
     }
-    nav_node.setInt("status", status);
 #endif // AURA_ONBOARD_EKF
+    out.inited = ekf_inited;
+    out.step_usec = AP_HAL::micros() - start_usec;
+    last_out = out;
+}
+
+// filter thread: sleep until update() queues a sample, then drain
+// the queue and publish each result
+void nav_mgr_t::thread_main() {
+    nav_input_t in;
+    nav_output_t out;
+    while ( true ) {
+        input_ready.wait_blocking();
+        while ( input_queue.pop(in) ) {
+            step(in, out);
+            output.write(out);
+        }
+    }
+}
+
+void nav_mgr_t::publish( const nav_output_t &out ) {
+    data = out.data;
+    status = out.status;
+    const NAVdata &d = out.data;
+    if ( out.inited ) {
+        nav_node.setDouble("timestamp", d.time);
+        nav_node.setDouble("latitude_rad", d.lat);
+        nav_node.setDouble("longitude_rad", d.lon);
+        nav_node.setDouble("altitude_m", d.alt);
+        nav_node.setDouble("vn_mps", d.vn);
+        nav_node.setDouble("ve_mps", d.ve);
+        nav_node.setDouble("vd_mps", d.vd);
+        nav_node.setDouble("phi_rad", d.phi);
+        nav_node.setDouble("the_rad", d.the);
+        nav_node.setDouble("psi_rad", d.psi);
+        nav_node.setDouble("p_bias", d.gbx);
+        nav_node.setDouble("q_bias", d.gby);
+        nav_node.setDouble("r_bias", d.gbz);
+        nav_node.setDouble("ax_bias", d.abx);
+        nav_node.setDouble("ay_bias", d.aby);
+        nav_node.setDouble("az_bias", d.abz);
+        nav_node.setDouble("Pp0", d.Pp0);
+        nav_node.setDouble("Pp1", d.Pp1);
+        nav_node.setDouble("Pp2", d.Pp2);
+        nav_node.setDouble("Pv0", d.Pv0);
+        nav_node.setDouble("Pv1", d.Pv1);
+        nav_node.setDouble("Pv2", d.Pv2);
+        nav_node.setDouble("Pa0", d.Pa0);
+        nav_node.setDouble("Pa1", d.Pa1);
+        nav_node.setDouble("Pa2", d.Pa2);
+        nav_node.setUInt("gated", d.gated);
+    }
+    nav_node.setInt("status", out.status);
 }
 
+// safe from any thread, the filter picks it up on its next step
 void nav_mgr_t::reinit() {
-    ekf_inited = false;
+    reinit_request = true;
 }
 
 // global shared instance
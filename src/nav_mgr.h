@@ -2,28 +2,66 @@
 
 #pragma once
 
+#include <atomic>
+
+#include <AP_HAL/AP_HAL.h>
+
 #include "setup_board.h"
 #include "props2.h"
+#include "seqlock.h"
+#include "spsc_queue.h"
 #include "nav/nav_structs.h"
 
 #if defined(AURA_ONBOARD_EKF)
-#include "nav/ekf15.h"
-#include "nav/ekf15_mag.h"
+#include "nav_filters.h"
 #endif
 
 class nav_mgr_t {
     
 private:
+    // filter input: one imu sample plus the current gps fix
+    struct nav_input_t {
+        IMUdata imu;
+        GPSdata gps;
+        uint32_t gps_millis;
+        bool gps_settle;
+#if defined(AURA_ONBOARD_EKF)
+        nav_filters_t::filter_t filter; // /config/nav/select at sample time
+#endif
+    };
+    // filter output snapshot
+    struct nav_output_t {
+        NAVdata data;
+        uint8_t status;
+        bool inited;
+        uint32_t step_usec;     // filter cost of this update
+    };
+    // filter side state (owned by whichever thread runs step())
     bool ekf_inited = false;
     unsigned long int gps_last_millis = 0;
+    nav_output_t last_out = {};
+    std::atomic<bool> reinit_request{false};
 #if defined(AURA_ONBOARD_EKF)
-    EKF15 ekf;
-    EKF15_mag ekf_mag;
+    nav_filters_t filters;
 #endif
+    // Optional filter thread (/config/nav/thread = true): the main
+    // loop queues inputs and picks up the latest output, so frame
+    // timing doesn't depend on the filter cost.
+    bool threaded = false;
+    spsc_queue_t<nav_input_t, 8> input_queue;
+    HAL_BinarySemaphore input_ready; // signalled by update() per push
+    seqlock_t<nav_output_t> output;
+    uint32_t output_version = 0;
+    uint32_t max_step_usec = 0;
+
     PropertyNode config_nav_node;
     PropertyNode gps_node;
     PropertyNode imu_node;
     PropertyNode nav_node;
+
+    void step( const nav_input_t &in, nav_output_t &out );
+    void thread_main();
+    void publish( const nav_output_t &out );
     
 public:
     NAVdata data;
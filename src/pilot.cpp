@@ -3,6 +3,7 @@
 
 #include "setup_board.h"
 
+#include "comms.h"
 #include "pilot.h"
 
 // 982 - 2006 (frsky) / 1496
@@ -40,6 +41,13 @@ uint16_t pilot_t::norm2rcout(float norm_val, uint8_t channel) {
     return output;
 }
 
+static bool handle_inceptors( uint8_t *buf, uint16_t message_size ) {
+    static rcfmu_message::command_inceptors_t inceptors;
+    inceptors.unpack(buf, message_size);
+    pilot.post_inceptors(comms.command_port(), inceptors);
+    return true;
+}
+
 void pilot_t::init() {
     config_eff_gains = PropertyNode("/config/pwm");
     effector_node = PropertyNode("/effectors");
@@ -71,6 +79,10 @@ void pilot_t::init() {
     
     mixer.init();
     switches.init();
+
+    comms.register_handler( rcfmu_message::command_inceptors_id,
+                            rcfmu_message::command_inceptors_t::len,
+                            handle_inceptors );
 }
 
 bool pilot_t::read() {
@@ -154,5 +166,44 @@ void pilot_t::update_ap( rcfmu_message::command_inceptors_t *inceptors ) {
     changed = true;
 }
 
+// A host timestamp this far behind the newest one means the host
+// restarted (its clock started over), not a stale command.
+static const uint64_t INCEPTORS_RESTART_USEC = 1000000;
+
+// host_usec = 0 means the host doesn't stamp its commands: the latest
+// arrival wins.  Stamped commands are ordered per port (each port is
+// a separate host with its own clock.)
+void pilot_t::post_inceptors( uint8_t port, const rcfmu_message::command_inceptors_t &inceptors ) {
+    if ( port >= comms_t::MAX_PORTS ) {
+        port = 0;
+    }
+    if ( inceptors.host_usec != 0 ) {
+        if ( inceptors_seen[port]
+             && inceptors.host_usec <= inceptors_host_usec[port]
+             && inceptors_host_usec[port] - inceptors.host_usec < INCEPTORS_RESTART_USEC ) {
+            inceptors_stale++;
+            return;
+        }
+        inceptors_seen[port] = true;
+        inceptors_host_usec[port] = inceptors.host_usec;
+    }
+    if ( inceptors_pending ) {
+        inceptors_superseded++;
+    }
+    inceptors_mailbox = inceptors;
+    inceptors_pending = true;
+}
+
+bool pilot_t::apply_inceptors() {
+    if ( !inceptors_pending ) {
+        return false;
+    }
+    update_ap(&inceptors_mailbox);
+    inceptors_pending = false;
+    pilot_node.setUInt("inceptors_stale", inceptors_stale);
+    pilot_node.setUInt("inceptors_superseded", inceptors_superseded);
+    return true;
+}
+
 // global shared instance
 pilot_t pilot;
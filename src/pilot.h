@@ -3,6 +3,7 @@
 #include "setup_board.h"
 #include "props2.h"
 
+#include "comms.h"
 #include "rcfmu_messages.h"
 #include "mixer.h"
 #include "switches.h"
@@ -20,6 +21,14 @@ private:
 
     uint32_t last_input = 0;
 
+    // latest-wins inceptor mailbox: the handler only posts here, the
+    // newest command (by host timestamp) is applied once per frame.
+    // Each port (host) has its own timestamp watermark.
+    rcfmu_message::command_inceptors_t inceptors_mailbox;
+    bool inceptors_pending = false;
+    bool inceptors_seen[comms_t::MAX_PORTS] = {};       // stamped command seen
+    uint64_t inceptors_host_usec[comms_t::MAX_PORTS] = {}; // newest accepted stamp
+
     PropertyNode config_eff_gains;
     PropertyNode effector_node;
     PropertyNode pilot_node;
@@ -93,6 +102,13 @@ public:
     
     void update_ap( rcfmu_message::command_inceptors_t *inceptors );
 
+    // inceptor mailbox (post from the message handler, apply once per
+    // frame after comms.read_commands())
+    uint32_t inceptors_stale = 0;       // older than one already seen
+    uint32_t inceptors_superseded = 0;  // replaced before being applied
+    void post_inceptors( uint8_t port, const rcfmu_message::command_inceptors_t &inceptors );
+    bool apply_inceptors();
+
 };
 
 extern pilot_t pilot;
@@ -10,8 +10,6 @@ static float amps_offset = 0.0;
 void power_t::init() {
     PropertyNode config_node("/config/power");
     power_node = PropertyNode("/sensors/power");
-    PropertyNode("/sensors/power");
-    hal.scheduler->delay(1000);
     batt_volt_divider = AP_BATT_VOLTDIVIDER_DEFAULT;
     if ( config_node.hasChild("batt_volt_divider") ) {
         batt_volt_divider = config_node.getDouble("batt_volt_divider");
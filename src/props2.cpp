@@ -45,11 +45,13 @@ static bool is_integer(const string val) {
 bool PropertyNode::extend_array(Value *node, int size) {
     if ( !node->IsArray() ) {
         node->SetArray();
+        generation++;
     }
     for ( int i = node->Size(); i < size; i++ ) {
         // printf("    extending: %d\n", i);
         Value newobj(kObjectType);
         node->PushBack(newobj, doc->GetAllocator());
+        generation++;
     }
     return true;
 }
@@ -63,6 +65,7 @@ Value *PropertyNode::find_node_from_path(Value *start_node, string path, bool cr
     printf("PropertyNode(%s)\n", path.c_str());
     if ( !node->IsObject() ) {
         node->SetObject();
+        generation++;
         if ( !node->IsObject() ) {
             printf("  still not object after setting to object.\n");
         }              
@@ -90,6 +93,7 @@ Value *PropertyNode::find_node_from_path(Value *start_node, string path, bool cr
                 key.SetString(tokens[i].c_str(), tokens[i].length(), doc->GetAllocator());
                 Value newobj(kObjectType);
                 node->AddMember(key, newobj, doc->GetAllocator());
+                generation++;
                 node = &(*node)[tokens[i].c_str()];
                 // printf("  new node: %p\n", node);
             } else {
@@ -505,15 +509,18 @@ string PropertyNode::getString( const char *name, unsigned int index ) {
 bool PropertyNode::setBool( const char *name, bool b ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     Value newval(b);
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name] = b;
     return true;
 }
@@ -521,15 +528,18 @@ bool PropertyNode::setBool( const char *name, bool b ) {
 bool PropertyNode::setInt( const char *name, int n ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     Value newval(n);
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name] = n;
     return true;
 }
@@ -537,15 +547,18 @@ bool PropertyNode::setInt( const char *name, int n ) {
 bool PropertyNode::setUInt( const char *name, unsigned int u ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     Value newval(u);
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name] = u;
     return true;
 }
@@ -553,15 +566,18 @@ bool PropertyNode::setUInt( const char *name, unsigned int u ) {
 bool PropertyNode::setInt64( const char *name, int64_t n ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     Value newval(n);
     if ( !val->HasMember(name) ) {
         printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name] = n;
     return true;
 }
@@ -569,15 +585,18 @@ bool PropertyNode::setInt64( const char *name, int64_t n ) {
 bool PropertyNode::setUInt64( const char *name, uint64_t u ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     Value newval(u);
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name] = u;
     return true;
 }
@@ -585,15 +604,18 @@ bool PropertyNode::setUInt64( const char *name, uint64_t u ) {
 bool PropertyNode::setDouble( const char *name, double x ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     Value newval(x);
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name] = x;
     return true;
 }
@@ -601,15 +623,18 @@ bool PropertyNode::setDouble( const char *name, double x ) {
 bool PropertyNode::setString( const char *name, string s ) {
     if ( !val->IsObject() ) {
         val->SetObject();
+        generation++;
     }
     if ( !val->HasMember(name) ) {
         Value newval("");
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         val->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
     }
+    replacing((*val)[name]);
     (*val)[name].SetString(s.c_str(), s.length(), doc->GetAllocator());
     return true;
 }
@@ -619,22 +644,26 @@ bool PropertyNode::setUInt( const char *name, unsigned int u, unsigned int index
         printf("  converting value to object\n");
         // hal.scheduler->delay(100);
         val->SetObject();
+        generation++;
     }
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         Value a(kArrayType);
         val->AddMember(key, a, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
         Value &a = (*val)[name];
         if ( ! a.IsArray() ) {
             printf("converting member to array: %s\n", name);
             a.SetArray();
+            generation++;
         }
     }
     Value &a = (*val)[name];
     extend_array(&a, index+1);    // protect against out of range
+    replacing(a[index]);
     a[index] = u;
     return true;
 }
@@ -644,26 +673,70 @@ bool PropertyNode::setDouble( const char *name, double x, unsigned int index ) {
         printf("  converting value to object\n");
         // hal.scheduler->delay(100);
         val->SetObject();
+        generation++;
     }
     if ( !val->HasMember(name) ) {
         // printf("creating %s\n", name);
         Value key(name, doc->GetAllocator());
         Value a(kArrayType);
         val->AddMember(key, a, doc->GetAllocator());
+        generation++;
     } else {
         // printf("%s already exists\n", name);
         Value &a = (*val)[name];
         if ( ! a.IsArray() ) {
             printf("converting member to array: %s\n", name);
             a.SetArray();
+            generation++;
         }
     }
     Value &a = (*val)[name];
     extend_array(&a, index+1);    // protect against out of range
+    replacing(a[index]);
     a[index] = x;
     return true;
 }
 
+Value *PropertyNode::getValueHandle( const char *name ) {
+    if ( val == nullptr || !val->IsObject() || !val->HasMember(name) ) {
+        return nullptr;
+    }
+    Value &v = (*val)[name];
+    if ( v.IsObject() || v.IsArray() ) {
+        return nullptr;         // not a value
+    }
+    return &v;
+}
+
+Value *PropertyNode::getValueHandle( const char *name, unsigned int index ) {
+    if ( val == nullptr || !val->IsObject() || !val->HasMember(name) ) {
+        return nullptr;
+    }
+    Value &a = (*val)[name];
+    if ( !a.IsArray() || index >= a.Size() ) {
+        return nullptr;
+    }
+    if ( a[index].IsObject() || a[index].IsArray() ) {
+        return nullptr;         // not a value (e.g. array fill)
+    }
+    return &a[index];
+}
+
+// a value that had children is replaced: handles into it are stale
+void PropertyNode::replacing( Value &v ) {
+    if ( (v.IsObject() && v.MemberCount() > 0) || (v.IsArray() && v.Size() > 0) ) {
+        generation++;
+    }
+}
+
+double PropertyNode::valueAsDouble( Value &v ) {
+    return getValueAsDouble(v);
+}
+
+uint64_t PropertyNode::valueAsUInt64( Value &v ) {
+    return getValueAsUInt64(v);
+}
+
 bool PropertyNode::load_json( const char *file_path, Value *v ) {
     printf("loading from %s\n", file_path);
     
@@ -727,6 +800,7 @@ bool PropertyNode::load_json( const char *file_path, Value *v ) {
         key.SetString(itr->name.GetString(), itr->name.GetStringLength(), doc->GetAllocator());
         Value &newval = tmpdoc[itr->name.GetString()];
         v->AddMember(key, newval, doc->GetAllocator());
+        generation++;
     }
 
     return true;
@@ -946,6 +1020,7 @@ void PropertyNode::pretty_print() {
 }
 
 Document *PropertyNode::doc = nullptr;
+uint32_t PropertyNode::generation = 0;
  
 #if 0
 int main() {
@@ -4,6 +4,7 @@
 #  undef _GLIBCXX_USE_C99_STDIO   // vsnprintf() not defined
 #endif
 
+#include <stdint.h>
 #include <stdio.h>
 
 #include <string>
@@ -75,6 +76,20 @@ public:
     bool setUInt( const char *name, unsigned int index, unsigned int u ); // returns true if successful
     bool setDouble( const char *name, double x, unsigned int u ); // returns true if successful
 
+    // direct value handles (look up once, then read/write without a
+    // name search.)  A read only lookup: nullptr if the value doesn't
+    // exist (yet.)  Any structural change anywhere in the tree (a
+    // member or array element added, a node converted or a subtree
+    // replaced) can move values, and bumps getGeneration(): handles
+    // taken in an older generation must be looked up again.
+    Value *getValueHandle( const char *name );
+    Value *getValueHandle( const char *name, unsigned int index );
+    static uint32_t getGeneration() { return generation; }
+
+    // value conversions (usable with handles)
+    static double valueAsDouble( Value &v );
+    static uint64_t valueAsUInt64( Value &v );
+
     // load/merge json file under this node
     bool load( const char *file_path );
     
@@ -93,11 +108,14 @@ public:
     
     void set_Document( DocPointerWrapper d ) {
         doc = d.doc;
+        generation++;
     }
     
 private:
     // shared document instance
     static Document *doc;
+    // bumped on every structural change (see getValueHandle())
+    static uint32_t generation;
 
     // pointer to rapidjson Object;
     Value *val = nullptr;
@@ -108,6 +126,7 @@ private:
         }
     }
     bool extend_array(Value *node, int size);
+    static void replacing( Value &v );
     Value *find_node_from_path(Value *start_node, string path, bool create);
     bool load_json( const char *file_path, Value *v );
     void recursively_expand_includes(string base_path, Value *v);
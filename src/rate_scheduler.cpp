@@ -0,0 +1,204 @@
+#include "setup_board.h"
+
+#include "props2.h"
+#include "rate_scheduler.h"
+
+rate_scheduler_t::rate_scheduler_t() {
+    frame_budget_usec = DT_MICROS * 9 / 10; // leave some slack
+}
+
+bool rate_scheduler_t::add_task( const char *name, task_fn_t fn, float hz,
+                                 task_priority_t priority,
+                                 uint16_t budget_usec )
+{
+    if ( num_tasks >= MAX_TASKS || hz <= 0.0 ) {
+        console->printf("scheduler: cannot add task: %s\n", name);
+        return false;
+    }
+    int divider = MASTER_HZ / hz + 0.5;
+    if ( divider < 1 ) {
+        divider = 1;
+    }
+
+    // insert after every task of the same or higher priority so the
+    // run order is priority, then registration order
+    uint8_t pos = num_tasks;
+    while ( pos > 0 && tasks[pos-1].priority > priority ) {
+        tasks[pos] = tasks[pos-1];
+        pos--;
+    }
+    task_t &t = tasks[pos];
+    t = task_t();
+    t.name = name;
+    t.fn = fn;
+    t.divider = divider;
+    t.priority = priority;
+    t.budget_usec = budget_usec;
+    num_tasks++;
+    return true;
+}
+
+void rate_scheduler_t::run_frame( uint32_t sample_usec ) {
+    uint32_t frame_start = AP_HAL::micros();
+    current.frame = frame_count;
+    current.start_usec = frame_start - sample_usec;
+    start_hist.add(current.start_usec);
+    current.interval_usec = 0;
+    if ( last_sample_usec ) {
+        uint32_t interval = sample_usec - last_sample_usec;
+        current.interval_usec = interval > DT_MICROS ? interval - DT_MICROS : DT_MICROS - interval;
+        interval_hist.add(current.interval_usec);
+    }
+    last_sample_usec = sample_usec;
+    current.latency_usec = 0;
+    memset(current.stage_usec, 0, sizeof(current.stage_usec));
+    for ( uint8_t i = 0; i < num_tasks; i++ ) {
+        task_t &t = tasks[i];
+        if ( frame_count % t.divider == 0 && !t.deferred_frames ) {
+            t.deferred_frames = 1;
+        }
+        if ( !t.deferred_frames ) {
+            continue;
+        }
+        uint32_t elapsed = AP_HAL::micros() - frame_start;
+        if ( t.priority != TASK_CRITICAL
+             && elapsed + t.budget_usec > frame_budget_usec
+             && t.deferred_frames < MAX_DEFER_FRAMES ) {
+            t.deferred_frames++;
+            t.deferrals++;
+            continue;
+        }
+        uint32_t start = AP_HAL::micros();
+        t.fn();
+        uint32_t usec = AP_HAL::micros() - start;
+        t.deferred_frames = 0;
+        t.last_usec = usec;
+        t.profile.add(usec);
+        current.stage_usec[i] = usec < 65535 ? usec : 65535;
+        if ( usec > t.budget_usec ) {
+            t.overruns++;
+        }
+    }
+    last_frame_usec = AP_HAL::micros() - frame_start;
+    if ( last_frame_usec > frame_budget_usec ) {
+        frame_overruns++;
+    }
+    current.duration_usec = last_frame_usec;
+    duration_hist.add(last_frame_usec);
+    log_worst();
+    frame_count++;
+}
+
+void rate_scheduler_t::mark_output( uint32_t sample_usec ) {
+    current.latency_usec = AP_HAL::micros() - sample_usec;
+    latency_hist.add(current.latency_usec);
+}
+
+// keep the WORST_FRAMES frames that finished latest relative to their
+// schedule, sorted worst first
+void rate_scheduler_t::log_worst() {
+    uint32_t finish = current.start_usec + current.duration_usec;
+    uint8_t pos = num_worst;
+    while ( pos > 0 && worst[pos-1].start_usec + worst[pos-1].duration_usec < finish ) {
+        pos--;
+    }
+    if ( pos >= WORST_FRAMES ) {
+        return;
+    }
+    if ( num_worst < WORST_FRAMES ) {
+        num_worst++;
+    }
+    for ( uint8_t i = num_worst - 1; i > pos; i-- ) {
+        worst[i] = worst[i-1];
+    }
+    worst[pos] = current;
+}
+
+void rate_scheduler_t::write_stats_ascii() {
+    console->printf("Tasks (frame budget: %d usec, frame overruns: %d)\n",
+                    (int)frame_budget_usec, (int)frame_overruns);
+    console->printf("  name           hz pri budget    min   mean    p99    max  overruns deferrals\n");
+    for ( uint8_t i = 0; i < num_tasks; i++ ) {
+        task_t &t = tasks[i];
+        exec_profile_t &p = t.profile;
+        console->printf("  %-12s %5.1f %2d %6d %6d %6d %6d %6d %9d %9d\n",
+                        t.name, (float)MASTER_HZ / t.divider, t.priority,
+                        t.budget_usec, (int)p.min_usec, (int)p.mean_usec(),
+                        (int)p.quantile_usec(0.99), (int)p.max_usec,
+                        (int)t.overruns, (int)t.deferrals);
+    }
+}
+
+void rate_scheduler_t::write_overruns_ascii() {
+    uint32_t total = 0;
+    for ( uint8_t i = 0; i < num_tasks; i++ ) {
+        total += tasks[i].overruns;
+    }
+    if ( total == reported_overruns ) {
+        return;
+    }
+    reported_overruns = total;
+    console->printf("Task overruns:");
+    for ( uint8_t i = 0; i < num_tasks; i++ ) {
+        if ( tasks[i].overruns ) {
+            console->printf(" %s: %d", tasks[i].name, (int)tasks[i].overruns);
+        }
+    }
+    console->printf("\n");
+}
+
+static void write_histogram_ascii( const char *name, const log2_histogram_t &h ) {
+    console->printf("  %-9s", name);
+    for ( uint8_t i = 0; i < log2_histogram_t::BINS; i++ ) {
+        console->printf(" %6d", (int)h.bins[i]);
+    }
+    console->printf("\n");
+}
+
+void rate_scheduler_t::write_timing_ascii() {
+    console->printf("Frame timing histograms (usec, bin lower bound):\n");
+    console->printf("  %-9s", "");
+    for ( uint8_t i = 0; i < log2_histogram_t::BINS; i++ ) {
+        console->printf(" %6d", (int)log2_histogram_t::lower_usec(i));
+    }
+    console->printf("\n");
+    write_histogram_ascii("interval", interval_hist);
+    write_histogram_ascii("start", start_hist);
+    write_histogram_ascii("duration", duration_hist);
+    write_histogram_ascii("latency", latency_hist);
+    console->printf("Worst frames (usec):\n");
+    for ( uint8_t i = 0; i < num_worst; i++ ) {
+        frame_record_t &r = worst[i];
+        console->printf("  frame %d interval %d start %d duration %d latency %d:",
+                        (int)r.frame, (int)r.interval_usec, (int)r.start_usec,
+                        (int)r.duration_usec, (int)r.latency_usec);
+        for ( uint8_t j = 0; j < num_tasks; j++ ) {
+            if ( r.stage_usec[j] ) {
+                console->printf(" %s %d", tasks[j].name, r.stage_usec[j]);
+            }
+        }
+        console->printf("\n");
+    }
+}
+
+void rate_scheduler_t::publish_props() {
+    PropertyNode tasks_node("/performance/tasks");
+    for ( uint8_t i = 0; i < num_tasks; i++ ) {
+        task_t &t = tasks[i];
+        exec_profile_t &p = t.profile;
+        PropertyNode node = tasks_node.getChild(t.name);
+        node.setUInt("runs", p.runs);
+        node.setUInt("min_usec", p.min_usec);
+        node.setUInt("mean_usec", p.mean_usec());
+        node.setUInt("p99_usec", p.quantile_usec(0.99));
+        node.setUInt("max_usec", p.max_usec);
+        node.setUInt("overruns", t.overruns);
+        node.setUInt("deferrals", t.deferrals);
+    }
+    PropertyNode perf_node("/performance");
+    perf_node.setUInt("frame_overruns", frame_overruns);
+    perf_node.setUInt("last_frame_usec", last_frame_usec);
+}
+
+// global shared instance
+rate_scheduler_t rate_scheduler;
@@ -0,0 +1,203 @@
+// Rate group task scheduler for the main loop
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Tasks are plain functions registered with a rate (hz, up to the
+// main loop rate), a priority and a time budget (usec.)  Every frame
+// the tasks that are due run in a fixed order: by priority, then in
+// registration order.  Critical tasks always run.  Any other task is
+// deferred to a later frame when its budget no longer fits in what is
+// left of the frame budget (but never for more than MAX_DEFER_FRAMES
+// in a row.)  A task that takes longer than its own budget is counted
+// as an overrun.
+
+typedef void (*task_fn_t)();
+
+// Execution time statistics.  Quantiles come from a log scale
+// histogram (4 bins per octave, 1 usec to 65 msec), so they are
+// reported as the upper edge of their bin (within ~20%.)
+class exec_profile_t {
+public:
+    static const uint8_t BINS = 64;
+
+    uint32_t runs = 0;
+    uint32_t min_usec = 0;
+    uint32_t max_usec = 0;
+    uint64_t total_usec = 0;
+
+    exec_profile_t() {
+        reset();
+    }
+    void reset() {
+        runs = min_usec = max_usec = 0;
+        total_usec = 0;
+        binned = 0;
+        memset(bins, 0, sizeof(bins));
+    }
+    void add( uint32_t usec ) {
+        if ( runs == 0 || usec < min_usec ) {
+            min_usec = usec;
+        }
+        if ( usec > max_usec ) {
+            max_usec = usec;
+        }
+        runs++;
+        total_usec += usec;
+        uint8_t b = bin(usec);
+        if ( bins[b] == UINT16_MAX ) {
+            // halve everything, the shape (and the quantiles) survive
+            binned = 0;
+            for ( uint8_t i = 0; i < BINS; i++ ) {
+                bins[i] /= 2;
+                binned += bins[i];
+            }
+        }
+        bins[b]++;
+        binned++;
+    }
+    uint32_t mean_usec() const {
+        return runs ? total_usec / runs : 0;
+    }
+    uint32_t quantile_usec( float q ) const {
+        uint32_t target = binned * q;
+        uint32_t sum = 0;
+        for ( uint8_t i = 0; i < BINS; i++ ) {
+            sum += bins[i];
+            if ( sum > target ) {
+                uint32_t upper = bin_upper(i);
+                return upper < max_usec ? upper : max_usec;
+            }
+        }
+        return max_usec;
+    }
+
+private:
+    uint16_t bins[BINS];
+    uint32_t binned;
+
+    // octave (position of the leading one) and the next two bits
+    static uint8_t bin( uint32_t usec ) {
+        if ( usec == 0 ) {
+            return 0;
+        }
+        uint8_t octave = 31 - __builtin_clz(usec);
+        uint8_t frac = octave >= 2 ? (usec >> (octave - 2)) & 3 : (usec << (2 - octave)) & 3;
+        uint16_t b = octave * 4 + frac;
+        return b < BINS ? b : BINS - 1;
+    }
+    static uint32_t bin_upper( uint8_t b ) {
+        uint8_t octave = b / 4;
+        uint8_t frac = b % 4;
+        return (((uint64_t)(5 + frac) << octave) + 3) >> 2;
+    }
+};
+
+// Power of two histogram: bin 0 counts 0 usec, bin i counts [2^(i-1),
+// 2^i) usec and the last bin is open ended (16 bins reach 16 msec.)
+class log2_histogram_t {
+public:
+    static const uint8_t BINS = 16;
+    uint32_t bins[BINS];
+
+    log2_histogram_t() {
+        reset();
+    }
+    void reset() {
+        memset(bins, 0, sizeof(bins));
+    }
+    void add( uint32_t usec ) {
+        uint8_t b = usec ? 32 - __builtin_clz(usec) : 0;
+        bins[b < BINS ? b : BINS - 1]++;
+    }
+    static uint32_t lower_usec( uint8_t b ) {
+        return b ? 1ul << (b - 1) : 0;
+    }
+};
+
+enum task_priority_t {
+    TASK_CRITICAL = 0,          // sense, estimate, control, i/o
+    TASK_HIGH,
+    TASK_NORMAL,
+    TASK_LOW                    // human console output and such
+};
+
+class rate_scheduler_t {
+
+public:
+    static const uint8_t MAX_TASKS = 24;
+    static const uint8_t MAX_DEFER_FRAMES = 10;
+
+    struct task_t {
+        const char *name;
+        task_fn_t fn;
+        uint16_t divider;       // run every n'th frame
+        uint8_t priority;
+        uint16_t budget_usec;
+
+        uint8_t deferred_frames; // frames owed (0 = not pending)
+        uint32_t overruns;      // exceeded budget_usec
+        uint32_t deferrals;     // pushed to a later frame
+        uint32_t last_usec;
+        exec_profile_t profile;
+    };
+
+    // one frame's timing with the per task (stage) breakdown, usec
+    struct frame_record_t {
+        uint32_t frame;
+        uint32_t interval_usec; // sample interval error |interval - DT_MICROS|
+        uint32_t start_usec;    // frame start delay after its INS sample
+        uint32_t duration_usec;
+        uint32_t latency_usec;  // sensor sample to control output
+        uint16_t stage_usec[MAX_TASKS]; // by task index (0 = didn't run)
+    };
+    static const uint8_t WORST_FRAMES = 8;
+
+    uint32_t frame_count = 0;
+    uint32_t frame_budget_usec;
+    uint32_t frame_overruns = 0; // frames that ran past frame_budget_usec
+    uint32_t last_frame_usec = 0;
+
+    log2_histogram_t interval_hist; // sample interval error
+    log2_histogram_t start_hist;    // frame start delay
+    log2_histogram_t duration_hist;
+    log2_histogram_t latency_hist;
+
+    rate_scheduler_t();
+
+    bool add_task( const char *name, task_fn_t fn, float hz,
+                   task_priority_t priority, uint16_t budget_usec );
+    // sample_usec is the INS time of the frame's sample (the interval
+    // error is the sample to sample interval against DT_MICROS, the
+    // start delay is how long after its sample the frame began), call
+    // mark_output() once the
+    // frame's actuator output is written with the same sample time
+    void run_frame( uint32_t sample_usec );
+    void mark_output( uint32_t sample_usec );
+
+    uint8_t size() { return num_tasks; }
+    const task_t &get_task( uint8_t i ) { return tasks[i]; }
+    // worst frames (latest finish relative to schedule), worst first
+    uint8_t worst_size() { return num_worst; }
+    const frame_record_t &get_worst( uint8_t i ) { return worst[i]; }
+
+    void write_stats_ascii();
+    void publish_props();       // under /performance/tasks/<name>
+    void write_overruns_ascii(); // one line, only if there were new overruns
+    void write_timing_ascii();  // histograms and the worst frames
+
+private:
+    task_t tasks[MAX_TASKS];
+    uint8_t num_tasks = 0;
+    uint32_t reported_overruns = 0;
+
+    uint32_t last_sample_usec = 0;
+    frame_record_t current;
+    frame_record_t worst[WORST_FRAMES];
+    uint8_t num_worst = 0;
+    void log_worst();
+};
+
+extern rate_scheduler_t rate_scheduler;
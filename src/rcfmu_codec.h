@@ -0,0 +1,421 @@
+#pragma once
+
+// Table driven message codec.
+//
+// Every fixed size message in rcfmu_messages.h carries a hand written
+// constexpr field descriptor table (keep it in step with the message
+// members and the _compact_t wire layout when editing a message by
+// hand; the message generator does not emit these.)  The functions here
+// walk a table to pack, unpack, and publish any message, so there is
+// exactly one copy of this code no matter how many messages we define.
+//
+// Scaled fields are always float members: packing is a load, a
+// multiply, a round and a store; unpacking is a load, a multiply (by
+// the precomputed inverse scale) and a store.  Unscaled fields share
+// the same type on both sides and are copied directly.
+
+#include <stdint.h>  // uint8_t, et. al.
+#include <stddef.h>  // size_t, offsetof()
+#include <string.h>  // memcpy()
+
+#include "props2.h"  // github.com/RiceCreekUAS/props/v2
+
+namespace rcfmu_message {
+
+enum field_type_t {
+    type_uint8 = 0,
+    type_int8,
+    type_uint16,
+    type_int16,
+    type_uint32,
+    type_int32,
+    type_uint64,
+    type_float,
+    type_double
+};
+
+struct field_t {
+    const char *name;           // property name
+    uint16_t offset;            // offset of the member in the message class
+    uint16_t wire_offset;       // offset in the packed payload
+    uint8_t type;               // member type (field_type_t)
+    uint8_t wire_type;          // packed type (field_type_t)
+    uint8_t count;              // array length (1 for scalars)
+    float scale;                // wire = member * scale (0 = unscaled)
+    float inv_scale;            // member = wire * inv_scale
+};
+
+constexpr uint8_t type_size( uint8_t type ) {
+    return (type == type_uint8 || type == type_int8) ? 1
+        : (type == type_uint16 || type == type_int16) ? 2
+        : (type == type_uint32 || type == type_int32 || type == type_float) ? 4
+        : 8;
+}
+
+// compile time sum of the packed field sizes of a descriptor table
+template <size_t N>
+constexpr uint16_t wire_size( const field_t (&fields)[N], size_t i = 0 ) {
+    return i < N
+        ? type_size(fields[i].wire_type) * fields[i].count + wire_size(fields, i + 1)
+        : 0;
+}
+
+static inline int32_t intround(float f) {
+    return (int32_t)(f >= 0.0 ? (f + 0.5) : (f - 0.5));
+}
+
+static inline uint32_t uintround(float f) {
+    return (int32_t)(f + 0.5);
+}
+
+// store a scaled value in its (possibly unaligned) packed location
+// (size is type_size(wire_type))
+static inline void store_scaled( uint8_t *dst, uint8_t size, uint8_t wire_type, float v ) {
+    union { uint8_t u8; int8_t i8; uint16_t u16; int16_t i16;
+            uint32_t u32; int32_t i32; float f; double d; uint8_t bytes[8]; } x;
+    switch ( wire_type ) {
+    case type_uint8: x.u8 = uintround(v); break;
+    case type_int8: x.i8 = intround(v); break;
+    case type_uint16: x.u16 = uintround(v); break;
+    case type_int16: x.i16 = intround(v); break;
+    case type_uint32: x.u32 = uintround(v); break;
+    case type_int32: x.i32 = intround(v); break;
+    case type_double: x.d = v; break;
+    default: x.f = v; break;
+    }
+    memcpy(dst, x.bytes, size);
+}
+
+static inline float load_scaled( const uint8_t *src, uint8_t wire_type ) {
+    switch ( wire_type ) {
+    case type_uint8: return *src;
+    case type_int8: return (int8_t)*src;
+    case type_uint16: { uint16_t x; memcpy(&x, src, 2); return x; }
+    case type_int16: { int16_t x; memcpy(&x, src, 2); return x; }
+    case type_uint32: { uint32_t x; memcpy(&x, src, 4); return x; }
+    case type_int32: { int32_t x; memcpy(&x, src, 4); return x; }
+    default: { float x; memcpy(&x, src, 4); return x; }
+    }
+}
+
+// every store is bounded by payload_len (the tables are checked
+// against the packed layout at compile time, this keeps a bad table
+// from writing past the payload and lets the compiler see it can't.)
+inline void pack_fields( const field_t *fields, uint8_t field_count,
+                         const void *msg, uint8_t *payload, uint16_t payload_len ) {
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const uint8_t *src = (const uint8_t *)msg + f.offset;
+        uint8_t *dst = payload + f.wire_offset;
+        uint8_t size = type_size(f.wire_type);
+        if ( f.wire_offset + size * f.count > payload_len ) {
+            return;
+        }
+        if ( f.scale == 0.0f ) {
+            memcpy(dst, src, size * f.count);
+        } else {
+            const float *v = (const float *)src;
+            for ( uint8_t j = 0; j < f.count; j++ ) {
+                store_scaled(dst + j * size, size, f.wire_type, v[j] * f.scale);
+            }
+        }
+    }
+}
+
+inline void unpack_fields( const field_t *fields, uint8_t field_count,
+                           const uint8_t *payload, void *msg ) {
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const uint8_t *src = payload + f.wire_offset;
+        uint8_t *dst = (uint8_t *)msg + f.offset;
+        if ( f.scale == 0.0f ) {
+            memcpy(dst, src, type_size(f.type) * f.count);
+        } else {
+            float *v = (float *)dst;
+            uint8_t size = type_size(f.wire_type);
+            for ( uint8_t j = 0; j < f.count; j++ ) {
+                v[j] = load_scaled(src + j * size, f.wire_type) * f.inv_scale;
+            }
+        }
+    }
+}
+
+// read a member element as a double (for property publishing)
+static inline double member_as_double( const uint8_t *src, uint8_t type ) {
+    switch ( type ) {
+    case type_uint8: return *src;
+    case type_int8: return *(const int8_t *)src;
+    case type_uint16: return *(const uint16_t *)src;
+    case type_int16: return *(const int16_t *)src;
+    case type_uint32: return *(const uint32_t *)src;
+    case type_int32: return *(const int32_t *)src;
+    case type_uint64: return *(const uint64_t *)src;
+    case type_float: return *(const float *)src;
+    default: return *(const double *)src;
+    }
+}
+
+static inline void member_from_double( uint8_t *dst, uint8_t type, double v ) {
+    switch ( type ) {
+    case type_uint8: *dst = v; break;
+    case type_int8: *(int8_t *)dst = v; break;
+    case type_uint16: *(uint16_t *)dst = v; break;
+    case type_int16: *(int16_t *)dst = v; break;
+    case type_uint32: *(uint32_t *)dst = v; break;
+    case type_int32: *(int32_t *)dst = v; break;
+    case type_uint64: *(uint64_t *)dst = v; break;
+    case type_float: *(float *)dst = v; break;
+    default: *(double *)dst = v; break;
+    }
+}
+
+// property names default to the field names.  A names table (one
+// entry per field) maps fields to differently named properties, and a
+// nullptr entry leaves that field to the caller (e.g. the stamped
+// frame_usec and sequence.)
+static inline const char *prop_name( const field_t *fields,
+                                     const char *const *names, uint8_t i ) {
+    return names ? names[i] : fields[i].name;
+}
+
+// name based property access (the slow path, one lookup per field)
+inline void fields2props( const field_t *fields, uint8_t field_count,
+                          const void *msg, PropertyNode node,
+                          const char *const *names = nullptr ) {
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const char *name = prop_name(fields, names, i);
+        if ( !name ) {
+            continue;
+        }
+        const uint8_t *src = (const uint8_t *)msg + f.offset;
+        if ( f.count > 1 ) {
+            for ( uint8_t j = 0; j < f.count; j++ ) {
+                node.setDouble(name, member_as_double(src + j * type_size(f.type), f.type), j);
+            }
+        } else if ( f.type == type_uint64 ) {
+            node.setUInt64(name, *(const uint64_t *)src);
+        } else if ( f.type == type_int8 || f.type == type_int16
+                    || f.type == type_int32 ) {
+            node.setInt(name, member_as_double(src, f.type));
+        } else if ( f.type == type_float || f.type == type_double ) {
+            node.setDouble(name, member_as_double(src, f.type));
+        } else {
+            node.setUInt(name, member_as_double(src, f.type));
+        }
+    }
+}
+
+inline void props2fields( const field_t *fields, uint8_t field_count,
+                          PropertyNode node, void *msg,
+                          const char *const *names = nullptr ) {
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const char *name = prop_name(fields, names, i);
+        if ( !name ) {
+            continue;
+        }
+        uint8_t *dst = (uint8_t *)msg + f.offset;
+        if ( f.count > 1 ) {
+            for ( uint8_t j = 0; j < f.count; j++ ) {
+                member_from_double(dst + j * type_size(f.type), f.type, node.getDouble(name, j));
+            }
+        } else if ( f.type == type_uint64 ) {
+            *(uint64_t *)dst = node.getUInt64(name);
+        } else {
+            member_from_double(dst, f.type, node.getDouble(name));
+        }
+    }
+}
+
+// handle based property access: bind each field (and array element)
+// to its property value once, then every transfer is a direct read or
+// write of the value with no name search.  Binding is a read only
+// lookup; returns false if any value doesn't exist (yet.)  Fields left
+// to the caller get a nullptr handle and aren't counted.
+inline bool bind_fields( const field_t *fields, uint8_t field_count,
+                         PropertyNode node, Value **handles,
+                         const char *const *names = nullptr ) {
+    bool bound = true;
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const char *name = prop_name(fields, names, i);
+        for ( uint8_t j = 0; j < f.count; j++ ) {
+            if ( !name ) {
+                *handles++ = nullptr;
+                continue;
+            }
+            *handles = f.count > 1 ? node.getValueHandle(name, j) : node.getValueHandle(name);
+            if ( *handles++ == nullptr ) {
+                bound = false;
+            }
+        }
+    }
+    return bound;
+}
+
+// nullptr handles are skipped
+inline void fields2handles( const field_t *fields, uint8_t field_count,
+                            const void *msg, Value **handles ) {
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const uint8_t *src = (const uint8_t *)msg + f.offset;
+        for ( uint8_t j = 0; j < f.count; j++ ) {
+            Value *v = *handles++;
+            if ( !v ) {
+                continue;
+            }
+            const uint8_t *e = src + j * type_size(f.type);
+            switch ( f.type ) {
+            case type_uint64: v->SetUint64(*(const uint64_t *)e); break;
+            case type_int8: v->SetInt(*(const int8_t *)e); break;
+            case type_int16: v->SetInt(*(const int16_t *)e); break;
+            case type_int32: v->SetInt(*(const int32_t *)e); break;
+            case type_float: v->SetDouble(*(const float *)e); break;
+            case type_double: v->SetDouble(*(const double *)e); break;
+            default: v->SetUint(member_as_double(e, f.type)); break;
+            }
+        }
+    }
+}
+
+// a missing value reads as zero (as the named getters do), fields left
+// to the caller are untouched
+inline void handles2fields( const field_t *fields, uint8_t field_count,
+                            Value **handles, void *msg,
+                            const char *const *names = nullptr ) {
+    for ( uint8_t i = 0; i < field_count; i++ ) {
+        const field_t &f = fields[i];
+        const bool named = prop_name(fields, names, i) != nullptr;
+        uint8_t *dst = (uint8_t *)msg + f.offset;
+        for ( uint8_t j = 0; j < f.count; j++ ) {
+            Value *v = *handles++;
+            uint8_t *e = dst + j * type_size(f.type);
+            if ( !v ) {
+                if ( named ) {
+                    member_from_double(e, f.type, 0.0);
+                }
+            } else if ( f.type == type_uint64 ) {
+                *(uint64_t *)e = PropertyNode::valueAsUInt64(*v);
+            } else if ( f.type == type_float && v->IsNumber() ) {
+                *(float *)e = v->GetDouble();
+            } else {
+                member_from_double(e, f.type, PropertyNode::valueAsDouble(*v));
+            }
+        }
+    }
+}
+
+// The single templated codec: M is any fixed size message class (it
+// provides fields(), field_count, value_count, len and a payload
+// buffer.)
+template <class M>
+class codec_t {
+public:
+    static bool pack( M &msg ) {
+        pack_fields(M::fields(), M::field_count, &msg, msg.payload, M::len);
+        return true;
+    }
+    static bool unpack( M &msg, const uint8_t *external_message, int message_size ) {
+        if ( message_size < M::len ) {
+            return false;
+        }
+        unpack_fields(M::fields(), M::field_count, external_message, &msg);
+        return true;
+    }
+    static void msg2props( const M &msg, PropertyNode node ) {
+        fields2props(M::fields(), M::field_count, &msg, node);
+    }
+    static void props2msg( M &msg, PropertyNode node ) {
+        props2fields(M::fields(), M::field_count, node, &msg);
+    }
+};
+
+// A message bound to a property node.  Handles are looked up once and
+// looked up again whenever the property tree generation changes (any
+// structural change anywhere in the tree may move value storage, and
+// adding a property is one.)  Reads go through the handles even when
+// some values don't exist yet (those read as zero); writes use the
+// named (creating) path until every field exists, so binding itself
+// never adds properties.  names is an optional per field table of
+// property names (see prop_name(), it must outlive the binding.)
+template <class M>
+class props_binding_t {
+public:
+    props_binding_t() {}
+    props_binding_t( PropertyNode n ) {
+        bind(n);
+    }
+    template <int K>
+    props_binding_t( PropertyNode n, const char *const (&prop_names)[K] ) {
+        static_assert(K == M::field_count, "one property name per field");
+        bind(n, prop_names);
+    }
+    void bind( PropertyNode n, const char *const *prop_names = nullptr ) {
+        node = n;
+        names = prop_names;
+        rebind();
+    }
+    void msg2props( const M &msg ) {
+        if ( refresh() ) {
+            fields2handles(M::fields(), M::field_count, &msg, handles);
+        } else {
+            fields2props(M::fields(), M::field_count, &msg, node, names);
+        }
+    }
+    void props2msg( M &msg ) {
+        refresh();
+        handles2fields(M::fields(), M::field_count, handles, &msg, names);
+    }
+
+private:
+    PropertyNode node;
+    const char *const *names = nullptr;
+    uint32_t generation = 0;
+    bool bound = false;
+    Value *handles[M::value_count];
+
+    void rebind() {
+        bound = bind_fields(M::fields(), M::field_count, node, handles, names);
+        generation = PropertyNode::getGeneration();
+    }
+    inline bool refresh() {
+        if ( PropertyNode::getGeneration() != generation ) {
+            rebind();
+        }
+        return bound;
+    }
+};
+
+// A few loose values of one node read through handles (for inputs that
+// don't map one to one onto a message field.)  Same refresh rule as
+// props_binding_t, a missing value reads as zero.
+template <int N>
+class props_values_t {
+public:
+    props_values_t( PropertyNode n, const char *const (&prop_names)[N] )
+        : node(n), names(prop_names) {
+        rebind();
+    }
+    double get( int i ) {
+        if ( PropertyNode::getGeneration() != generation ) {
+            rebind();
+        }
+        return handles[i] ? PropertyNode::valueAsDouble(*handles[i]) : 0.0;
+    }
+
+private:
+    PropertyNode node;
+    const char *const *names;
+    uint32_t generation = 0;
+    Value *handles[N];
+
+    void rebind() {
+        for ( int i = 0; i < N; i++ ) {
+            handles[i] = node.getValueHandle(names[i]);
+        }
+        generation = PropertyNode::getGeneration();
+    }
+};
+
+} // namespace rcfmu_message
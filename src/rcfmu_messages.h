@@ -10,6 +10,7 @@
 #endif
 
 #include <stdint.h>  // uint8_t, et. al.
+#include <stddef.h>  // offsetof()
 #include <stdlib.h>  // malloc() / free()
 #include <string.h>  // memcpy()
 
@@ -17,17 +18,10 @@
 using std::string;
 
 #include "props2.h"  // github.com/RiceCreekUAS/props/v2
+#include "rcfmu_codec.h"
 
 namespace rcfmu_message {
 
-static inline int32_t intround(float f) {
-    return (int32_t)(f >= 0.0 ? (f + 0.5) : (f - 0.5));
-}
-
-static inline uint32_t uintround(float f) {
-    return (int32_t)(f + 0.5);
-}
-
 // Message id constants
 const uint8_t command_ack_id = 10;
 const uint8_t config_json_id = 11;
@@ -42,18 +36,30 @@ const uint8_t airdata_id = 19;
 const uint8_t power_id = 20;
 const uint8_t status_id = 21;
 const uint8_t ekf_id = 22;
+const uint8_t command_echo_id = 23;
+const uint8_t echo_reply_id = 24;
+const uint8_t reliable_data_id = 25;
+const uint8_t reliable_ack_id = 26;
+const uint8_t task_profile_id = 27;
+const uint8_t frame_timing_id = 28;
 
 // Constants
 static const uint8_t pwm_channels = 8;  // number of pwm output channels
 static const uint8_t sbus_channels = 16;  // number of sbus channels
 static const uint8_t ap_channels = 6;  // number of sbus channels
 static const uint8_t mix_matrix_size = 64;  // 8 x 8 mix matrix
+static const uint8_t tx_stats_first_id = 10;  // first id in the status tx counters
+static const uint8_t tx_stats_ids = 19;  // tx counters for ids 10 - 28
+static const uint8_t task_name_len = 12;  // task_profile name bytes (zero padded)
+static const uint8_t max_tasks = 24;  // scheduler task slots (frame_timing stages)
+static const uint8_t timing_bins = 16;  // frame_timing log2 histogram bins
 
 // Enums
 enum class enum_nav {
     none = 0,  // disable nav filter
     nav15 = 1,  // 15-state ins/gps filter
-    nav15_mag = 2  // 15-state ins/gps/mag filter
+    nav15_mag = 2,  // 15-state ins/gps/mag filter
+    nav15_ud = 3  // 15-state ins/gps filter, UD factored covariance
 };
 
 // Message: command_ack (id: 10)
@@ -71,33 +77,31 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "command_id", offsetof(command_ack_t, command_id), offsetof(_compact_t, command_id), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "subcommand_id", offsetof(command_ack_t, subcommand_id), offsetof(_compact_t, subcommand_id), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "command_ack field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "command_ack packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 2;
+    static const uint8_t value_count = 2;
+
+    // id, payload and len
     static const uint8_t id = 10;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~command_ack_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->command_id = command_id;
-        _buf->subcommand_id = subcommand_id;
-        return true;
+        return codec_t<command_ack_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        command_id = _buf->command_id;
-        subcommand_id = _buf->subcommand_id;
-        return true;
+        return codec_t<command_ack_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -109,8 +113,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setUInt("command_id", command_id);
-        node.setUInt("subcommand_id", subcommand_id);
+        codec_t<command_ack_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -122,8 +125,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        command_id = node.getUInt("command_id");
-        subcommand_id = node.getUInt("subcommand_id");
+        codec_t<command_ack_t>::props2msg(*this, node);
     }
 };
 
@@ -170,10 +172,19 @@ public:
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
+        if ( message_size < (int)sizeof(_compact_t) ) {
+            return false;
+        }
         _compact_t *_buf = (_compact_t *)external_message;
         len = sizeof(_compact_t);
+        if ( len + _buf->path_len > message_size ) {
+            return false;
+        }
         path = string((char *)&(external_message[len]), _buf->path_len);
         len += _buf->path_len;
+        if ( len + _buf->json_len > message_size ) {
+            return false;
+        }
         json = string((char *)&(external_message[len]), _buf->json_len);
         len += _buf->json_len;
         return true;
@@ -210,40 +221,42 @@ public:
 class command_inceptors_t {
 public:
 
+    uint64_t host_usec;
     float channel[ap_channels];
 
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint64_t host_usec;
         int16_t channel[ap_channels];
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "host_usec", offsetof(command_inceptors_t, host_usec), offsetof(_compact_t, host_usec), type_uint64, type_uint64, 1, 0.0f, 0.0f },
+            { "channel", offsetof(command_inceptors_t, channel), offsetof(_compact_t, channel), type_float, type_int16, ap_channels, 16384.0f, (float)(1.0 / 16384.0) },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "command_inceptors field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "command_inceptors packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 2;
+    static const uint8_t value_count = 1 + ap_channels;
+
+    // id, payload and len
     static const uint8_t id = 12;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~command_inceptors_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        for (int _i=0; _i<ap_channels; _i++) _buf->channel[_i] = intround(channel[_i] * 16384);
-        return true;
+        return codec_t<command_inceptors_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        for (int _i=0; _i<ap_channels; _i++) channel[_i] = _buf->channel[_i] / (float)16384;
-        return true;
+        return codec_t<command_inceptors_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -255,7 +268,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        for (int _i=0; _i<ap_channels; _i++) node.setDouble("channel", _i, channel[_i]);
+        codec_t<command_inceptors_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -267,7 +280,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        for (int _i=0; _i<ap_channels; _i++) channel[_i] = node.getDouble("channel", _i);
+        codec_t<command_inceptors_t>::props2msg(*this, node);
     }
 };
 
@@ -282,25 +295,16 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // id, payload and len
     static const uint8_t id = 13;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~command_zero_gyros_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)] = {0};
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
         return true;
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        len = sizeof(_compact_t);
         return true;
     }
 
@@ -338,25 +342,16 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // id, payload and len
     static const uint8_t id = 14;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~command_reset_ekf_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)] = {0};
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
         return true;
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        len = sizeof(_compact_t);
         return true;
     }
 
@@ -394,25 +389,16 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // id, payload and len
     static const uint8_t id = 15;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~command_cycle_inceptors_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)] = {0};
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
         return true;
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        len = sizeof(_compact_t);
         return true;
     }
 
@@ -443,44 +429,48 @@ public:
 class pilot_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     float channel[sbus_channels];
     uint8_t flags;
 
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         int16_t channel[sbus_channels];
         uint8_t flags;
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(pilot_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(pilot_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "channel", offsetof(pilot_t, channel), offsetof(_compact_t, channel), type_float, type_int16, sbus_channels, 16384.0f, (float)(1.0 / 16384.0) },
+            { "flags", offsetof(pilot_t, flags), offsetof(_compact_t, flags), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "pilot field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "pilot packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 4;
+    static const uint8_t value_count = 3 + sbus_channels;
+
+    // id, payload and len
     static const uint8_t id = 16;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~pilot_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        for (int _i=0; _i<sbus_channels; _i++) _buf->channel[_i] = intround(channel[_i] * 16384);
-        _buf->flags = flags;
-        return true;
+        return codec_t<pilot_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        for (int _i=0; _i<sbus_channels; _i++) channel[_i] = _buf->channel[_i] / (float)16384;
-        flags = _buf->flags;
-        return true;
+        return codec_t<pilot_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -492,8 +482,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        for (int _i=0; _i<sbus_channels; _i++) node.setDouble("channel", _i, channel[_i]);
-        node.setUInt("flags", flags);
+        codec_t<pilot_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -505,8 +494,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        for (int _i=0; _i<sbus_channels; _i++) channel[_i] = node.getDouble("channel", _i);
-        flags = node.getUInt("flags");
+        codec_t<pilot_t>::props2msg(*this, node);
     }
 };
 
@@ -514,6 +502,8 @@ public:
 class imu_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     uint32_t millis;
     float ax_raw;
     float ay_raw;
@@ -535,6 +525,8 @@ public:
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         uint32_t millis;
         int16_t ax_raw;
         int16_t ay_raw;
@@ -555,63 +547,48 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(imu_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(imu_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "millis", offsetof(imu_t, millis), offsetof(_compact_t, millis), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "ax_raw", offsetof(imu_t, ax_raw), offsetof(_compact_t, ax_raw), type_float, type_int16, 1, 835.296217f, (float)(1.0 / 835.296217) },
+            { "ay_raw", offsetof(imu_t, ay_raw), offsetof(_compact_t, ay_raw), type_float, type_int16, 1, 835.296217f, (float)(1.0 / 835.296217) },
+            { "az_raw", offsetof(imu_t, az_raw), offsetof(_compact_t, az_raw), type_float, type_int16, 1, 835.296217f, (float)(1.0 / 835.296217) },
+            { "hx_raw", offsetof(imu_t, hx_raw), offsetof(_compact_t, hx_raw), type_float, type_int16, 1, 30000.0f, (float)(1.0 / 30000.0) },
+            { "hy_raw", offsetof(imu_t, hy_raw), offsetof(_compact_t, hy_raw), type_float, type_int16, 1, 30000.0f, (float)(1.0 / 30000.0) },
+            { "hz_raw", offsetof(imu_t, hz_raw), offsetof(_compact_t, hz_raw), type_float, type_int16, 1, 30000.0f, (float)(1.0 / 30000.0) },
+            { "ax_mps2", offsetof(imu_t, ax_mps2), offsetof(_compact_t, ax_mps2), type_float, type_int16, 1, 835.296217f, (float)(1.0 / 835.296217) },
+            { "ay_mps2", offsetof(imu_t, ay_mps2), offsetof(_compact_t, ay_mps2), type_float, type_int16, 1, 835.296217f, (float)(1.0 / 835.296217) },
+            { "az_mps2", offsetof(imu_t, az_mps2), offsetof(_compact_t, az_mps2), type_float, type_int16, 1, 835.296217f, (float)(1.0 / 835.296217) },
+            { "p_rps", offsetof(imu_t, p_rps), offsetof(_compact_t, p_rps), type_float, type_int16, 1, 3754.82165f, (float)(1.0 / 3754.82165) },
+            { "q_rps", offsetof(imu_t, q_rps), offsetof(_compact_t, q_rps), type_float, type_int16, 1, 3754.82165f, (float)(1.0 / 3754.82165) },
+            { "r_rps", offsetof(imu_t, r_rps), offsetof(_compact_t, r_rps), type_float, type_int16, 1, 3754.82165f, (float)(1.0 / 3754.82165) },
+            { "hx", offsetof(imu_t, hx), offsetof(_compact_t, hx), type_float, type_int16, 1, 30000.0f, (float)(1.0 / 30000.0) },
+            { "hy", offsetof(imu_t, hy), offsetof(_compact_t, hy), type_float, type_int16, 1, 30000.0f, (float)(1.0 / 30000.0) },
+            { "hz", offsetof(imu_t, hz), offsetof(_compact_t, hz), type_float, type_int16, 1, 30000.0f, (float)(1.0 / 30000.0) },
+            { "temp_C", offsetof(imu_t, temp_C), offsetof(_compact_t, temp_C), type_float, type_int16, 1, 250.0f, (float)(1.0 / 250.0) },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "imu field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "imu packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 19;
+    static const uint8_t value_count = 19;
+
+    // id, payload and len
     static const uint8_t id = 17;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~imu_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->millis = millis;
-        _buf->ax_raw = intround(ax_raw * 835.296217);
-        _buf->ay_raw = intround(ay_raw * 835.296217);
-        _buf->az_raw = intround(az_raw * 835.296217);
-        _buf->hx_raw = intround(hx_raw * 30000);
-        _buf->hy_raw = intround(hy_raw * 30000);
-        _buf->hz_raw = intround(hz_raw * 30000);
-        _buf->ax_mps2 = intround(ax_mps2 * 835.296217);
-        _buf->ay_mps2 = intround(ay_mps2 * 835.296217);
-        _buf->az_mps2 = intround(az_mps2 * 835.296217);
-        _buf->p_rps = intround(p_rps * 3754.82165);
-        _buf->q_rps = intround(q_rps * 3754.82165);
-        _buf->r_rps = intround(r_rps * 3754.82165);
-        _buf->hx = intround(hx * 30000);
-        _buf->hy = intround(hy * 30000);
-        _buf->hz = intround(hz * 30000);
-        _buf->temp_C = intround(temp_C * 250);
-        return true;
+        return codec_t<imu_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        millis = _buf->millis;
-        ax_raw = _buf->ax_raw / (float)835.296217;
-        ay_raw = _buf->ay_raw / (float)835.296217;
-        az_raw = _buf->az_raw / (float)835.296217;
-        hx_raw = _buf->hx_raw / (float)30000;
-        hy_raw = _buf->hy_raw / (float)30000;
-        hz_raw = _buf->hz_raw / (float)30000;
-        ax_mps2 = _buf->ax_mps2 / (float)835.296217;
-        ay_mps2 = _buf->ay_mps2 / (float)835.296217;
-        az_mps2 = _buf->az_mps2 / (float)835.296217;
-        p_rps = _buf->p_rps / (float)3754.82165;
-        q_rps = _buf->q_rps / (float)3754.82165;
-        r_rps = _buf->r_rps / (float)3754.82165;
-        hx = _buf->hx / (float)30000;
-        hy = _buf->hy / (float)30000;
-        hz = _buf->hz / (float)30000;
-        temp_C = _buf->temp_C / (float)250;
-        return true;
+        return codec_t<imu_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -623,23 +600,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setUInt("millis", millis);
-        node.setDouble("ax_raw", ax_raw);
-        node.setDouble("ay_raw", ay_raw);
-        node.setDouble("az_raw", az_raw);
-        node.setDouble("hx_raw", hx_raw);
-        node.setDouble("hy_raw", hy_raw);
-        node.setDouble("hz_raw", hz_raw);
-        node.setDouble("ax_mps2", ax_mps2);
-        node.setDouble("ay_mps2", ay_mps2);
-        node.setDouble("az_mps2", az_mps2);
-        node.setDouble("p_rps", p_rps);
-        node.setDouble("q_rps", q_rps);
-        node.setDouble("r_rps", r_rps);
-        node.setDouble("hx", hx);
-        node.setDouble("hy", hy);
-        node.setDouble("hz", hz);
-        node.setDouble("temp_C", temp_C);
+        codec_t<imu_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -651,23 +612,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        millis = node.getUInt("millis");
-        ax_raw = node.getDouble("ax_raw");
-        ay_raw = node.getDouble("ay_raw");
-        az_raw = node.getDouble("az_raw");
-        hx_raw = node.getDouble("hx_raw");
-        hy_raw = node.getDouble("hy_raw");
-        hz_raw = node.getDouble("hz_raw");
-        ax_mps2 = node.getDouble("ax_mps2");
-        ay_mps2 = node.getDouble("ay_mps2");
-        az_mps2 = node.getDouble("az_mps2");
-        p_rps = node.getDouble("p_rps");
-        q_rps = node.getDouble("q_rps");
-        r_rps = node.getDouble("r_rps");
-        hx = node.getDouble("hx");
-        hy = node.getDouble("hy");
-        hz = node.getDouble("hz");
-        temp_C = node.getDouble("temp_C");
+        codec_t<imu_t>::props2msg(*this, node);
     }
 };
 
@@ -675,6 +620,8 @@ public:
 class gps_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     uint32_t millis;
     uint64_t unix_usec;
     uint8_t num_sats;
@@ -693,6 +640,8 @@ public:
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         uint32_t millis;
         uint64_t unix_usec;
         uint8_t num_sats;
@@ -710,57 +659,45 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(gps_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(gps_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "millis", offsetof(gps_t, millis), offsetof(_compact_t, millis), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "unix_usec", offsetof(gps_t, unix_usec), offsetof(_compact_t, unix_usec), type_uint64, type_uint64, 1, 0.0f, 0.0f },
+            { "num_sats", offsetof(gps_t, num_sats), offsetof(_compact_t, num_sats), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "status", offsetof(gps_t, status), offsetof(_compact_t, status), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "longitude_raw", offsetof(gps_t, longitude_raw), offsetof(_compact_t, longitude_raw), type_int32, type_int32, 1, 0.0f, 0.0f },
+            { "latitude_raw", offsetof(gps_t, latitude_raw), offsetof(_compact_t, latitude_raw), type_int32, type_int32, 1, 0.0f, 0.0f },
+            { "altitude_m", offsetof(gps_t, altitude_m), offsetof(_compact_t, altitude_m), type_float, type_float, 1, 0.0f, 0.0f },
+            { "vn_mps", offsetof(gps_t, vn_mps), offsetof(_compact_t, vn_mps), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ve_mps", offsetof(gps_t, ve_mps), offsetof(_compact_t, ve_mps), type_float, type_float, 1, 0.0f, 0.0f },
+            { "vd_mps", offsetof(gps_t, vd_mps), offsetof(_compact_t, vd_mps), type_float, type_float, 1, 0.0f, 0.0f },
+            { "hAcc", offsetof(gps_t, hAcc), offsetof(_compact_t, hAcc), type_float, type_float, 1, 0.0f, 0.0f },
+            { "vAcc", offsetof(gps_t, vAcc), offsetof(_compact_t, vAcc), type_float, type_float, 1, 0.0f, 0.0f },
+            { "hdop", offsetof(gps_t, hdop), offsetof(_compact_t, hdop), type_float, type_float, 1, 0.0f, 0.0f },
+            { "vdop", offsetof(gps_t, vdop), offsetof(_compact_t, vdop), type_float, type_float, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "gps field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "gps packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 16;
+    static const uint8_t value_count = 16;
+
+    // id, payload and len
     static const uint8_t id = 18;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~gps_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->millis = millis;
-        _buf->unix_usec = unix_usec;
-        _buf->num_sats = num_sats;
-        _buf->status = status;
-        _buf->longitude_raw = longitude_raw;
-        _buf->latitude_raw = latitude_raw;
-        _buf->altitude_m = altitude_m;
-        _buf->vn_mps = vn_mps;
-        _buf->ve_mps = ve_mps;
-        _buf->vd_mps = vd_mps;
-        _buf->hAcc = hAcc;
-        _buf->vAcc = vAcc;
-        _buf->hdop = hdop;
-        _buf->vdop = vdop;
-        return true;
+        return codec_t<gps_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        millis = _buf->millis;
-        unix_usec = _buf->unix_usec;
-        num_sats = _buf->num_sats;
-        status = _buf->status;
-        longitude_raw = _buf->longitude_raw;
-        latitude_raw = _buf->latitude_raw;
-        altitude_m = _buf->altitude_m;
-        vn_mps = _buf->vn_mps;
-        ve_mps = _buf->ve_mps;
-        vd_mps = _buf->vd_mps;
-        hAcc = _buf->hAcc;
-        vAcc = _buf->vAcc;
-        hdop = _buf->hdop;
-        vdop = _buf->vdop;
-        return true;
+        return codec_t<gps_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -772,20 +709,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setUInt("millis", millis);
-        node.setUInt64("unix_usec", unix_usec);
-        node.setUInt("num_sats", num_sats);
-        node.setUInt("status", status);
-        node.setInt("longitude_raw", longitude_raw);
-        node.setInt("latitude_raw", latitude_raw);
-        node.setDouble("altitude_m", altitude_m);
-        node.setDouble("vn_mps", vn_mps);
-        node.setDouble("ve_mps", ve_mps);
-        node.setDouble("vd_mps", vd_mps);
-        node.setDouble("hAcc", hAcc);
-        node.setDouble("vAcc", vAcc);
-        node.setDouble("hdop", hdop);
-        node.setDouble("vdop", vdop);
+        codec_t<gps_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -797,20 +721,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        millis = node.getUInt("millis");
-        unix_usec = node.getUInt64("unix_usec");
-        num_sats = node.getUInt("num_sats");
-        status = node.getUInt("status");
-        longitude_raw = node.getInt("longitude_raw");
-        latitude_raw = node.getInt("latitude_raw");
-        altitude_m = node.getDouble("altitude_m");
-        vn_mps = node.getDouble("vn_mps");
-        ve_mps = node.getDouble("ve_mps");
-        vd_mps = node.getDouble("vd_mps");
-        hAcc = node.getDouble("hAcc");
-        vAcc = node.getDouble("vAcc");
-        hdop = node.getDouble("hdop");
-        vdop = node.getDouble("vdop");
+        codec_t<gps_t>::props2msg(*this, node);
     }
 };
 
@@ -818,6 +729,8 @@ public:
 class airdata_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     float baro_press_pa;
     float baro_temp_C;
     float baro_hum;
@@ -829,6 +742,8 @@ public:
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         float baro_press_pa;
         float baro_temp_C;
         float baro_hum;
@@ -839,43 +754,38 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(airdata_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(airdata_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "baro_press_pa", offsetof(airdata_t, baro_press_pa), offsetof(_compact_t, baro_press_pa), type_float, type_float, 1, 0.0f, 0.0f },
+            { "baro_temp_C", offsetof(airdata_t, baro_temp_C), offsetof(_compact_t, baro_temp_C), type_float, type_float, 1, 0.0f, 0.0f },
+            { "baro_hum", offsetof(airdata_t, baro_hum), offsetof(_compact_t, baro_hum), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ext_diff_press_pa", offsetof(airdata_t, ext_diff_press_pa), offsetof(_compact_t, ext_diff_press_pa), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ext_static_press_pa", offsetof(airdata_t, ext_static_press_pa), offsetof(_compact_t, ext_static_press_pa), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ext_temp_C", offsetof(airdata_t, ext_temp_C), offsetof(_compact_t, ext_temp_C), type_float, type_float, 1, 0.0f, 0.0f },
+            { "error_count", offsetof(airdata_t, error_count), offsetof(_compact_t, error_count), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "airdata field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "airdata packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 9;
+    static const uint8_t value_count = 9;
+
+    // id, payload and len
     static const uint8_t id = 19;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~airdata_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->baro_press_pa = baro_press_pa;
-        _buf->baro_temp_C = baro_temp_C;
-        _buf->baro_hum = baro_hum;
-        _buf->ext_diff_press_pa = ext_diff_press_pa;
-        _buf->ext_static_press_pa = ext_static_press_pa;
-        _buf->ext_temp_C = ext_temp_C;
-        _buf->error_count = error_count;
-        return true;
+        return codec_t<airdata_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        baro_press_pa = _buf->baro_press_pa;
-        baro_temp_C = _buf->baro_temp_C;
-        baro_hum = _buf->baro_hum;
-        ext_diff_press_pa = _buf->ext_diff_press_pa;
-        ext_static_press_pa = _buf->ext_static_press_pa;
-        ext_temp_C = _buf->ext_temp_C;
-        error_count = _buf->error_count;
-        return true;
+        return codec_t<airdata_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -887,13 +797,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setDouble("baro_press_pa", baro_press_pa);
-        node.setDouble("baro_temp_C", baro_temp_C);
-        node.setDouble("baro_hum", baro_hum);
-        node.setDouble("ext_diff_press_pa", ext_diff_press_pa);
-        node.setDouble("ext_static_press_pa", ext_static_press_pa);
-        node.setDouble("ext_temp_C", ext_temp_C);
-        node.setUInt("error_count", error_count);
+        codec_t<airdata_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -905,13 +809,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        baro_press_pa = node.getDouble("baro_press_pa");
-        baro_temp_C = node.getDouble("baro_temp_C");
-        baro_hum = node.getDouble("baro_hum");
-        ext_diff_press_pa = node.getDouble("ext_diff_press_pa");
-        ext_static_press_pa = node.getDouble("ext_static_press_pa");
-        ext_temp_C = node.getDouble("ext_temp_C");
-        error_count = node.getUInt("error_count");
+        codec_t<airdata_t>::props2msg(*this, node);
     }
 };
 
@@ -919,6 +817,8 @@ public:
 class power_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     float int_main_v;
     float avionics_v;
     float ext_main_v;
@@ -927,6 +827,8 @@ public:
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         uint16_t int_main_v;
         uint16_t avionics_v;
         uint16_t ext_main_v;
@@ -934,37 +836,35 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(power_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(power_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "int_main_v", offsetof(power_t, int_main_v), offsetof(_compact_t, int_main_v), type_float, type_uint16, 1, 100.0f, (float)(1.0 / 100.0) },
+            { "avionics_v", offsetof(power_t, avionics_v), offsetof(_compact_t, avionics_v), type_float, type_uint16, 1, 100.0f, (float)(1.0 / 100.0) },
+            { "ext_main_v", offsetof(power_t, ext_main_v), offsetof(_compact_t, ext_main_v), type_float, type_uint16, 1, 100.0f, (float)(1.0 / 100.0) },
+            { "ext_main_amp", offsetof(power_t, ext_main_amp), offsetof(_compact_t, ext_main_amp), type_float, type_uint16, 1, 100.0f, (float)(1.0 / 100.0) },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "power field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "power packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 6;
+    static const uint8_t value_count = 6;
+
+    // id, payload and len
     static const uint8_t id = 20;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~power_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->int_main_v = uintround(int_main_v * 100);
-        _buf->avionics_v = uintround(avionics_v * 100);
-        _buf->ext_main_v = uintround(ext_main_v * 100);
-        _buf->ext_main_amp = uintround(ext_main_amp * 100);
-        return true;
+        return codec_t<power_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        int_main_v = _buf->int_main_v / (float)100;
-        avionics_v = _buf->avionics_v / (float)100;
-        ext_main_v = _buf->ext_main_v / (float)100;
-        ext_main_amp = _buf->ext_main_amp / (float)100;
-        return true;
+        return codec_t<power_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -976,10 +876,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setDouble("int_main_v", int_main_v);
-        node.setDouble("avionics_v", avionics_v);
-        node.setDouble("ext_main_v", ext_main_v);
-        node.setDouble("ext_main_amp", ext_main_amp);
+        codec_t<power_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -991,10 +888,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        int_main_v = node.getDouble("int_main_v");
-        avionics_v = node.getDouble("avionics_v");
-        ext_main_v = node.getDouble("ext_main_v");
-        ext_main_amp = node.getDouble("ext_main_amp");
+        codec_t<power_t>::props2msg(*this, node);
     }
 };
 
@@ -1002,60 +896,78 @@ public:
 class status_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     uint16_t serial_number;
     uint16_t firmware_rev;
     uint16_t master_hz;
     uint32_t baud;
     uint16_t byte_rate;
     uint16_t timer_misses;
+    uint8_t tx_queue_high;
+    uint16_t tx_queued[tx_stats_ids];
+    uint16_t tx_sent[tx_stats_ids];
+    uint16_t tx_dropped[tx_stats_ids];
+    uint8_t tlm_queue_high;
+    uint32_t tlm_queue_dropped;
 
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         uint16_t serial_number;
         uint16_t firmware_rev;
         uint16_t master_hz;
         uint32_t baud;
         uint16_t byte_rate;
         uint16_t timer_misses;
+        uint8_t tx_queue_high;
+        uint16_t tx_queued[tx_stats_ids];
+        uint16_t tx_sent[tx_stats_ids];
+        uint16_t tx_dropped[tx_stats_ids];
+        uint8_t tlm_queue_high;
+        uint32_t tlm_queue_dropped;
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(status_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(status_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "serial_number", offsetof(status_t, serial_number), offsetof(_compact_t, serial_number), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "firmware_rev", offsetof(status_t, firmware_rev), offsetof(_compact_t, firmware_rev), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "master_hz", offsetof(status_t, master_hz), offsetof(_compact_t, master_hz), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "baud", offsetof(status_t, baud), offsetof(_compact_t, baud), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "byte_rate", offsetof(status_t, byte_rate), offsetof(_compact_t, byte_rate), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "timer_misses", offsetof(status_t, timer_misses), offsetof(_compact_t, timer_misses), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "tx_queue_high", offsetof(status_t, tx_queue_high), offsetof(_compact_t, tx_queue_high), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "tx_queued", offsetof(status_t, tx_queued), offsetof(_compact_t, tx_queued), type_uint16, type_uint16, tx_stats_ids, 0.0f, 0.0f },
+            { "tx_sent", offsetof(status_t, tx_sent), offsetof(_compact_t, tx_sent), type_uint16, type_uint16, tx_stats_ids, 0.0f, 0.0f },
+            { "tx_dropped", offsetof(status_t, tx_dropped), offsetof(_compact_t, tx_dropped), type_uint16, type_uint16, tx_stats_ids, 0.0f, 0.0f },
+            { "tlm_queue_high", offsetof(status_t, tlm_queue_high), offsetof(_compact_t, tlm_queue_high), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "tlm_queue_dropped", offsetof(status_t, tlm_queue_dropped), offsetof(_compact_t, tlm_queue_dropped), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "status field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "status packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 14;
+    static const uint8_t value_count = 11 + tx_stats_ids + tx_stats_ids + tx_stats_ids;
+
+    // id, payload and len
     static const uint8_t id = 21;
-    uint8_t *payload = nullptr;
-    int len = 0;
-
-    ~status_t() {
-        free(payload);
-    }
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->serial_number = serial_number;
-        _buf->firmware_rev = firmware_rev;
-        _buf->master_hz = master_hz;
-        _buf->baud = baud;
-        _buf->byte_rate = byte_rate;
-        _buf->timer_misses = timer_misses;
-        return true;
+        return codec_t<status_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        serial_number = _buf->serial_number;
-        firmware_rev = _buf->firmware_rev;
-        master_hz = _buf->master_hz;
-        baud = _buf->baud;
-        byte_rate = _buf->byte_rate;
-        timer_misses = _buf->timer_misses;
-        return true;
+        return codec_t<status_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -1067,12 +979,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setUInt("serial_number", serial_number);
-        node.setUInt("firmware_rev", firmware_rev);
-        node.setUInt("master_hz", master_hz);
-        node.setUInt("baud", baud);
-        node.setUInt("byte_rate", byte_rate);
-        node.setUInt("timer_misses", timer_misses);
+        codec_t<status_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -1084,12 +991,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        serial_number = node.getUInt("serial_number");
-        firmware_rev = node.getUInt("firmware_rev");
-        master_hz = node.getUInt("master_hz");
-        baud = node.getUInt("baud");
-        byte_rate = node.getUInt("byte_rate");
-        timer_misses = node.getUInt("timer_misses");
+        codec_t<status_t>::props2msg(*this, node);
     }
 };
 
@@ -1097,6 +999,8 @@ public:
 class ekf_t {
 public:
 
+    uint32_t frame_usec;
+    uint16_t sequence;
     uint32_t millis;
     double lat_rad;
     double lon_rad;
@@ -1121,6 +1025,8 @@ public:
     // internal structure for packing
     #pragma pack(push, 1)
     struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
         uint32_t millis;
         double lat_rad;
         double lon_rad;
@@ -1144,69 +1050,522 @@ public:
     };
     #pragma pack(pop)
 
-    // id, ptr to payload and len
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(ekf_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(ekf_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "millis", offsetof(ekf_t, millis), offsetof(_compact_t, millis), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "lat_rad", offsetof(ekf_t, lat_rad), offsetof(_compact_t, lat_rad), type_double, type_double, 1, 0.0f, 0.0f },
+            { "lon_rad", offsetof(ekf_t, lon_rad), offsetof(_compact_t, lon_rad), type_double, type_double, 1, 0.0f, 0.0f },
+            { "altitude_m", offsetof(ekf_t, altitude_m), offsetof(_compact_t, altitude_m), type_float, type_float, 1, 0.0f, 0.0f },
+            { "vn_ms", offsetof(ekf_t, vn_ms), offsetof(_compact_t, vn_ms), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ve_ms", offsetof(ekf_t, ve_ms), offsetof(_compact_t, ve_ms), type_float, type_float, 1, 0.0f, 0.0f },
+            { "vd_ms", offsetof(ekf_t, vd_ms), offsetof(_compact_t, vd_ms), type_float, type_float, 1, 0.0f, 0.0f },
+            { "phi_rad", offsetof(ekf_t, phi_rad), offsetof(_compact_t, phi_rad), type_float, type_float, 1, 0.0f, 0.0f },
+            { "the_rad", offsetof(ekf_t, the_rad), offsetof(_compact_t, the_rad), type_float, type_float, 1, 0.0f, 0.0f },
+            { "psi_rad", offsetof(ekf_t, psi_rad), offsetof(_compact_t, psi_rad), type_float, type_float, 1, 0.0f, 0.0f },
+            { "p_bias", offsetof(ekf_t, p_bias), offsetof(_compact_t, p_bias), type_float, type_float, 1, 0.0f, 0.0f },
+            { "q_bias", offsetof(ekf_t, q_bias), offsetof(_compact_t, q_bias), type_float, type_float, 1, 0.0f, 0.0f },
+            { "r_bias", offsetof(ekf_t, r_bias), offsetof(_compact_t, r_bias), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ax_bias", offsetof(ekf_t, ax_bias), offsetof(_compact_t, ax_bias), type_float, type_float, 1, 0.0f, 0.0f },
+            { "ay_bias", offsetof(ekf_t, ay_bias), offsetof(_compact_t, ay_bias), type_float, type_float, 1, 0.0f, 0.0f },
+            { "az_bias", offsetof(ekf_t, az_bias), offsetof(_compact_t, az_bias), type_float, type_float, 1, 0.0f, 0.0f },
+            { "max_pos_cov", offsetof(ekf_t, max_pos_cov), offsetof(_compact_t, max_pos_cov), type_float, type_uint16, 1, 100.0f, (float)(1.0 / 100.0) },
+            { "max_vel_cov", offsetof(ekf_t, max_vel_cov), offsetof(_compact_t, max_vel_cov), type_float, type_uint16, 1, 1000.0f, (float)(1.0 / 1000.0) },
+            { "max_att_cov", offsetof(ekf_t, max_att_cov), offsetof(_compact_t, max_att_cov), type_float, type_uint16, 1, 10000.0f, (float)(1.0 / 10000.0) },
+            { "status", offsetof(ekf_t, status), offsetof(_compact_t, status), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "ekf field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "ekf packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 22;
+    static const uint8_t value_count = 22;
+
+    // id, payload and len
     static const uint8_t id = 22;
-    uint8_t *payload = nullptr;
-    int len = 0;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
 
-    ~ekf_t() {
-        free(payload);
+    bool pack() {
+        return codec_t<ekf_t>::pack(*this);
+    }
+
+    bool unpack(uint8_t *external_message, int message_size) {
+        return codec_t<ekf_t>::unpack(*this, external_message, message_size);
+    }
+
+    void msg2props(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        msg2props(node);
     }
 
+    void msg2props(PropertyNode node) {
+        codec_t<ekf_t>::msg2props(*this, node);
+    }
+
+    void props2msg(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        props2msg(node);
+    }
+
+    void props2msg(PropertyNode node) {
+        codec_t<ekf_t>::props2msg(*this, node);
+    }
+};
+
+// Message: command_echo (id: 23)
+class command_echo_t {
+public:
+
+    uint64_t host_usec;
+    uint16_t sequence;
+
+    // internal structure for packing
+    #pragma pack(push, 1)
+    struct _compact_t {
+        uint64_t host_usec;
+        uint16_t sequence;
+    };
+    #pragma pack(pop)
+
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "host_usec", offsetof(command_echo_t, host_usec), offsetof(_compact_t, host_usec), type_uint64, type_uint64, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(command_echo_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "command_echo field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "command_echo packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 2;
+    static const uint8_t value_count = 2;
+
+    // id, payload and len
+    static const uint8_t id = 23;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
+
     bool pack() {
-        len = sizeof(_compact_t);
-        // compute dynamic packet size (if neede)
-        int size = len;
-        payload = (uint8_t *)REALLOC(payload, size);
-        // copy values
-        _compact_t *_buf = (_compact_t *)payload;
-        _buf->millis = millis;
-        _buf->lat_rad = lat_rad;
-        _buf->lon_rad = lon_rad;
-        _buf->altitude_m = altitude_m;
-        _buf->vn_ms = vn_ms;
-        _buf->ve_ms = ve_ms;
-        _buf->vd_ms = vd_ms;
-        _buf->phi_rad = phi_rad;
-        _buf->the_rad = the_rad;
-        _buf->psi_rad = psi_rad;
-        _buf->p_bias = p_bias;
-        _buf->q_bias = q_bias;
-        _buf->r_bias = r_bias;
-        _buf->ax_bias = ax_bias;
-        _buf->ay_bias = ay_bias;
-        _buf->az_bias = az_bias;
-        _buf->max_pos_cov = uintround(max_pos_cov * 100);
-        _buf->max_vel_cov = uintround(max_vel_cov * 1000);
-        _buf->max_att_cov = uintround(max_att_cov * 10000);
-        _buf->status = status;
-        return true;
+        return codec_t<command_echo_t>::pack(*this);
     }
 
     bool unpack(uint8_t *external_message, int message_size) {
-        _compact_t *_buf = (_compact_t *)external_message;
-        len = sizeof(_compact_t);
-        millis = _buf->millis;
-        lat_rad = _buf->lat_rad;
-        lon_rad = _buf->lon_rad;
-        altitude_m = _buf->altitude_m;
-        vn_ms = _buf->vn_ms;
-        ve_ms = _buf->ve_ms;
-        vd_ms = _buf->vd_ms;
-        phi_rad = _buf->phi_rad;
-        the_rad = _buf->the_rad;
-        psi_rad = _buf->psi_rad;
-        p_bias = _buf->p_bias;
-        q_bias = _buf->q_bias;
-        r_bias = _buf->r_bias;
-        ax_bias = _buf->ax_bias;
-        ay_bias = _buf->ay_bias;
-        az_bias = _buf->az_bias;
-        max_pos_cov = _buf->max_pos_cov / (float)100;
-        max_vel_cov = _buf->max_vel_cov / (float)1000;
-        max_att_cov = _buf->max_att_cov / (float)10000;
-        status = _buf->status;
-        return true;
+        return codec_t<command_echo_t>::unpack(*this, external_message, message_size);
+    }
+
+    void msg2props(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        msg2props(node);
+    }
+
+    void msg2props(PropertyNode node) {
+        codec_t<command_echo_t>::msg2props(*this, node);
+    }
+
+    void props2msg(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        props2msg(node);
+    }
+
+    void props2msg(PropertyNode node) {
+        codec_t<command_echo_t>::props2msg(*this, node);
+    }
+};
+
+// Message: echo_reply (id: 24)
+class echo_reply_t {
+public:
+
+    uint64_t host_usec;
+    uint16_t sequence;
+    uint64_t rx_usec;
+    uint64_t tx_usec;
+
+    // internal structure for packing
+    #pragma pack(push, 1)
+    struct _compact_t {
+        uint64_t host_usec;
+        uint16_t sequence;
+        uint64_t rx_usec;
+        uint64_t tx_usec;
+    };
+    #pragma pack(pop)
+
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "host_usec", offsetof(echo_reply_t, host_usec), offsetof(_compact_t, host_usec), type_uint64, type_uint64, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(echo_reply_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "rx_usec", offsetof(echo_reply_t, rx_usec), offsetof(_compact_t, rx_usec), type_uint64, type_uint64, 1, 0.0f, 0.0f },
+            { "tx_usec", offsetof(echo_reply_t, tx_usec), offsetof(_compact_t, tx_usec), type_uint64, type_uint64, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "echo_reply field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "echo_reply packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 4;
+    static const uint8_t value_count = 4;
+
+    // id, payload and len
+    static const uint8_t id = 24;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
+
+    bool pack() {
+        return codec_t<echo_reply_t>::pack(*this);
+    }
+
+    bool unpack(uint8_t *external_message, int message_size) {
+        return codec_t<echo_reply_t>::unpack(*this, external_message, message_size);
+    }
+
+    void msg2props(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        msg2props(node);
+    }
+
+    void msg2props(PropertyNode node) {
+        codec_t<echo_reply_t>::msg2props(*this, node);
+    }
+
+    void props2msg(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        props2msg(node);
+    }
+
+    void props2msg(PropertyNode node) {
+        codec_t<echo_reply_t>::props2msg(*this, node);
+    }
+};
+
+// Message: reliable_data (id: 25)
+class reliable_data_t {
+public:
+
+    uint16_t seq;
+    uint8_t flags;
+    uint8_t inner_id;
+
+    // internal structure for packing
+    #pragma pack(push, 1)
+    struct _compact_t {
+        uint16_t seq;
+        uint8_t flags;
+        uint8_t inner_id;
+    };
+    #pragma pack(pop)
+
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "seq", offsetof(reliable_data_t, seq), offsetof(_compact_t, seq), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "flags", offsetof(reliable_data_t, flags), offsetof(_compact_t, flags), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "inner_id", offsetof(reliable_data_t, inner_id), offsetof(_compact_t, inner_id), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "reliable_data field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "reliable_data packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 3;
+    static const uint8_t value_count = 3;
+
+    // id, payload and len
+    static const uint8_t id = 25;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
+
+    bool pack() {
+        return codec_t<reliable_data_t>::pack(*this);
+    }
+
+    bool unpack(uint8_t *external_message, int message_size) {
+        return codec_t<reliable_data_t>::unpack(*this, external_message, message_size);
+    }
+
+    void msg2props(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        msg2props(node);
+    }
+
+    void msg2props(PropertyNode node) {
+        codec_t<reliable_data_t>::msg2props(*this, node);
+    }
+
+    void props2msg(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        props2msg(node);
+    }
+
+    void props2msg(PropertyNode node) {
+        codec_t<reliable_data_t>::props2msg(*this, node);
+    }
+};
+
+// Message: reliable_ack (id: 26)
+class reliable_ack_t {
+public:
+
+    uint16_t next_seq;
+    uint8_t flags;
+
+    // internal structure for packing
+    #pragma pack(push, 1)
+    struct _compact_t {
+        uint16_t next_seq;
+        uint8_t flags;
+    };
+    #pragma pack(pop)
+
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "next_seq", offsetof(reliable_ack_t, next_seq), offsetof(_compact_t, next_seq), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "flags", offsetof(reliable_ack_t, flags), offsetof(_compact_t, flags), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "reliable_ack field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "reliable_ack packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 2;
+    static const uint8_t value_count = 2;
+
+    // id, payload and len
+    static const uint8_t id = 26;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
+
+    bool pack() {
+        return codec_t<reliable_ack_t>::pack(*this);
+    }
+
+    bool unpack(uint8_t *external_message, int message_size) {
+        return codec_t<reliable_ack_t>::unpack(*this, external_message, message_size);
+    }
+
+    void msg2props(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        msg2props(node);
+    }
+
+    void msg2props(PropertyNode node) {
+        codec_t<reliable_ack_t>::msg2props(*this, node);
+    }
+
+    void props2msg(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        props2msg(node);
+    }
+
+    void props2msg(PropertyNode node) {
+        codec_t<reliable_ack_t>::props2msg(*this, node);
+    }
+};
+
+// Message: task_profile (id: 27)
+class task_profile_t {
+public:
+
+    uint32_t frame_usec;
+    uint16_t sequence;
+    uint8_t index;
+    uint8_t count;
+    uint8_t name[task_name_len];
+    uint32_t runs;
+    uint16_t min_usec;
+    uint16_t mean_usec;
+    uint16_t p99_usec;
+    uint16_t max_usec;
+    uint16_t overruns;
+    uint16_t deferrals;
+
+    // internal structure for packing
+    #pragma pack(push, 1)
+    struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
+        uint8_t index;
+        uint8_t count;
+        uint8_t name[task_name_len];
+        uint32_t runs;
+        uint16_t min_usec;
+        uint16_t mean_usec;
+        uint16_t p99_usec;
+        uint16_t max_usec;
+        uint16_t overruns;
+        uint16_t deferrals;
+    };
+    #pragma pack(pop)
+
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(task_profile_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(task_profile_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "index", offsetof(task_profile_t, index), offsetof(_compact_t, index), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "count", offsetof(task_profile_t, count), offsetof(_compact_t, count), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "name", offsetof(task_profile_t, name), offsetof(_compact_t, name), type_uint8, type_uint8, task_name_len, 0.0f, 0.0f },
+            { "runs", offsetof(task_profile_t, runs), offsetof(_compact_t, runs), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "min_usec", offsetof(task_profile_t, min_usec), offsetof(_compact_t, min_usec), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "mean_usec", offsetof(task_profile_t, mean_usec), offsetof(_compact_t, mean_usec), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "p99_usec", offsetof(task_profile_t, p99_usec), offsetof(_compact_t, p99_usec), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "max_usec", offsetof(task_profile_t, max_usec), offsetof(_compact_t, max_usec), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "overruns", offsetof(task_profile_t, overruns), offsetof(_compact_t, overruns), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "deferrals", offsetof(task_profile_t, deferrals), offsetof(_compact_t, deferrals), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "task_profile field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "task_profile packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 12;
+    static const uint8_t value_count = 11 + task_name_len;
+
+    // id, payload and len
+    static const uint8_t id = 27;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
+
+    bool pack() {
+        return codec_t<task_profile_t>::pack(*this);
+    }
+
+    bool unpack(uint8_t *external_message, int message_size) {
+        return codec_t<task_profile_t>::unpack(*this, external_message, message_size);
+    }
+
+    void msg2props(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        msg2props(node);
+    }
+
+    void msg2props(PropertyNode node) {
+        codec_t<task_profile_t>::msg2props(*this, node);
+    }
+
+    void props2msg(string _path, int _index = -1) {
+        if ( _index >= 0 ) {
+            _path += "/" + std::to_string(_index);
+        }
+        PropertyNode node(_path.c_str());
+        props2msg(node);
+    }
+
+    void props2msg(PropertyNode node) {
+        codec_t<task_profile_t>::props2msg(*this, node);
+    }
+};
+
+// Message: frame_timing (id: 28)
+class frame_timing_t {
+public:
+
+    uint32_t frame_usec;
+    uint16_t sequence;
+    uint8_t hist_kind;
+    uint32_t hist[timing_bins];
+    uint8_t worst_rank;
+    uint8_t worst_count;
+    uint32_t worst_frame;
+    uint32_t worst_interval_usec;
+    uint32_t worst_start_usec;
+    uint32_t worst_duration_usec;
+    uint32_t worst_latency_usec;
+    uint16_t worst_stage_usec[max_tasks];
+
+    // internal structure for packing
+    #pragma pack(push, 1)
+    struct _compact_t {
+        uint32_t frame_usec;
+        uint16_t sequence;
+        uint8_t hist_kind;
+        uint32_t hist[timing_bins];
+        uint8_t worst_rank;
+        uint8_t worst_count;
+        uint32_t worst_frame;
+        uint32_t worst_interval_usec;
+        uint32_t worst_start_usec;
+        uint32_t worst_duration_usec;
+        uint32_t worst_latency_usec;
+        uint16_t worst_stage_usec[max_tasks];
+    };
+    #pragma pack(pop)
+
+    // field descriptors: name, offset, packed offset, type, packed
+    // type, count, scale, 1/scale
+    static const field_t *fields() {
+        static constexpr field_t _fields[] = {
+            { "frame_usec", offsetof(frame_timing_t, frame_usec), offsetof(_compact_t, frame_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "sequence", offsetof(frame_timing_t, sequence), offsetof(_compact_t, sequence), type_uint16, type_uint16, 1, 0.0f, 0.0f },
+            { "hist_kind", offsetof(frame_timing_t, hist_kind), offsetof(_compact_t, hist_kind), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "hist", offsetof(frame_timing_t, hist), offsetof(_compact_t, hist), type_uint32, type_uint32, timing_bins, 0.0f, 0.0f },
+            { "worst_rank", offsetof(frame_timing_t, worst_rank), offsetof(_compact_t, worst_rank), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "worst_count", offsetof(frame_timing_t, worst_count), offsetof(_compact_t, worst_count), type_uint8, type_uint8, 1, 0.0f, 0.0f },
+            { "worst_frame", offsetof(frame_timing_t, worst_frame), offsetof(_compact_t, worst_frame), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "worst_interval_usec", offsetof(frame_timing_t, worst_interval_usec), offsetof(_compact_t, worst_interval_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "worst_start_usec", offsetof(frame_timing_t, worst_start_usec), offsetof(_compact_t, worst_start_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "worst_duration_usec", offsetof(frame_timing_t, worst_duration_usec), offsetof(_compact_t, worst_duration_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "worst_latency_usec", offsetof(frame_timing_t, worst_latency_usec), offsetof(_compact_t, worst_latency_usec), type_uint32, type_uint32, 1, 0.0f, 0.0f },
+            { "worst_stage_usec", offsetof(frame_timing_t, worst_stage_usec), offsetof(_compact_t, worst_stage_usec), type_uint16, type_uint16, max_tasks, 0.0f, 0.0f },
+        };
+        static_assert(sizeof(_fields) / sizeof(field_t) == field_count, "frame_timing field count");
+        static_assert(wire_size(_fields) == sizeof(_compact_t), "frame_timing packed size");
+        return _fields;
+    }
+    static const uint8_t field_count = 12;
+    static const uint8_t value_count = 10 + timing_bins + max_tasks;
+
+    // id, payload and len
+    static const uint8_t id = 28;
+    uint8_t payload[sizeof(_compact_t)];
+    static const uint16_t len = sizeof(_compact_t);
+
+    bool pack() {
+        return codec_t<frame_timing_t>::pack(*this);
+    }
+
+    bool unpack(uint8_t *external_message, int message_size) {
+        return codec_t<frame_timing_t>::unpack(*this, external_message, message_size);
     }
 
     void msg2props(string _path, int _index = -1) {
@@ -1218,26 +1577,7 @@ public:
     }
 
     void msg2props(PropertyNode node) {
-        node.setUInt("millis", millis);
-        node.setDouble("lat_rad", lat_rad);
-        node.setDouble("lon_rad", lon_rad);
-        node.setDouble("altitude_m", altitude_m);
-        node.setDouble("vn_ms", vn_ms);
-        node.setDouble("ve_ms", ve_ms);
-        node.setDouble("vd_ms", vd_ms);
-        node.setDouble("phi_rad", phi_rad);
-        node.setDouble("the_rad", the_rad);
-        node.setDouble("psi_rad", psi_rad);
-        node.setDouble("p_bias", p_bias);
-        node.setDouble("q_bias", q_bias);
-        node.setDouble("r_bias", r_bias);
-        node.setDouble("ax_bias", ax_bias);
-        node.setDouble("ay_bias", ay_bias);
-        node.setDouble("az_bias", az_bias);
-        node.setDouble("max_pos_cov", max_pos_cov);
-        node.setDouble("max_vel_cov", max_vel_cov);
-        node.setDouble("max_att_cov", max_att_cov);
-        node.setUInt("status", status);
+        codec_t<frame_timing_t>::msg2props(*this, node);
     }
 
     void props2msg(string _path, int _index = -1) {
@@ -1249,26 +1589,7 @@ public:
     }
 
     void props2msg(PropertyNode node) {
-        millis = node.getUInt("millis");
-        lat_rad = node.getDouble("lat_rad");
-        lon_rad = node.getDouble("lon_rad");
-        altitude_m = node.getDouble("altitude_m");
-        vn_ms = node.getDouble("vn_ms");
-        ve_ms = node.getDouble("ve_ms");
-        vd_ms = node.getDouble("vd_ms");
-        phi_rad = node.getDouble("phi_rad");
-        the_rad = node.getDouble("the_rad");
-        psi_rad = node.getDouble("psi_rad");
-        p_bias = node.getDouble("p_bias");
-        q_bias = node.getDouble("q_bias");
-        r_bias = node.getDouble("r_bias");
-        ax_bias = node.getDouble("ax_bias");
-        ay_bias = node.getDouble("ay_bias");
-        az_bias = node.getDouble("az_bias");
-        max_pos_cov = node.getDouble("max_pos_cov");
-        max_vel_cov = node.getDouble("max_vel_cov");
-        max_att_cov = node.getDouble("max_att_cov");
-        status = node.getUInt("status");
+        codec_t<frame_timing_t>::props2msg(*this, node);
     }
 };
 
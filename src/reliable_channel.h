@@ -0,0 +1,110 @@
+#pragma once
+
+// Reliable command channel (shared by the firmware and the host tools,
+// no HAL dependencies.)
+//
+// Commands are wrapped in a reliable_data message carrying a 16 bit
+// sequence number.  The sender keeps a window of unacked commands in
+// flight; the receiver delivers strictly in order (go-back-N),
+// suppresses duplicates, and answers with a cumulative reliable_ack
+// holding the next sequence number it expects.  Lost commands are
+// resent by the sender's retransmit timer, or sooner after repeated
+// duplicate acks.
+//
+// A sender session starts with FLAG_SYN on its first command, which
+// (re)sets the receiver's expected sequence number.  A receiver that
+// has never seen a SYN (e.g. after a reboot) answers with
+// ACK_FLAG_RESYNC so the sender restarts its session.
+//
+// accept() only classifies a frame.  The receiver advances (and so
+// acks) a delivered command with consume() once the inner message has
+// been handled.  A command its handler rejects (unknown id, bad size,
+// handler error) is consumed too, since resending it can't help, but
+// the ack for it carries ACK_FLAG_REJECTED: the command just before
+// next_seq was not applied.
+
+#include <stdint.h>
+
+namespace reliable_channel {
+
+static const uint8_t FLAG_SYN = 0x01;         // reliable_data flags
+static const uint8_t ACK_FLAG_RESYNC = 0x01;  // reliable_ack flags
+static const uint8_t ACK_FLAG_REJECTED = 0x02;
+
+// signed distance between wrapping sequence numbers
+static inline int16_t seq_diff( uint16_t a, uint16_t b ) {
+    return (int16_t)(uint16_t)(a - b);
+}
+
+enum accept_t {
+    accept_deliver,             // next in order: process it, then consume()
+    accept_duplicate,           // already delivered: drop (and re-ack)
+    accept_out_of_order,        // a gap: drop, sender will go back
+    accept_unsynced             // no session yet: ask for a SYN
+};
+
+class receiver_t {
+public:
+    uint16_t next_seq = 0;
+    bool synced = false;
+    uint32_t delivered = 0;
+    uint32_t rejected = 0;
+    uint32_t duplicates = 0;
+    uint32_t out_of_order = 0;
+    uint32_t sessions = 0;
+
+    accept_t accept( uint16_t seq, uint8_t flags ) {
+        if ( (flags & FLAG_SYN) && (!synced || seq != syn_seq) ) {
+            // new sender session (a resent SYN of the current session
+            // is just another frame)
+            synced = true;
+            syn_seq = seq;
+            next_seq = seq;
+            sessions++;
+        }
+        if ( !synced ) {
+            return accept_unsynced;
+        }
+        int16_t d = seq_diff(seq, next_seq);
+        if ( d == 0 ) {
+            return accept_deliver;
+        } else if ( d < 0 ) {
+            duplicates++;
+            return accept_duplicate;
+        } else {
+            out_of_order++;
+            return accept_out_of_order;
+        }
+    }
+
+    // the command at next_seq has been handled (ok = its handler
+    // accepted it)
+    void consume( bool ok ) {
+        if ( ok ) {
+            delivered++;
+        } else {
+            rejected++;
+            reject_seq = next_seq;
+            reject_valid = true;
+        }
+        next_seq++;
+    }
+
+    uint8_t ack_flags() {
+        if ( !synced ) {
+            return ACK_FLAG_RESYNC;
+        }
+        // (repeated on duplicate acks until a later command is consumed)
+        if ( reject_valid && seq_diff(next_seq, reject_seq) == 1 ) {
+            return ACK_FLAG_REJECTED;
+        }
+        return 0;
+    }
+
+private:
+    uint16_t syn_seq = 0;
+    uint16_t reject_seq = 0;
+    bool reject_valid = false;
+};
+
+} // namespace reliable_channel
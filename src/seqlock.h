@@ -0,0 +1,60 @@
+#pragma once
+
+// Single writer sequence lock for publishing a snapshot struct.
+//
+// The writer bumps the sequence to odd, copies the value in, then
+// bumps it to even.  A reader copies the value out and keeps it only
+// if the sequence was even and unchanged across the copy.  The writer
+// never waits.
+//
+// Readers do not spin forever: on a single core RTOS a higher priority
+// reader that preempted the writer mid copy would never see the write
+// finish.  read() gives up after a few attempts and the caller keeps
+// its previous snapshot (the next frame will get the new one.)
+
+#include <stdint.h>
+#include <atomic>
+
+template <class T>
+class seqlock_t {
+public:
+    static const uint8_t READ_ATTEMPTS = 4;
+
+    void write( const T &value ) {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        data = value;
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // true with a consistent copy, false if nothing has been written
+    // yet or every attempt overlapped a write
+    bool read( T &value ) const {
+        for ( uint8_t i = 0; i < READ_ATTEMPTS; i++ ) {
+            uint32_t s0 = seq.load(std::memory_order_acquire);
+            if ( s0 == 0 ) {
+                return false;
+            }
+            if ( s0 & 1 ) {
+                continue;
+            }
+            T copy = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ( seq.load(std::memory_order_relaxed) == s0 ) {
+                value = copy;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // number of completed writes
+    uint32_t version() const {
+        return seq.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    std::atomic<uint32_t> seq{0};
+    T data;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+// Frame checksums for SerialLink (no HAL dependencies.)
+//
+// Every checksum covers the 3 byte frame header (id, len_lo, len_hi)
+// followed by the payload and is stored little endian after the
+// payload.
+//
+// fletcher16: the original byte at a time 8 bit sums (2 bytes.)
+// fletcher32: 16 bit sums over 32 bit loads with deferred modulo (4
+//             bytes.)  Much stronger than fletcher16 and cheaper per
+//             byte.
+// crc32c:     Castagnoli crc, slice-by-8 table driven (4 bytes.)
+//             Detects all burst errors up to 32 bits.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace serial_checksum {
+
+enum checksum_t {
+    CHECKSUM_FLETCHER16 = 0,    // default (compatible with older hosts)
+    CHECKSUM_FLETCHER32 = 1,
+    CHECKSUM_CRC32C = 2
+};
+
+static const uint8_t MAX_SIZE = 4;
+
+static inline uint8_t size( checksum_t type ) {
+    return type == CHECKSUM_FLETCHER16 ? 2 : 4;
+}
+
+// 8 bit fletcher style checksum over id, len and payload
+static inline void fletcher16( uint8_t id, uint8_t len_lo, uint8_t len_hi,
+                               const uint8_t *buf, uint16_t buf_size,
+                               uint8_t *cksum0, uint8_t *cksum1 )
+{
+    uint8_t c0 = 0;
+    uint8_t c1 = 0;
+
+    c0 += id;
+    c1 += c0;
+
+    c0 += len_lo;
+    c1 += c0;
+
+    c0 += len_hi;
+    c1 += c0;
+
+    for ( uint16_t i = 0; i < buf_size; i++ ) {
+        c0 += (uint8_t)buf[i];
+        c1 += c0;
+    }
+
+    *cksum0 = c0;
+    *cksum1 = c1;
+}
+
+// fletcher-32 over a byte stream taken as little endian 16 bit words
+// (an odd trailing byte is zero padded.)  Fed in pieces so the header
+// and payload don't need to be contiguous.
+class fletcher32_t {
+public:
+    void update( const uint8_t *buf, size_t n );
+    uint32_t final();
+private:
+    uint32_t c0 = 0;
+    uint32_t c1 = 0;
+    bool odd = false;           // a low byte is waiting for its pair
+    uint8_t pending = 0;
+};
+
+// crc-32c (reflected polynomial 0x82F63B78)
+uint32_t crc32c_update( uint32_t crc, const uint8_t *buf, size_t n );
+static inline uint32_t crc32c( const uint8_t *buf, size_t n ) {
+    return crc32c_update(0xFFFFFFFF, buf, n) ^ 0xFFFFFFFF;
+}
+
+// compute the frame checksum into out (size(type) bytes)
+void compute( checksum_t type, uint8_t id, uint8_t len_lo, uint8_t len_hi,
+              const uint8_t *payload, uint16_t len, uint8_t *out );
+
+// true if the size(type) bytes at cksum match
+bool verify( checksum_t type, uint8_t id, uint8_t len_lo, uint8_t len_hi,
+             const uint8_t *payload, uint16_t len, const uint8_t *cksum );
+
+} // namespace serial_checksum
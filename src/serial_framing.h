@@ -0,0 +1,269 @@
+#pragma once
+
+// SerialLink wire framing, shared by the firmware and the host tools
+// (no HAL dependencies.)
+//
+// som framing:  SOM0 SOM1 id len_lo len_hi payload[len] cksum[n]
+// cobs framing: COBS(id len_lo len_hi payload[len] cksum[n]) 0x00
+//
+// The checksum (n = 2 or 4 bytes) is chosen per link, see
+// serial_checksum.h.
+//
+// With cobs framing a zero byte only ever appears as a frame
+// delimiter, so after any corruption the receiver is back in sync at
+// the next delimiter no matter what the damaged length field says.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>  // memchr()
+
+#include "serial_checksum.h"
+
+namespace serial_framing {
+
+static const uint8_t START_OF_MSG0 = 147;
+static const uint8_t START_OF_MSG1 = 224;
+static const uint16_t MAX_PAYLOAD = 4096; // larger sizes are nonsense
+static const uint8_t HEADER_SIZE = 5;
+static const uint8_t MAX_FOOTER_SIZE = serial_checksum::MAX_SIZE;
+
+using serial_checksum::checksum_t;
+
+enum framing_t {
+    FRAMING_SOM = 0,            // start of message bytes (default)
+    FRAMING_COBS = 1            // consistent overhead byte stuffing
+};
+
+// per link wire format
+struct format_t {
+    framing_t framing = FRAMING_SOM;
+    checksum_t checksum = serial_checksum::CHECKSUM_FLETCHER16;
+};
+
+// worst case cobs encoded size of a frame (including the delimiter)
+constexpr size_t cobs_max_size( uint16_t len ) {
+    return (3 + len + MAX_FOOTER_SIZE) + (3 + len + MAX_FOOTER_SIZE) / 254 + 2;
+}
+
+// a validated frame inside a receive or capture buffer
+struct frame_view_t {
+    uint8_t id;
+    uint16_t len;
+    const uint8_t *payload;
+    size_t offset;              // offset of SOM0 in the buffer
+};
+
+enum scan_result_t {
+    scan_frame,                 // valid frame found
+    scan_need_more,             // no complete frame in the buffer
+    scan_bad_length,            // nonsense length field
+    scan_bad_checksum           // checksum mismatch
+};
+
+// Look for the next frame in buf.  *used is set to the number of
+// leading bytes the caller may drop: the end of a valid frame, one
+// byte past a rejected SOM0 (so a corrupted frame can't hide the
+// next good one), or the garbage ahead of a partial frame.
+static inline scan_result_t scan( const uint8_t *buf, size_t size,
+                                  frame_view_t *frame, size_t *used,
+                                  checksum_t ck = serial_checksum::CHECKSUM_FLETCHER16 )
+{
+    size_t pos = 0;
+    while ( true ) {
+        const uint8_t *p = (const uint8_t *)memchr(buf + pos, START_OF_MSG0, size - pos);
+        if ( p == nullptr ) {
+            *used = size;
+            return scan_need_more;
+        }
+        pos = p - buf;
+        if ( size - pos < 2 ) {
+            *used = pos;
+            return scan_need_more;
+        }
+        if ( p[1] == START_OF_MSG1 ) {
+            break;
+        }
+        pos++;
+    }
+    const uint8_t *p = buf + pos;
+    if ( size - pos < HEADER_SIZE ) {
+        *used = pos;
+        return scan_need_more;
+    }
+    uint16_t len = p[3] | (p[4] << 8);
+    if ( len > MAX_PAYLOAD ) {
+        *used = pos + 1;
+        return scan_bad_length;
+    }
+    size_t frame_size = HEADER_SIZE + len + serial_checksum::size(ck);
+    if ( size - pos < frame_size ) {
+        *used = pos;
+        return scan_need_more;
+    }
+    if ( !serial_checksum::verify( ck, p[2], p[3], p[4], p + HEADER_SIZE, len,
+                                   p + HEADER_SIZE + len ) ) {
+        *used = pos + 1;
+        return scan_bad_checksum;
+    }
+    frame->id = p[2];
+    frame->len = len;
+    frame->payload = p + HEADER_SIZE;
+    frame->offset = pos;
+    *used = pos + frame_size;
+    return scan_frame;
+}
+
+// streaming cobs encoder (bytes are stuffed as they are written, so
+// a frame can be assembled from pieces with no staging copy)
+class cobs_encoder_t {
+public:
+    cobs_encoder_t( uint8_t *dst ): dst(dst) {}
+    inline void put( uint8_t b ) {
+        if ( b == 0 ) {
+            finish_block();
+        } else {
+            dst[out++] = b;
+            if ( ++code == 0xFF ) {
+                finish_block();
+            }
+        }
+    }
+    inline void put( const uint8_t *buf, uint16_t len ) {
+        for ( uint16_t i = 0; i < len; i++ ) {
+            put(buf[i]);
+        }
+    }
+    // close the last block and append the delimiter, returns the size
+    size_t end() {
+        dst[code_pos] = code;
+        dst[out++] = 0;
+        return out;
+    }
+private:
+    uint8_t *dst;
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+    inline void finish_block() {
+        dst[code_pos] = code;
+        code_pos = out++;
+        code = 1;
+    }
+};
+
+// encode a complete cobs frame into dst (cobs_max_size(len) bytes)
+static inline size_t cobs_encode_frame( uint8_t *dst, uint8_t id,
+                                        const uint8_t *payload, uint16_t len,
+                                        checksum_t ck = serial_checksum::CHECKSUM_FLETCHER16 )
+{
+    uint8_t len_lo = len & 0xFF;
+    uint8_t len_hi = len >> 8;
+    uint8_t cksum[MAX_FOOTER_SIZE];
+    serial_checksum::compute( ck, id, len_lo, len_hi, payload, len, cksum );
+    cobs_encoder_t enc(dst);
+    enc.put(id);
+    enc.put(len_lo);
+    enc.put(len_hi);
+    enc.put(payload, len);
+    enc.put(cksum, serial_checksum::size(ck));
+    return enc.end();
+}
+
+// encode a complete som frame into dst (len + HEADER_SIZE +
+// MAX_FOOTER_SIZE bytes)
+static inline size_t som_encode_frame( uint8_t *dst, uint8_t id,
+                                       const uint8_t *payload, uint16_t len,
+                                       checksum_t ck = serial_checksum::CHECKSUM_FLETCHER16 )
+{
+    dst[0] = START_OF_MSG0;
+    dst[1] = START_OF_MSG1;
+    dst[2] = id;
+    dst[3] = len & 0xFF;
+    dst[4] = len >> 8;
+    memcpy(dst + HEADER_SIZE, payload, len);
+    serial_checksum::compute( ck, id, dst[3], dst[4], payload, len,
+                              dst + HEADER_SIZE + len );
+    return HEADER_SIZE + len + serial_checksum::size(ck);
+}
+
+// encode a frame in either framing (dst holds cobs_max_size(len) bytes,
+// which covers both)
+static inline size_t encode_frame( uint8_t *dst, uint8_t id,
+                                   const uint8_t *payload, uint16_t len,
+                                   format_t format = format_t() )
+{
+    if ( format.framing == FRAMING_COBS ) {
+        return cobs_encode_frame( dst, id, payload, len, format.checksum );
+    }
+    return som_encode_frame( dst, id, payload, len, format.checksum );
+}
+
+// decode one delimiter free cobs block, dst may equal src (decoding
+// never gets ahead of the input.)  Returns the decoded size, or 0 if
+// the block is malformed.
+static inline size_t cobs_decode( const uint8_t *src, size_t n, uint8_t *dst ) {
+    size_t i = 0;
+    size_t o = 0;
+    while ( i < n ) {
+        uint8_t code = src[i++];
+        if ( code == 0 || i + code - 1 > n ) {
+            return 0;
+        }
+        for ( uint8_t k = 1; k < code; k++ ) {
+            dst[o++] = src[i++];
+        }
+        if ( code < 0xFF && i < n ) {
+            dst[o++] = 0;
+        }
+    }
+    return o;
+}
+
+// Find the next delimited cobs frame in buf, decode it and validate
+// it.  The frame is decoded into scratch (room for the largest frame)
+// or, when scratch is null, in place (buf must then be writable.)
+// *used is the number of bytes consumed through the delimiter, or the
+// bytes that may be dropped when no delimiter has arrived yet (a run
+// of garbage longer than any valid frame.)
+static inline scan_result_t scan_cobs( const uint8_t *buf, size_t size,
+                                       uint8_t *scratch, frame_view_t *frame,
+                                       size_t *used,
+                                       checksum_t ck = serial_checksum::CHECKSUM_FLETCHER16 )
+{
+    size_t pos = 0;
+    const uint8_t *z;
+    while ( true ) {
+        z = (const uint8_t *)memchr(buf + pos, 0, size - pos);
+        if ( z == nullptr ) {
+            *used = (size - pos > cobs_max_size(MAX_PAYLOAD)) ? size : pos;
+            return scan_need_more;
+        }
+        if ( z > buf + pos ) {
+            break;
+        }
+        pos++;                  // skip empty blocks (idle delimiters)
+    }
+    size_t n = z - (buf + pos);
+    *used = pos + n + 1;
+    uint8_t *out = scratch ? scratch : (uint8_t *)buf + pos;
+    size_t m = cobs_decode( buf + pos, n, out );
+    uint8_t cksum_size = serial_checksum::size(ck);
+    if ( m < 3U + cksum_size ) {
+        return scan_bad_length;
+    }
+    uint16_t len = out[1] | (out[2] << 8);
+    if ( len > MAX_PAYLOAD || m != 3 + (size_t)len + cksum_size ) {
+        return scan_bad_length;
+    }
+    if ( !serial_checksum::verify( ck, out[0], out[1], out[2], out + 3, len,
+                                   out + 3 + len ) ) {
+        return scan_bad_checksum;
+    }
+    frame->id = out[0];
+    frame->len = len;
+    frame->payload = out + 3;
+    frame->offset = pos;
+    return scan_frame;
+}
+
+} // namespace serial_framing
@@ -1,206 +1,192 @@
-#include "setup_board.h"
+#if defined(ARDUPILOT_BUILD)
+#  include "setup_board.h"
+#  define link_printf console->printf
+#  define link_realloc hal.util->std_realloc
+#  define link_free(ptr) hal.util->std_realloc(ptr, 0)
+#  define TX_LOCK() WITH_SEMAPHORE(tx_sem)
+#else
+#  include <stdio.h>
+#  include <stdlib.h>
+#  define link_printf printf
+#  define link_realloc realloc
+#  define link_free free
+#  define TX_LOCK() std::lock_guard<std::mutex> tx_lock(tx_sem)
+#endif
+
+#include <string.h>
+
 #include "serial_link.h"
 
 SerialLink::SerialLink() {
 }
 
 SerialLink::~SerialLink() {
-}
-
-void SerialLink::checksum( uint8_t id, uint8_t len_lo, uint8_t len_hi,
-                           uint8_t *buf, uint16_t buf_size,
-                           uint8_t *cksum0, uint8_t *cksum1 )
-{
-    uint8_t c0 = 0;
-    uint8_t c1 = 0;
-
-    c0 += id;
-    c1 += c0;
-
-    c0 += len_lo;
-    c1 += c0;
-
-    c0 += len_hi;
-    c1 += c0;
-
-    for ( uint16_t i = 0; i < buf_size; i++ ) {
-        c0 += (uint8_t)buf[i];
-        c1 += c0;
+    if ( spill_buf != nullptr ) {
+        link_free(spill_buf);
     }
-
-    *cksum0 = c0;
-    *cksum1 = c1;
 }
 
-bool SerialLink::open( int baud, AP_HAL::UARTDriver *port ) {
-    console->printf("Opening comms port @ %d\n", baud);
+#if defined(ARDUPILOT_BUILD)
+bool SerialLink::open( int baud, AP_HAL::UARTDriver *port,
+                       serial_framing::format_t format ) {
+    uart.port = port;
+    return open( baud, &uart, format );
+}
+#endif
+
+bool SerialLink::open( int baud, serial_transport_t *port,
+                       serial_framing::format_t format ) {
+    static const char *checksum_names[] = { "fletcher16", "fletcher32", "crc32c" };
+    link_printf("Opening comms port @ %d (%s framing, %s)\n", baud,
+                format.framing == serial_framing::FRAMING_COBS ? "cobs" : "som",
+                checksum_names[format.checksum]);
     _port = port;
+    this->format = format;
+    if ( spill_buf == nullptr ) {
+        spill_buf = (uint8_t *)link_realloc(nullptr, SPILL_SIZE);
+        if ( spill_buf == nullptr ) {
+            link_printf("tx spill buffer allocation failed.\n");
+            return false;
+        }
+        TX_LOCK();
+        tx_queue.set_spill( spill_buf, SPILL_SIZE );
+    }
     // uint8_t opts = _port->get_options();
     // opts |= AP_HAL::UARTDriver::OPTION_NODMA_RX;
     // opts |= AP_HAL::UARTDriver::OPTION_NODMA_TX;
     // _port->set_options(opts);
-    _port->begin(baud);
-    // _port->begin(baud, 2048, 2048);
-    return true;
+#if defined(ARDUPILOT_BUILD)
+    if ( !drain_registered ) {
+        hal.scheduler->register_io_process(FUNCTOR_BIND_MEMBER(&SerialLink::drain, void));
+        drain_registered = true;
+    }
+#endif
+    return _port->begin(baud);
 }
 
-bool SerialLink::update() {
-    // 0 = looking for SOM0
-    // 1 = looking for SOM1
-    // 2 = looking for packet id
-    // 3 = looking for packet len (note 2 bytes)
-    // 4 = looking for packet data
-    // 5 = looking for checksum_lo
-    // 6 = looking for checksum_l=hi
-    uint8_t input;
-    bool new_data = false;
-    // console->print("start read_commands(): "); console->println(state);
-
-    if ( state == 0 ) {
-        counter = 0;
-        while ( _port->available() >= 1 ) {
-            // scan for start of message
-            input = _port->read();
-            // console->println(input);
-            if ( input == START_OF_MSG0 ) {
-                // console->println("start of msg0");
-                state = 1;
-                break;
-            }
-        }
-    }
-    if ( state == 1 ) {
-        if ( _port->available() >= 1 ) {
-            input = _port->read();
-            if ( input == START_OF_MSG1 ) {
-                // console->println("start of msg1");
-                state = 2;
-            } 
-            else if ( input == START_OF_MSG0 ) {
-                // no change
-            } else {
-                // oops
-                state = 0;
-            }
-        }
-    }
-    if ( state == 2 ) {
-        if ( _port->available() >= 1 ) {
-            pkt_id = _port->read();
-            // console->print("id="); console->println(message_id);
-            state = 3;
-        }
+// move any partial frame to the front of the buffer and append
+// whatever the uart has (one bulk read)
+bool SerialLink::refill() {
+    if ( rx_head > 0 ) {
+        memmove(rx_buf, rx_buf + rx_head, rx_len - rx_head);
+        rx_len -= rx_head;
+        rx_head = 0;
     }
-    if ( state == 3 ) {
-        if ( _port->available() >= 2 ) {
-            pkt_len_lo = _port->read();
-            pkt_len_hi = _port->read();
-            pkt_len = pkt_len_hi << 8 | pkt_len_lo;
-            // console->printf("size=%d\n", pkt_len);
-            if ( pkt_len > 4096 ) {
-                console->printf("nonsense packet size, skipping.\n");
-                // ignore nonsensical sizes
-                state = 0;
-            }  else {
-                state = 4;
-            }
-        }
+    uint32_t avail = _port->available();
+    if ( avail == 0 || rx_len >= RX_BUF_SIZE ) {
+        return false;
     }
-    if ( state == 4 ) {
-        if ( pkt_len > payload_len ) {
-            // reallocate buffer if new payload is larger than
-            // anything we've read so far.
-            void *newbuf = hal.util->std_realloc(payload, pkt_len);
-            if ( newbuf == nullptr ) {
-                console->printf("payload heap allocation failed.\n");
-                state = 0;
-                return false;
-            } else {
-                payload = (uint8_t *)newbuf;
-                payload_len = pkt_len;
-            }
-        }
-        while ( _port->available() >= 1 && counter < pkt_len ) {
-            payload[counter++] = _port->read();
-            // console->println(buf[i], DEC);
-        }
-        if ( counter >= pkt_len ) {
-            state = 5;
-        }
+    uint16_t space = RX_BUF_SIZE - rx_len;
+    ssize_t n = _port->read(rx_buf + rx_len, avail < space ? avail : space);
+    if ( n <= 0 ) {
+        return false;
     }
-    if ( state == 5 ) {
-        if ( _port->available() >= 1 ) {
-            cksum_lo = _port->read();
-            state = 6;
+    rx_len += n;
+    rx_bytes += n;
+    return true;
+}
+
+// Returns true for each complete frame (call until false to handle a
+// burst.)  The uart is only read when the buffered bytes don't hold
+// another complete frame.
+bool SerialLink::update() {
+    while ( true ) {
+        serial_framing::frame_view_t frame;
+        size_t used;
+        serial_framing::scan_result_t result;
+        if ( format.framing == serial_framing::FRAMING_COBS ) {
+            // decoded in place
+            result = serial_framing::scan_cobs( rx_buf + rx_head,
+                                                rx_len - rx_head, nullptr,
+                                                &frame, &used,
+                                                format.checksum );
+        } else {
+            result = serial_framing::scan( rx_buf + rx_head, rx_len - rx_head,
+                                           &frame, &used, format.checksum );
         }
-    }
-    if ( state == 6 ) {
-        if ( _port->available() >= 1 ) {
-            cksum_hi = _port->read();
-            uint8_t cksum0, cksum1;
-            checksum( pkt_id, pkt_len_lo, pkt_len_hi, payload, pkt_len,
-                      &cksum0, &cksum1 );
-            if ( cksum_lo == cksum0 && cksum_hi == cksum1 ) {
-                // console->println("passed check sum!");
-                // console->print("pkt_id = "); console->println(pkt_id);
-                // console->print("size="); console->println(pkt_len);
-                // parse_message_bin( pkt_id, payload, pkt_len );
-                new_data = true;
-                state = 0;
+        rx_head += used;
+        if ( result == serial_framing::scan_frame ) {
+            pkt_id = frame.id;
+            pkt_len = frame.len;
+            payload = (uint8_t *)frame.payload;
+            return true;
+        } else if ( result == serial_framing::scan_bad_length ) {
+            link_printf("nonsense packet size, skipping.\n");
+            parse_errors++;
+        } else if ( result == serial_framing::scan_bad_checksum ) {
+            if ( format.framing == serial_framing::FRAMING_COBS ) {
+                link_printf("failed check sum\n");
             } else {
-                console->printf("failed check sum id: %d len: %d\n",
-                                pkt_id, pkt_len);
-                // check sum failure
-                state = 0;
+                const uint8_t *p = rx_buf + rx_head - 1;  // rejected SOM0
+                link_printf("failed check sum id: %d len: %d\n",
+                            p[2], p[3] | (p[4] << 8));
             }
+            parse_errors++;
+        } else if ( !refill() ) {
+            return false;
         }
     }
-
-    return new_data;
 }
 
 int SerialLink::bytes_available() {
     return _port->available();
 }
 
+// Queue the frame (evicting lower priority frames if the queue is
+// full), then send whatever the uart has room for.  Returns the
+// encoded size, 0 if the frame was dropped.
 uint16_t SerialLink::write_packet(uint8_t packet_id, uint8_t *buf, uint16_t buf_size) {
-    // static int min_space = _port->txspace();
-    // if ( _port->txspace() > 0 and _port->txspace() < min_space ) {
-    //     console->printf("tx space low water mark: %d\n", min_space);
-    //     min_space = _port->txspace();
-    // }
-
-    if ( ! _port->is_initialized() ) {
+    if ( ! _port->is_initialized() || buf_size > serial_framing::MAX_PAYLOAD ) {
         return 0;
     }
-    if ( _port->txspace() < buf_size + 7U ) {
-        // console->printf("tx space: %ld\n", _port->txspace());
-        return 0;
+    size_t len;
+    {
+        TX_LOCK();
+        uint8_t *frame = tx_queue.reserve( packet_id, serial_framing::cobs_max_size(buf_size) );
+        if ( frame == nullptr ) {
+            return 0;
+        }
+        len = serial_framing::encode_frame( frame, packet_id, buf, buf_size, format );
+        tx_queue.commit( len );
     }
-    
-    // start of message sync (2) bytes
-    _port->write(START_OF_MSG0);
-    _port->write(START_OF_MSG1);
+    drain();
+    return len;
+}
 
-    // packet id (1 byte)
-    _port->write(packet_id);
-    
-    // packet length (2 bytes)
-    uint8_t len_lo = buf_size & 0xFF;
-    uint8_t len_hi = buf_size >> 8;
-    _port->write(len_lo);
-    _port->write(len_hi);
+// move queued frames to the uart, oldest first, as far as they fit (the
+// last one may go out in part, the rest follows on the next drain)
+void SerialLink::drain() {
+    if ( _port == nullptr || !_port->is_initialized() ) {
+        return;
+    }
+    TX_LOCK();
+    uint16_t len;
+    const uint8_t *frame;
+    while ( (frame = tx_queue.front(&len)) != nullptr ) {
+        size_t space = _port->txspace();
+        if ( space == 0 ) {
+            break;
+        }
+        size_t n = _port->write( frame, len < space ? len : space );
+        if ( n == 0 ) {
+            break;
+        }
+        tx_queue.consume( n );
+    }
+}
 
-    // write payload
-    _port->write( buf, buf_size );
-    
-    // check sum (2 bytes)
-    uint8_t cksum0, cksum1;
-    checksum( packet_id, len_lo, len_hi, buf, buf_size, &cksum0, &cksum1 );
-    _port->write(cksum0);
-    _port->write(cksum1);
+void SerialLink::set_tx_priority( uint8_t packet_id, tx_priority_t priority ) {
+    TX_LOCK();
+    tx_queue.set_priority( packet_id, priority );
+}
 
-    return buf_size + 7U;
+void SerialLink::get_tx_counters( uint8_t first_id, uint8_t n,
+                                  tx_queue_t::counters_t *counters,
+                                  uint8_t *high_water )
+{
+    TX_LOCK();
+    memcpy( counters, tx_queue.counters + first_id, n * sizeof(tx_queue_t::counters_t) );
+    *high_water = tx_queue.high_water;
 }
 
 bool SerialLink::close() {
@@ -1,44 +1,89 @@
 #pragma once
 
-#include <AP_HAL/AP_HAL.h>
+#if !defined(ARDUPILOT_BUILD)
+#include <mutex>
+#endif
 
+#include "serial_framing.h"
+#include "serial_transport.h"
+#include "serial_tx_queue.h"
+
+// RAM per link: the receive buffer (RX_BUF_SIZE, about 4.6 KB) and the
+// tx queue (about 8 KB) are members, the spill buffer (SPILL_SIZE,
+// about 4.1 KB) is allocated at open(), about 17 KB in all.
 class SerialLink {
 
 private:
 
     // port
-    AP_HAL::UARTDriver *_port;
+    serial_transport_t *_port = nullptr;
+#if defined(ARDUPILOT_BUILD)
+    uart_transport_t uart;
+#endif
+
+    // receive buffer: bytes are drained from the uart in bulk and
+    // frames are parsed in place.  Big enough for a maximum size frame
+    // (less one byte, or it would have been parsed) plus RX_READ_SIZE,
+    // so a partial frame never blocks the next read.
+    static const uint16_t RX_READ_SIZE = 512;
+    static const uint16_t RX_BUF_SIZE = serial_framing::cobs_max_size(serial_framing::MAX_PAYLOAD)
+        + RX_READ_SIZE;
+    uint8_t rx_buf[RX_BUF_SIZE];
+    uint16_t rx_head = 0;       // parse position
+    uint16_t rx_len = 0;        // valid bytes in rx_buf
 
-    // parser
-    int state = 0;
-    int counter = 0;
-    uint8_t cksum_lo = 0, cksum_hi = 0;
+    bool refill();
 
-    static const uint8_t START_OF_MSG0 = 147;
-    static const uint8_t START_OF_MSG1 = 224;
+    // framing and checksum selected at open()
+    serial_framing::format_t format;
 
-    void checksum( uint8_t id, uint8_t len_lo, uint8_t len_hi,
-                   uint8_t *buf, uint16_t buf_size,
-                   uint8_t *cksum0, uint8_t *cksum1 );
+    // every frame is encoded into the queue and drained as the uart
+    // makes room (by the caller and by the io thread.)  Frames larger
+    // than a queue slot use the spill buffer (SPILL_SIZE bytes,
+    // allocated at open().)
+    uint8_t *spill_buf = nullptr;
+    tx_queue_t tx_queue;
+#if defined(ARDUPILOT_BUILD)
+    HAL_Semaphore tx_sem;
+    bool drain_registered = false;
+#else
+    std::mutex tx_sem;
+#endif
+
+    static const uint8_t START_OF_MSG0 = serial_framing::START_OF_MSG0;
+    static const uint8_t START_OF_MSG1 = serial_framing::START_OF_MSG1;
 
 public:
 
+    static const uint16_t SPILL_SIZE = serial_framing::cobs_max_size(serial_framing::MAX_PAYLOAD);
+
+    // most recent frame from update(): payload points into the
+    // receive buffer and is valid until the next call to update()
     uint8_t pkt_id = 0;
-    uint8_t pkt_len_lo = 0;
-    uint8_t pkt_len_hi = 0;
     uint16_t pkt_len = 0;
     uint8_t *payload = nullptr;
-    uint16_t payload_len = 0;
 
     uint32_t parse_errors = 0;
+    uint32_t rx_bytes = 0;
 
     SerialLink();
     ~SerialLink();
 
-    bool open( int baud, AP_HAL::UARTDriver *port );
+    bool open( int baud, serial_transport_t *port,
+               serial_framing::format_t format = serial_framing::format_t() );
+#if defined(ARDUPILOT_BUILD)
+    bool open( int baud, AP_HAL::UARTDriver *port,
+               serial_framing::format_t format = serial_framing::format_t() );
+#endif
     bool update();
     int bytes_available();
     uint16_t write_packet(uint8_t packet_id, uint8_t *buf, uint16_t buf_size);
+    void drain();
+    void set_tx_priority( uint8_t packet_id, tx_priority_t priority );
+    // copy out the per id tx counters for ids [first_id, first_id + n)
+    void get_tx_counters( uint8_t first_id, uint8_t n,
+                          tx_queue_t::counters_t *counters,
+                          uint8_t *high_water );
     bool close();
     size_t txspace() { return _port->txspace(); }
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+// Byte stream transport under SerialLink.
+//
+// The firmware uses uart_transport_t (an AP_HAL::UARTDriver); the
+// host tools provide pty, unix socket and in-memory loopback
+// transports (host/rcfmu_transport.h) so the link protocol can be run
+// and benchmarked on a Linux box.  The interface is the subset of
+// UARTDriver that SerialLink needs, with the same semantics: reads and
+// writes never block, txspace() is how much write() will accept.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>          // ssize_t
+
+class serial_transport_t {
+public:
+    virtual ~serial_transport_t() {}
+
+    virtual bool begin( uint32_t baud ) = 0;
+    virtual void end() {}
+    virtual bool is_initialized() = 0;
+
+    virtual uint32_t available() = 0;
+    virtual ssize_t read( uint8_t *buf, uint16_t count ) = 0;
+    virtual size_t write( const uint8_t *buf, size_t count ) = 0;
+    virtual uint32_t txspace() = 0;
+};
+
+#if defined(ARDUPILOT_BUILD)
+
+#include <AP_HAL/AP_HAL.h>
+
+class uart_transport_t: public serial_transport_t {
+public:
+    AP_HAL::UARTDriver *port = nullptr;
+
+    bool begin( uint32_t baud ) {
+        port->begin(baud);
+        // port->begin(baud, 2048, 2048);
+        return true;
+    }
+    void end() {
+        port->end();
+    }
+    bool is_initialized() {
+        return port != nullptr && port->is_initialized();
+    }
+    uint32_t available() {
+        return port->available();
+    }
+    ssize_t read( uint8_t *buf, uint16_t count ) {
+        return port->read(buf, count);
+    }
+    size_t write( const uint8_t *buf, size_t count ) {
+        return port->write(buf, count);
+    }
+    uint32_t txspace() {
+        return port->txspace();
+    }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#pragma once
+
+// Bounded transmit queue in front of the uart (shared by the firmware
+// and the host tools, no HAL dependencies.)
+//
+// Encoded frames wait here until the uart has room for them, instead
+// of being discarded whenever txspace() is short.  Every frame goes
+// through the queue so the wire order is the write order.  Frames up
+// to SLOT_SIZE live in the slots; a larger frame (config sized
+// messages) is encoded into the one spill buffer given to
+// set_spill(), so at most one of them waits at a time.  Frames are
+// sent in pieces as the uart makes room, so a frame may be larger
+// than the uart's own buffer.
+//
+// When the queue is full a new frame makes room by the per message id
+// priority:
+//
+//   TX_PRIORITY_STALE   high rate state (imu, pilot): a newer copy is
+//                       always on the way, so the oldest one queued is
+//                       evicted first
+//   TX_PRIORITY_NORMAL  evicts a stale frame, otherwise is dropped
+//   TX_PRIORITY_NEVER_DROP  command acks and replies: evicts the
+//                       oldest stale, then normal frame
+//
+// NEVER_DROP is best effort: when every waiting frame is never-drop
+// too (or the spill buffer holds one and the new frame needs it) the
+// new frame is dropped like any other.  reserve() returns nullptr
+// (SerialLink::write_packet() returns 0) and the id's dropped counter
+// counts it; that return is the caller's backpressure signal.  A
+// frame already partly written to the uart is never evicted.
+//
+// The caller serializes access (SerialLink holds a semaphore, the
+// queue is filled by the main loop and drained by the io thread.)
+//
+// RAM: SLOTS * (SLOT_SIZE + 4) bytes of slots plus 6 bytes of
+// counters and 1 byte of priority per message id, about 8 KB per
+// queue (the spill buffer is owned by the caller.)
+
+#include <stdint.h>
+#include <string.h>
+
+enum tx_priority_t {
+    TX_PRIORITY_STALE = 0,
+    TX_PRIORITY_NORMAL = 1,
+    TX_PRIORITY_NEVER_DROP = 2
+};
+
+class tx_queue_t {
+public:
+    static const uint8_t SLOTS = 32;
+    static const uint16_t SLOT_SIZE = 192;  // largest queued frame
+
+    // per message id accounting (wrapping counters)
+    struct counters_t {
+        uint16_t queued;
+        uint16_t sent;
+        uint16_t dropped;
+    };
+    counters_t counters[256] = {};
+    uint8_t high_water = 0;     // most frames ever waiting
+
+    tx_queue_t() {
+        for ( uint8_t i = 0; i < SLOTS; i++ ) {
+            order[i] = i;
+        }
+        memset(priority, TX_PRIORITY_NORMAL, sizeof(priority));
+    }
+
+    void set_priority( uint8_t id, tx_priority_t p ) {
+        priority[id] = p;
+    }
+
+    uint8_t size() { return count; }
+
+    // buffer for frames larger than SLOT_SIZE (none = they're dropped)
+    void set_spill( uint8_t *buf, uint16_t size ) {
+        spill_buf = buf;
+        spill_size = size;
+    }
+
+    // reserve room for a frame of message id encoding to at most
+    // max_len bytes (evicting as needed), returns nullptr if the frame
+    // must be dropped.  Fill it and commit() the encoded length.
+    uint8_t *reserve( uint8_t id, uint16_t max_len ) {
+        bool spill = max_len > SLOT_SIZE;
+        if ( spill && (max_len > spill_size
+                       || (spill_used && !evict_spill(priority[id]))) ) {
+            counters[id].dropped++;
+            return nullptr;
+        }
+        if ( count == SLOTS && !evict(priority[id]) ) {
+            counters[id].dropped++;
+            return nullptr;
+        }
+        slot_t &s = slots[order[count]];
+        s.id = id;
+        s.spill = spill;
+        if ( spill ) {
+            spill_used = true;
+            return spill_buf;
+        }
+        return s.frame;
+    }
+    void commit( uint16_t len ) {
+        slot_t &s = slots[order[count]];
+        s.len = len;
+        counters[s.id].queued++;
+        count++;
+        if ( count > high_water ) {
+            high_water = count;
+        }
+    }
+
+    // unsent bytes of the oldest frame (valid until consume())
+    const uint8_t *front( uint16_t *len ) {
+        if ( count == 0 ) {
+            return nullptr;
+        }
+        slot_t &s = slots[order[0]];
+        *len = s.len - front_sent;
+        return (s.spill ? spill_buf : s.frame) + front_sent;
+    }
+    // n bytes of the oldest frame were written
+    void consume( uint16_t n ) {
+        slot_t &s = slots[order[0]];
+        front_sent += n;
+        if ( front_sent >= s.len ) {
+            counters[s.id].sent++;
+            remove(0);
+        }
+    }
+
+private:
+    struct slot_t {
+        uint8_t id;
+        bool spill;             // the frame is in spill_buf
+        uint16_t len;
+        uint8_t frame[SLOT_SIZE];
+    };
+    slot_t slots[SLOTS];
+    uint8_t order[SLOTS];       // slot indices, oldest first ([count..] free)
+    uint8_t count = 0;
+    uint16_t front_sent = 0;    // bytes of the oldest frame already written
+    uint8_t priority[256];
+    uint8_t *spill_buf = nullptr;
+    uint16_t spill_size = 0;
+    bool spill_used = false;
+
+    // remove the i'th oldest frame, its slot goes to the free end
+    void remove( uint8_t i ) {
+        uint8_t slot = order[i];
+        if ( slots[slot].spill ) {
+            spill_used = false;
+        }
+        if ( i == 0 ) {
+            front_sent = 0;
+        }
+        memmove(order + i, order + i + 1, SLOTS - i - 1);
+        order[SLOTS - 1] = slot;
+        count--;
+    }
+
+    // true if a frame of priority p may displace one of priority q
+    static bool displaces( uint8_t p, uint8_t q ) {
+        return q <= (p == TX_PRIORITY_NEVER_DROP ? TX_PRIORITY_NORMAL : TX_PRIORITY_STALE);
+    }
+
+    // drop the oldest frame of the lowest priority class a frame of
+    // priority p may displace (not one that is partly written)
+    bool evict( uint8_t p ) {
+        uint8_t first = front_sent ? 1 : 0;
+        for ( uint8_t level = TX_PRIORITY_STALE; level <= TX_PRIORITY_NORMAL; level++ ) {
+            if ( !displaces(p, level) ) {
+                break;
+            }
+            for ( uint8_t i = first; i < count; i++ ) {
+                slot_t &s = slots[order[i]];
+                if ( priority[s.id] == level ) {
+                    counters[s.id].dropped++;
+                    remove(i);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // free the spill buffer for a frame of priority p
+    bool evict_spill( uint8_t p ) {
+        for ( uint8_t i = front_sent ? 1 : 0; i < count; i++ ) {
+            slot_t &s = slots[order[i]];
+            if ( s.spill ) {
+                if ( !displaces(p, priority[s.id]) ) {
+                    return false;
+                }
+                counters[s.id].dropped++;
+                remove(i);
+                return true;
+            }
+        }
+        return false;           // it is being written
+    }
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// Single producer / single consumer lock free ring buffer.
+//
+// Exactly one thread pushes and exactly one (other) thread pops.  Each
+// side owns one index and publishes it with release ordering after
+// touching the slot, the other side reads it with acquire ordering, so
+// a slot's contents are always visible before its index moves.  No
+// locks and nothing ever blocks: a full queue drops the new item (and
+// counts it) rather than stall the producer.
+//
+// N must be a power of two (indices wrap freely.)
+
+#include <stdint.h>
+#include <atomic>
+
+template <class T, uint16_t N>
+class spsc_queue_t {
+    static_assert((N & (N - 1)) == 0, "spsc_queue_t size must be a power of two");
+
+public:
+    // producer side statistics (read them from anywhere, they are
+    // only ever advisory)
+    uint32_t pushed = 0;
+    uint32_t dropped = 0;
+    uint16_t high_water = 0;
+
+    // producer
+    bool push( const T &item ) {
+        uint16_t h = head.load(std::memory_order_relaxed);
+        uint16_t t = tail.load(std::memory_order_acquire);
+        uint16_t depth = h - t;
+        if ( depth >= N ) {
+            dropped++;
+            return false;
+        }
+        slots[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        pushed++;
+        if ( depth + 1 > high_water ) {
+            high_water = depth + 1;
+        }
+        return true;
+    }
+
+    // consumer
+    bool pop( T &item ) {
+        uint16_t t = tail.load(std::memory_order_relaxed);
+        if ( t == head.load(std::memory_order_acquire) ) {
+            return false;
+        }
+        item = slots[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint16_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    static uint16_t capacity() {
+        return N;
+    }
+
+private:
+    T slots[N];
+    std::atomic<uint16_t> head{0};  // next slot to write (producer)
+    std::atomic<uint16_t> tail{0};  // next slot to read (consumer)
+};